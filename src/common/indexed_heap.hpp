@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Binary max heap over dense integer keys. Every key remembers its position in the heap, so it can be removed or given
+// a new priority in O(log n) without searching for it.
+template <typename Priority>
+class IndexedHeap {
+  public:
+    bool contains(size_t key) const { return key < positions_.size() && positions_[key] != npos; }
+    bool empty() const { return entries_.empty(); }
+    size_t size() const { return entries_.size(); }
+
+    // inserts key, or moves it to its new priority when already present
+    void push(size_t key, Priority priority) {
+        if (contains(key)) {
+            update(key, priority);
+            return;
+        }
+
+        if (positions_.size() <= key) positions_.resize(key + 1, npos);
+        positions_[key] = entries_.size();
+        entries_.push_back({priority, key});
+        siftUp(entries_.size() - 1);
+    }
+
+    void update(size_t key, Priority priority) {
+        size_t position = positions_[key];
+        Priority old = entries_[position].priority;
+        entries_[position].priority = priority;
+        if (old < priority) {
+            siftUp(position);
+        } else {
+            siftDown(position);
+        }
+    }
+
+    void erase(size_t key) {
+        if (!contains(key)) return;
+
+        size_t position = positions_[key];
+        swapEntries(position, entries_.size() - 1);
+        entries_.pop_back();
+        positions_[key] = npos;
+
+        if (position < entries_.size()) {
+            siftUp(position);
+            siftDown(position);
+        }
+    }
+
+    size_t top() const { return entries_.front().key; }
+
+    size_t pop() {
+        size_t key = top();
+        erase(key);
+        return key;
+    }
+
+    void clear() {
+        entries_.clear();
+        positions_.clear();
+    }
+
+    // recomputes every priority at once and restores the heap in O(n)
+    template <typename F>
+    void reprioritize(F &&priorityOf) {
+        for (auto &entry : entries_) { entry.priority = priorityOf(entry.key); }
+        for (size_t i = entries_.size() / 2; i-- > 0;) { siftDown(i); }
+    }
+
+  private:
+    static constexpr size_t npos = SIZE_MAX;
+
+    struct Entry {
+        Priority priority;
+        size_t key;
+    };
+
+    void swapEntries(size_t a, size_t b) {
+        std::swap(entries_[a], entries_[b]);
+        positions_[entries_[a].key] = a;
+        positions_[entries_[b].key] = b;
+    }
+
+    void siftUp(size_t position) {
+        while (position > 0) {
+            size_t parent = (position - 1) / 2;
+            if (!(entries_[parent].priority < entries_[position].priority)) break;
+            swapEntries(parent, position);
+            position = parent;
+        }
+    }
+
+    void siftDown(size_t position) {
+        while (true) {
+            size_t largest = position;
+            size_t left = position * 2 + 1;
+            size_t right = left + 1;
+            if (left < entries_.size() && entries_[largest].priority < entries_[left].priority) largest = left;
+            if (right < entries_.size() && entries_[largest].priority < entries_[right].priority) largest = right;
+            if (largest == position) break;
+            swapEntries(largest, position);
+            position = largest;
+        }
+    }
+
+  private:
+    std::vector<Entry> entries_;
+    std::vector<size_t> positions_;
+};
@@ -167,6 +167,19 @@ namespace VertexFormat {
         T_UINT pad1;
         T_UINT pad2;
     };
+
+    // 32 byte alternative to MaterialVertex, used when the world pipeline is built with PACKED_MATERIAL_VERTEX
+    struct PackedMaterialVertex {
+        T_UINT norm;       // octahedral, snorm16x2
+        T_UINT colorLayer; // unorm8x4
+        T_UINT textureUV;  // unorm16x2
+        T_UINT glintUV;    // half2
+
+        T_UINT textureID;
+        T_UINT overlayUV;          // int16x2
+        T_UINT glintTexturePacked; // glintTexture in the high, material flags in the low 16 bits
+        T_FLOAT albedoEmission;
+    };
 #ifdef __cplusplus
 }; // namespace VertexFormat
 #endif
@@ -350,6 +363,19 @@ namespace Data {
         T_FLOAT brightnessFactor;
         T_FLOAT pad0;
     };
+
+    // one entity geometry whose game vertices are expanded on the gpu
+    struct EntityExpandJob {
+        T_UINT srcWord;     // first 4 byte word in the raw vertex buffer
+        T_UINT format;      // World::VertexFormats
+        T_UINT firstThread; // prefix sum of vertex counts over the jobs
+        T_UINT vertexCount;
+
+        T_UINT dstVertex; // into the vertex, position and material streams
+        T_UINT textureID;
+        T_UINT coordinate;
+        T_UINT normalOffset;
+    };
 #ifdef __cplusplus
 }; // namespace Data
 #endif
@@ -41,3 +41,93 @@ JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetChunkBui
     Renderer::options.chunkBuildingTotalBatches = chunkBuildingTotalBatches;
     if (write) Renderer::instance().world()->chunks()->resetScheduler();
 }
+
+extern "C" {
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetChunkCompactionDelay(
+    JNIEnv *, jclass, jint chunkCompactionDelay, jboolean write) {
+    Renderer::options.chunkCompactionDelay = chunkCompactionDelay;
+    if (write) Renderer::instance().world()->chunks()->resetCompactor();
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetChunkCompactionBatchSize(
+    JNIEnv *, jclass, jint chunkCompactionBatchSize, jboolean write) {
+    Renderer::options.chunkCompactionBatchSize = chunkCompactionBatchSize;
+    if (write) Renderer::instance().world()->chunks()->resetCompactor();
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetChunkHalfPositionBLAS(
+    JNIEnv *, jclass, jboolean chunkHalfPositionBLAS, jboolean write) {
+    // chunks built before keep the BLAS input they were built with
+    Renderer::options.chunkHalfPositionBLAS = chunkHalfPositionBLAS;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetChunkBuildingThreads(
+    JNIEnv *, jclass, jint chunkBuildingThreads, jboolean write) {
+    Renderer::options.chunkBuildingThreads = chunkBuildingThreads;
+    if (write) Renderer::instance().world()->chunks()->resetWorkers();
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetTlasMaxRefits(
+    JNIEnv *, jclass, jint tlasMaxRefits, jboolean write) {
+    Renderer::options.tlasMaxRefits = tlasMaxRefits;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetGpuProfiler(JNIEnv *,
+                                                                                    jclass,
+                                                                                    jboolean gpuProfiler,
+                                                                                    jboolean write) {
+    Renderer::options.gpuProfiler = gpuProfiler;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetChunkDefragmentationBudget(
+    JNIEnv *, jclass, jint chunkDefragmentationBudget, jboolean write) {
+    Renderer::options.chunkDefragmentationBudget = chunkDefragmentationBudget;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetChunkRetainCpuGeometry(
+    JNIEnv *, jclass, jboolean chunkRetainCpuGeometry, jboolean write) {
+    Renderer::options.chunkRetainCpuGeometry = chunkRetainCpuGeometry;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetPackedMaterialVertex(
+    JNIEnv *, jclass, jboolean packedMaterialVertex, jboolean write) {
+    // picked up by the next pipeline build, which drops the chunks built in the other layout
+    Renderer::options.packedMaterialVertex = packedMaterialVertex;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetEntityBLASMaxRefits(
+    JNIEnv *, jclass, jint entityBLASMaxRefits, jboolean write) {
+    Renderer::options.entityBLASMaxRefits = entityBLASMaxRefits;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetGpuEntityVertexExpansion(
+    JNIEnv *, jclass, jboolean gpuEntityVertexExpansion, jboolean write) {
+    Renderer::options.gpuEntityVertexExpansion = gpuEntityVertexExpansion;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetTlasCullDistance(
+    JNIEnv *, jclass, jint tlasCullDistance, jboolean write) {
+    Renderer::options.tlasCullDistance = tlasCullDistance;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetTlasCullMargin(
+    JNIEnv *, jclass, jint tlasCullMargin, jboolean write) {
+    Renderer::options.tlasCullMargin = tlasCullMargin;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetChunkLodDistance(
+    JNIEnv *, jclass, jint chunkLodDistance, jboolean write) {
+    // chunks built while it was 0 have no LOD until they are rebuilt
+    Renderer::options.chunkLodDistance = chunkLodDistance;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetChunkLodMemoryBudget(
+    JNIEnv *, jclass, jint chunkLodMemoryBudget, jboolean write) {
+    Renderer::options.chunkLodMemoryBudget = chunkLodMemoryBudget;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_option_Options_nativeSetChunkLodBuildBudget(
+    JNIEnv *, jclass, jint chunkLodBuildBudget, jboolean write) {
+    Renderer::options.chunkLodBuildBudget = chunkLodBuildBudget;
+}
+}
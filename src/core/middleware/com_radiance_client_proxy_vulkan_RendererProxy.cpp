@@ -140,18 +140,21 @@ JNIEXPORT jint JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_maxSu
 JNIEXPORT void JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_acquireContext(JNIEnv *, jclass) {
     auto framework = Renderer::instance().framework();
     if (framework == nullptr) return;
+    framework->inputCapture()->recordCall(InputCapture::Record::AcquireContext);
     framework->acquireContext();
 }
 
 JNIEXPORT void JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_submitCommand(JNIEnv *, jclass) {
     auto framework = Renderer::instance().framework();
     if (framework == nullptr) return;
+    framework->inputCapture()->recordCall(InputCapture::Record::SubmitCommand);
     framework->submitCommand();
 }
 
 JNIEXPORT void JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_present(JNIEnv *, jclass) {
     auto framework = Renderer::instance().framework();
     if (framework == nullptr) return;
+    framework->inputCapture()->recordCall(InputCapture::Record::Present);
     framework->present();
 }
 
@@ -171,6 +174,7 @@ JNIEXPORT void JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_drawO
 JNIEXPORT void JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_fuseWorld(JNIEnv *, jclass) {
     auto framework = Renderer::instance().framework();
     if (framework == nullptr) return;
+    framework->inputCapture()->recordCall(InputCapture::Record::FuseWorld);
     auto context = framework->safeAcquireCurrentContext();
     auto pipelineContext = framework->pipeline()->acquirePipelineContext(context);
     pipelineContext->fuseWorld();
@@ -196,6 +200,7 @@ JNIEXPORT void JNICALL
 Java_com_radiance_client_proxy_vulkan_RendererProxy_shouldRenderWorld(JNIEnv *, jclass, jboolean shouldRenderWorld) {
     auto world = Renderer::instance().world();
     if (world == nullptr) return;
+    Renderer::instance().framework()->inputCapture()->recordShouldRenderWorld(shouldRenderWorld);
     world->shouldRender() = shouldRenderWorld;
 }
 
@@ -205,3 +210,78 @@ JNIEXPORT void JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_takeS
     if (framework == nullptr) return;
     framework->takeScreenshot(withUI, width, height, channel, reinterpret_cast<void *>(pointer));
 }
+
+extern "C" {
+// names of the profiled scopes, in the same order as the values returned by gpuTimings
+JNIEXPORT jobjectArray JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_gpuTimingNames(JNIEnv *env,
+                                                                                                  jclass) {
+    auto framework = Renderer::instance().framework();
+    std::vector<GpuTiming> timings;
+    if (framework != nullptr) timings = framework->gpuProfiler()->timings();
+
+    jobjectArray names =
+        env->NewObjectArray(static_cast<jsize>(timings.size()), env->FindClass("java/lang/String"), nullptr);
+    for (jsize i = 0; i < timings.size(); i++) {
+        jstring name = env->NewStringUTF(timings[i].name.c_str());
+        env->SetObjectArrayElement(names, i, name);
+        env->DeleteLocalRef(name);
+    }
+    return names;
+}
+
+// last, average and max milliseconds of every profiled scope, three values per scope
+JNIEXPORT jdoubleArray JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_gpuTimings(JNIEnv *env, jclass) {
+    auto framework = Renderer::instance().framework();
+    std::vector<GpuTiming> timings;
+    if (framework != nullptr) timings = framework->gpuProfiler()->timings();
+
+    std::vector<jdouble> values;
+    for (const auto &timing : timings) {
+        values.push_back(timing.lastMilliseconds);
+        values.push_back(timing.averageMilliseconds);
+        values.push_back(timing.maxMilliseconds);
+    }
+
+    jdoubleArray result = env->NewDoubleArray(static_cast<jsize>(values.size()));
+    env->SetDoubleArrayRegion(result, 0, static_cast<jsize>(values.size()), values.data());
+    return result;
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_resetFrameStats(JNIEnv *, jclass) {
+    auto framework = Renderer::instance().framework();
+    if (framework == nullptr) return;
+    framework->frameStats()->reset();
+}
+
+// json with frame time percentiles, chunk build throughput, memory high water mark and gpu timings since the last reset
+JNIEXPORT jstring JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_frameStatsReport(JNIEnv *env, jclass) {
+    auto framework = Renderer::instance().framework();
+    if (framework == nullptr) return env->NewStringUTF("{}");
+    return env->NewStringUTF(framework->frameStats()->report().c_str());
+}
+
+// records the chunk, entity, camera, option and frame calls to path until stopInputCapture or close
+JNIEXPORT jboolean JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_startInputCapture(JNIEnv *env,
+                                                                                                 jclass,
+                                                                                                 jstring path) {
+    auto framework = Renderer::instance().framework();
+    if (framework == nullptr || path == NULL) return false;
+    return framework->inputCapture()->start(JStringToPath(env, path));
+}
+
+JNIEXPORT void JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_stopInputCapture(JNIEnv *, jclass) {
+    auto framework = Renderer::instance().framework();
+    if (framework == nullptr) return;
+    framework->inputCapture()->stop();
+}
+
+// plays a capture on the render thread between two frames, returns the frame stats report of the replay or {}
+JNIEXPORT jstring JNICALL Java_com_radiance_client_proxy_vulkan_RendererProxy_replayInputCapture(JNIEnv *env,
+                                                                                                 jclass,
+                                                                                                 jstring path) {
+    auto framework = Renderer::instance().framework();
+    if (framework == nullptr || path == NULL) return env->NewStringUTF("{}");
+    if (!InputReplay::create(JStringToPath(env, path))->run()) return env->NewStringUTF("{}");
+    return env->NewStringUTF(framework->frameStats()->report().c_str());
+}
+}
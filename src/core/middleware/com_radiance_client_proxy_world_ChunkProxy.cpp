@@ -1,11 +1,13 @@
 #include "com_radiance_client_proxy_world_ChunkProxy.h"
 
 #include "core/render/chunks.hpp"
+#include "core/render/render_framework.hpp"
 #include "core/render/renderer.hpp"
 
 #include <iostream>
 
 JNIEXPORT void JNICALL Java_com_radiance_client_proxy_world_ChunkProxy_initNative(JNIEnv *, jclass, jint chunkNum) {
+    Renderer::instance().framework()->inputCapture()->recordChunkReset(chunkNum);
     Renderer::instance().world()->chunks()->reset(chunkNum);
 }
 
@@ -25,7 +27,7 @@ JNIEXPORT void JNICALL Java_com_radiance_client_proxy_world_ChunkProxy_rebuildSi
                                                                                      jboolean important) {
     auto world = Renderer::instance().world();
     if (world == nullptr) return;
-    world->chunks()->queueChunkBuild(ChunkBuildTask{
+    ChunkBuildTask task{
         .x = originX,
         .y = originY,
         .z = originZ,
@@ -38,7 +40,9 @@ JNIEXPORT void JNICALL Java_com_radiance_client_proxy_world_ChunkProxy_rebuildSi
         .vertexCounts = reinterpret_cast<int *>(vertexCounts),
         .vertices = reinterpret_cast<vk::VertexFormat::PBRVertex **>(vertexAddrs),
         .isImportant = static_cast<bool>(important),
-    });
+    };
+    Renderer::instance().framework()->inputCapture()->recordChunkBuild(task);
+    world->chunks()->queueChunkBuild(task);
 }
 
 JNIEXPORT jboolean JNICALL Java_com_radiance_client_proxy_world_ChunkProxy_isChunkReady(JNIEnv *, jclass, jlong id) {
@@ -52,5 +56,6 @@ JNIEXPORT jboolean JNICALL Java_com_radiance_client_proxy_world_ChunkProxy_isChu
 JNIEXPORT void JNICALL Java_com_radiance_client_proxy_world_ChunkProxy_invalidateSingle(JNIEnv *, jclass, jlong index) {
     auto world = Renderer::instance().world();
     if (world == nullptr) return;
+    Renderer::instance().framework()->inputCapture()->recordChunkInvalidate(index);
     world->chunks()->invalidateChunk(index);
 }
@@ -1,6 +1,7 @@
 #include "com_radiance_client_proxy_world_EntityProxy.h"
 
 #include "core/render/entities.hpp"
+#include "core/render/render_framework.hpp"
 #include "core/render/renderer.hpp"
 
 JNIEXPORT void JNICALL Java_com_radiance_client_proxy_world_EntityProxy_queueBuild(JNIEnv *,
@@ -26,7 +27,7 @@ JNIEXPORT void JNICALL Java_com_radiance_client_proxy_world_EntityProxy_queueBui
                                                                                    jlong vertices) {
     auto world = Renderer::instance().world();
     if (world == nullptr) return;
-    world->entities()->queueBuild(EntitiesBuildTask{
+    EntitiesBuildTask task{
         .lineWidth = lineWidth,
         .coordinate = static_cast<World::Coordinates>(coordinate),
         .normalOffset = static_cast<bool>(normalOffset),
@@ -46,11 +47,14 @@ JNIEXPORT void JNICALL Java_com_radiance_client_proxy_world_EntityProxy_queueBui
         .indexFormats = reinterpret_cast<int *>(indexFormats),
         .vertexCounts = reinterpret_cast<int *>(vertexCounts),
         .vertices = reinterpret_cast<void **>(vertices),
-    });
+    };
+    Renderer::instance().framework()->inputCapture()->recordEntityQueueBuild(task);
+    world->entities()->queueBuild(task);
 }
 
 JNIEXPORT void JNICALL Java_com_radiance_client_proxy_world_EntityProxy_build(JNIEnv *, jclass) {
     auto world = Renderer::instance().world();
     if (world == nullptr) return;
+    Renderer::instance().framework()->inputCapture()->recordCall(InputCapture::Record::EntityBuild);
     world->entities()->build();
 }
@@ -23,6 +23,13 @@ Buffers::Buffers(std::shared_ptr<Framework> framework) {
 
     validOverlayIndex_.resize(size);
     overlayIndexVertexBuffer_.resize(size);
+    overlayQuadIndexIds_.resize(size);
+    overlayStagedUploads_.resize(size);
+
+    overlayQuadIndices16_ =
+        vk::QuadIndexBuffer::create(framework->vma(), framework->device(), VK_INDEX_TYPE_UINT16, overlayQuadCount);
+    overlayQuadIndices32_ =
+        vk::QuadIndexBuffer::create(framework->vma(), framework->device(), VK_INDEX_TYPE_UINT32, overlayQuadCount);
 
     overlayDrawUniformBuffer_.resize(size);
     overlayPostUniformBuffer_.resize(size);
@@ -41,6 +48,8 @@ void Buffers::resetFrame() {
     auto &gc = framework->gc();
 
     validOverlayIndex_[context->frameIndex].clear();
+    overlayQuadIndexIds_[context->frameIndex].clear();
+    overlayStagedUploads_[context->frameIndex].clear();
 
     overlayNextID_ = 0;
 
@@ -52,6 +61,9 @@ void Buffers::resetFrame() {
 
     gc.collect(importantIndexVertexBuffer_);
     importantIndexVertexBuffer_ = std::make_shared<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>>();
+
+    gc.collect(importantGeometryStaging_);
+    importantGeometryStaging_ = std::make_shared<std::vector<std::shared_ptr<vk::GeometryStaging>>>();
 }
 
 uint32_t Buffers::allocateBuffer() {
@@ -83,6 +95,8 @@ void Buffers::initializeBuffer(uint32_t id, uint32_t size, VkBufferUsageFlags us
     }
 
     validOverlayIndex_[context->frameIndex].at(id) = size;
+    overlayQuadIndexIds_[context->frameIndex].erase(id);
+    overlayStagedUploads_[context->frameIndex].erase(id);
 
     auto buffer = overlayIndexVertexBuffer_[context->frameIndex].contains(id) ?
                       overlayIndexVertexBuffer_[context->frameIndex].at(id) :
@@ -92,16 +106,23 @@ void Buffers::initializeBuffer(uint32_t id, uint32_t size, VkBufferUsageFlags us
     if (buffer == nullptr || currentSize != buffer->size()) {
         framework->gc().collect(buffer);
         overlayIndexVertexBuffer_[context->frameIndex].at(id) =
-            vk::DeviceLocalBuffer::create(vma, device, currentSize, usageFlags);
+            vk::DeviceLocalBuffer::create(vma, device, false, currentSize, usageFlags);
     }
 }
 
 void Buffers::buildIndexBuffer(uint32_t dstId, int type, int drawMode, int vertexCount, int expectedIndexCount) {
     std::unique_lock<std::recursive_mutex> lck(mtx_);
-    auto buildQuadIndices = [this, dstId, vertexCount, expectedIndexCount]<typename V>() {
+    auto buildQuadIndices = [this, dstId, type, vertexCount, expectedIndexCount]<typename V>() {
         int indexCount = vertexCount / 4 * 6;
         if (indexCount != expectedIndexCount) { throw std::runtime_error("index count not match!"); }
 
+        auto quadIndices = overlayQuadIndices(type);
+        if (vertexCount / 4 <= static_cast<int>(quadIndices->quadCount())) {
+            auto frameIndex = Renderer::instance().framework()->safeAcquireCurrentContext()->frameIndex;
+            overlayQuadIndexIds_[frameIndex][dstId] = quadIndices;
+            return;
+        }
+
         std::vector<V> indices;
         for (int i = 0; i < vertexCount; i += 4) {
             indices.push_back(i + 0);
@@ -137,13 +158,20 @@ void Buffers::buildIndexBuffer(uint32_t dstId, int type, int drawMode, int verte
     }
 }
 
+std::shared_ptr<vk::QuadIndexBuffer> Buffers::overlayQuadIndices(int type) {
+    return type == 0 ? overlayQuadIndices16_ : overlayQuadIndices32_;
+}
+
 void Buffers::queueOverlayUpload(uint8_t *srcPointer, uint32_t dstId) {
     std::unique_lock<std::recursive_mutex> lck(mtx_);
-    auto context = Renderer::instance().framework()->safeAcquireCurrentContext();
+    auto framework = Renderer::instance().framework();
+    auto context = framework->safeAcquireCurrentContext();
     auto buffer = overlayIndexVertexBuffer_[context->frameIndex].at(dstId);
     if (validOverlayIndex_[context->frameIndex].contains(dstId) && buffer != nullptr) {
         auto size = validOverlayIndex_[context->frameIndex].at(dstId);
-        if (size > 0) { buffer->uploadToStagingBuffer(srcPointer, size, 0); }
+        if (size > 0) {
+            overlayStagedUploads_[context->frameIndex][dstId] = framework->stagingRing()->stage(srcPointer, size);
+        }
     }
 }
 
@@ -160,6 +188,11 @@ void Buffers::queueImportantWorldUpload(std::shared_ptr<vk::DeviceLocalBuffer> b
     importantIndexVertexBuffer_->push_back(buffer);
 }
 
+void Buffers::queueImportantWorldUpload(std::shared_ptr<vk::GeometryStaging> geometryStaging) {
+    if (geometryStaging == nullptr) return;
+    importantGeometryStaging_->push_back(geometryStaging);
+}
+
 void Buffers::performQueuedUpload() {
     auto frameIndex = Renderer::instance().framework()->safeAcquireCurrentContext()->frameIndex;
     std::shared_ptr<vk::CommandBuffer> cmdBuffer =
@@ -171,6 +204,7 @@ void Buffers::performQueuedUpload() {
     std::vector<vk::CommandBuffer::BufferMemoryBarrier> uploadPreBufferBarriers, uploadPostBufferBarriers;
 
     for (auto [bufferId, size] : validOverlayIndex_[frameIndex]) {
+        if (overlayQuadIndexIds_[frameIndex].contains(bufferId)) continue;
         auto buffer = overlayIndexVertexBuffer_[frameIndex].at(bufferId);
         uploadPreBufferBarriers.push_back({
             .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
@@ -217,16 +251,50 @@ void Buffers::performQueuedUpload() {
         });
     }
 
+    // uploaded once with the first frame, never written again
+    std::vector<std::shared_ptr<vk::QuadIndexBuffer>> pendingQuadIndices;
+    for (auto quadIndices : {overlayQuadIndices16_, overlayQuadIndices32_}) {
+        if (quadIndices->uploaded()) continue;
+        pendingQuadIndices.push_back(quadIndices);
+        uploadPostBufferBarriers.push_back({
+            .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT,
+            .dstAccessMask = VK_ACCESS_2_INDEX_READ_BIT,
+            .srcQueueFamilyIndex = mainQueueIndex,
+            .dstQueueFamilyIndex = mainQueueIndex,
+            .buffer = quadIndices->buffer(),
+        });
+    }
+
     cmdBuffer->barriersBufferImage(uploadPreBufferBarriers, {});
 
-    for (auto [bufferId, size] : validOverlayIndex_[frameIndex]) {
+    for (auto &[bufferId, range] : overlayStagedUploads_[frameIndex]) {
+        if (overlayQuadIndexIds_[frameIndex].contains(bufferId)) continue;
         auto buffer = overlayIndexVertexBuffer_[frameIndex].at(bufferId);
-        if (size > 0) { buffer->uploadToBuffer(cmdBuffer, size, 0, 0); }
+        Renderer::instance().framework()->stagingRing()->copy(cmdBuffer, range, buffer->vkBuffer());
+    }
+
+    for (auto quadIndices : pendingQuadIndices) {
+        Renderer::instance().framework()->gc().collect(quadIndices->uploadToBuffer(cmdBuffer));
     }
 
     for (auto buffer : *importantIndexVertexBuffer_) { buffer->uploadToBuffer(cmdBuffer); }
 
+    // arena ranges are fresh or were released by the gc, so only the copies need to be made visible
+    for (auto geometryStaging : *importantGeometryStaging_) { geometryStaging->uploadToBuffer(cmdBuffer); }
+
     cmdBuffer->barriersBufferImage(uploadPostBufferBarriers, {});
+    if (!importantGeometryStaging_->empty()) {
+        cmdBuffer->barriersMemory({vk::CommandBuffer::MemoryBarrier{
+            .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+                            VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR |
+                            VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+            .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+        }});
+    }
 }
 
 void Buffers::appendOverlayDrawUniform(vk::Data::OverlayUBO &ubo) {
@@ -457,6 +525,9 @@ int Buffers::getPostID() {
 std::shared_ptr<vk::DeviceLocalBuffer> Buffers::getBuffer(uint32_t id) {
     auto context = Renderer::instance().framework()->safeAcquireCurrentContext();
 
+    auto quadIter = overlayQuadIndexIds_[context->frameIndex].find(id);
+    if (quadIter != overlayQuadIndexIds_[context->frameIndex].end()) return quadIter->second->buffer();
+
     auto bufferIter = overlayIndexVertexBuffer_[context->frameIndex].find(id);
     if (!validOverlayIndex_[context->frameIndex].contains(id) ||
         bufferIter == overlayIndexVertexBuffer_[context->frameIndex].end()) {
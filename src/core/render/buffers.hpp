@@ -4,6 +4,7 @@
 #include "common/shared.hpp"
 #include "common/singleton.hpp"
 #include "core/all_extern.hpp"
+#include "core/render/staging_ring.hpp"
 #include "core/vulkan/all_core_vulkan.hpp"
 
 #include <map>
@@ -24,6 +25,7 @@ class Buffers : public SharedObject<Buffers> {
     void queueImportantWorldUpload(std::shared_ptr<vk::DeviceLocalBuffer> buffer);
     void queueImportantWorldUpload(std::shared_ptr<vk::DeviceLocalBuffer> vertexBuffer,
                                    std::shared_ptr<vk::DeviceLocalBuffer> indexBuffer);
+    void queueImportantWorldUpload(std::shared_ptr<vk::GeometryStaging> geometryStaging);
     void performQueuedUpload();
 
     void appendOverlayDrawUniform(vk::Data::OverlayUBO &ubo);
@@ -55,9 +57,19 @@ class Buffers : public SharedObject<Buffers> {
 
   private:
     static constexpr uint32_t baseBlockSize = 16 * 1024;
+    // every quad a 16 bit index can address, larger 32 bit draws build their own indices
+    static constexpr uint32_t overlayQuadCount = 65536 / 4;
+
+    std::shared_ptr<vk::QuadIndexBuffer> overlayQuadIndices(int type);
 
     std::vector<std::map<uint32_t, int32_t>> validOverlayIndex_;
     std::vector<std::map<uint32_t, std::shared_ptr<vk::DeviceLocalBuffer>>> overlayIndexVertexBuffer_;
+    // index buffer ids that resolve to the shared quad indices this frame
+    std::vector<std::map<uint32_t, std::shared_ptr<vk::QuadIndexBuffer>>> overlayQuadIndexIds_;
+    // contents queued this frame, already copied into the staging ring
+    std::vector<std::map<uint32_t, StagingRange>> overlayStagedUploads_;
+    std::shared_ptr<vk::QuadIndexBuffer> overlayQuadIndices16_;
+    std::shared_ptr<vk::QuadIndexBuffer> overlayQuadIndices32_;
     std::vector<std::shared_ptr<vk::HostVisibleBuffer>> overlayDrawUniformBuffer_;
     std::vector<std::shared_ptr<vk::HostVisibleBuffer>> overlayPostUniformBuffer_;
     uint32_t overlayNextID_;
@@ -73,6 +85,7 @@ class Buffers : public SharedObject<Buffers> {
     std::vector<std::shared_ptr<vk::HostVisibleBuffer>> lightMapUniformBuffer_;
 
     std::shared_ptr<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>> importantIndexVertexBuffer_;
+    std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryStaging>>> importantGeometryStaging_;
 
     bool useJitter_ = true;
     std::recursive_mutex mtx_;
@@ -0,0 +1,63 @@
+#include "core/render/chunk_workers.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+std::ostream &chunkWorkersCout() {
+    return std::cout << "[Chunk Workers] ";
+}
+
+ChunkBuildWorkers::ChunkBuildWorkers(uint32_t workerCount, Process process)
+    : process_(std::move(process)), queue_(4096) {
+    if (workerCount == 0) { workerCount = std::max(1u, std::thread::hardware_concurrency() / 4); }
+
+    for (uint32_t i = 0; i < workerCount; i++) { workers_.emplace_back(&ChunkBuildWorkers::workerLoop, this); }
+
+#ifdef DEBUG
+    chunkWorkersCout() << "started " << workerCount << " chunk build workers" << std::endl;
+#endif
+}
+
+ChunkBuildWorkers::~ChunkBuildWorkers() {
+    // queued jobs are still processed, the process callback is expected to drop stale ones cheaply
+    stopping_ = true;
+    available_.release(static_cast<std::ptrdiff_t>(workers_.size()));
+    for (auto &worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+void ChunkBuildWorkers::submit(std::shared_ptr<ChunkBuildData> data) {
+    pending_++;
+    if (!queue_.tryPush(data)) {
+        process_(data);
+        pending_--;
+        return;
+    }
+    available_.release();
+}
+
+uint32_t ChunkBuildWorkers::workerCount() {
+    return static_cast<uint32_t>(workers_.size());
+}
+
+uint32_t ChunkBuildWorkers::pendingCount() {
+    return pending_;
+}
+
+void ChunkBuildWorkers::workerLoop() {
+    while (true) {
+        available_.acquire();
+
+        // every non stop token belongs to a published job, it may sit behind a slot another producer is still
+        // filling so retry instead of dropping the token
+        std::shared_ptr<ChunkBuildData> data;
+        while (!queue_.tryPop(data)) {
+            if (stopping_) return;
+            std::this_thread::yield();
+        }
+
+        process_(data);
+        pending_--;
+    }
+}
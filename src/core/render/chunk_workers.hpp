@@ -0,0 +1,41 @@
+#pragma once
+
+#include "common/mpmc_queue.hpp"
+#include "core/all_extern.hpp"
+
+#include <atomic>
+#include <functional>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+struct ChunkBuildData;
+
+// Fixed size pool doing the CPU side of chunk builds (index generation, vertex conversion, staging and BLAS setup)
+// away from the JNI and render threads. Jobs travel through a lock-free queue, the scheduler only records GPU work
+// for the finished ChunkBuildData.
+class ChunkBuildWorkers : public SharedObject<ChunkBuildWorkers> {
+  public:
+    using Process = std::function<void(std::shared_ptr<ChunkBuildData>)>;
+
+    // workerCount 0 picks a quarter of the hardware threads
+    ChunkBuildWorkers(uint32_t workerCount, Process process);
+    ~ChunkBuildWorkers();
+
+    // runs the job on the calling thread when the queue is full
+    void submit(std::shared_ptr<ChunkBuildData> data);
+
+    uint32_t workerCount();
+    uint32_t pendingCount();
+
+  private:
+    void workerLoop();
+
+  private:
+    Process process_;
+    MPMCQueue<std::shared_ptr<ChunkBuildData>> queue_;
+    std::counting_semaphore<> available_{0};
+    std::atomic<bool> stopping_ = false;
+    std::atomic<uint32_t> pending_ = 0;
+    std::vector<std::thread> workers_;
+};
@@ -8,6 +8,12 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <iostream>
+#include <limits>
+
+std::ostream &chunksCout() {
+    return std::cout << "[Chunks] ";
+}
 
 ChunkBuildData::ChunkBuildData(int64_t id,
                                int x,
@@ -18,9 +24,8 @@ ChunkBuildData::ChunkBuildData(int64_t id,
                                uint32_t allIndexCount,
                                uint32_t geometryCount,
                                std::vector<World::GeometryTypes> &&geometryTypes,
-                               std::vector<std::string> &&geometryGroupNames,
-                               std::vector<std::vector<vk::VertexFormat::PBRVertex>> &&vertices,
-                               std::vector<std::vector<uint32_t>> &&indices)
+                               std::vector<uint32_t> &&geometryGroups,
+                               std::vector<std::vector<vk::VertexFormat::PBRVertex>> &&vertices)
     : id(id),
       x(x),
       y(y),
@@ -30,91 +35,283 @@ ChunkBuildData::ChunkBuildData(int64_t id,
       allIndexCount(allIndexCount),
       geometryCount(geometryCount),
       geometryTypes(std::move(geometryTypes)),
-      geometryGroupNames(std::move(geometryGroupNames)),
+      geometryGroups(std::move(geometryGroups)),
       vertices(std::move(vertices)),
-      indices(std::move(indices)),
       blas(nullptr),
       blasBuilder(nullptr) {}
 
-void ChunkBuildData::build() {
+void ChunkBuildLatency::record(std::chrono::steady_clock::duration duration) {
+    uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    count++;
+    totalMicroseconds += microseconds;
+
+    uint64_t currentMax = maxMicroseconds.load();
+    while (microseconds > currentMax && !maxMicroseconds.compare_exchange_weak(currentMax, microseconds)) {}
+}
+
+void ChunkCompactionStats::record(VkDeviceSize originalSize, VkDeviceSize compactedSize) {
+    compacted++;
+    originalBytes += originalSize;
+    compactedBytes += compactedSize;
+
+    if (originalSize == 0) return;
+    VkDeviceSize savedSize = originalSize - std::min(compactedSize, originalSize);
+    int bucket = static_cast<int>(savedSize * histogramBuckets / originalSize);
+    savedHistogram[std::min(bucket, histogramBuckets - 1)]++;
+}
+
+void ChunkBuildStats::print() {
+    auto printLatency = [](const char *name, ChunkBuildLatency &latency) {
+        uint64_t count = latency.count;
+        if (count == 0) return;
+        chunksCout() << "  " << name << ": " << count << " builds, avg " << latency.totalMicroseconds / count / 1000.0
+                     << " ms, max " << latency.maxMicroseconds / 1000.0 << " ms" << std::endl;
+    };
+
+    if (index.count == 0) return;
+
+    chunksCout() << "chunk build latency:" << std::endl;
+    printLatency("queue", queue);
+    printLatency("index", index);
+    printLatency("buffer", buffer);
+    printLatency("schedule", schedule);
+    printLatency("gpu", gpu);
+    printLatency("lod", lod);
+}
+
+void ChunkBuildData::prepare() {
+    allIndexCount = 0;
+    for (int i = 0; i < geometryCount; i++) { allIndexCount += vk::QuadIndexBuffer::indexCount(vertices[i].size()); }
+}
+
+uint32_t ChunkBuildData::quadCount() {
+    size_t maxVertexCount = 0;
+    for (const auto &geometryVertices : vertices) {
+        maxVertexCount = std::max(maxVertexCount, geometryVertices.size());
+    }
+    return static_cast<uint32_t>(maxVertexCount / 4);
+}
+
+ChunkLod::~ChunkLod() {
+    residentBytes -= bytes;
+}
+
+void ChunkBuildData::build(std::shared_ptr<vk::GeometryArena> geometryArena,
+                           std::shared_ptr<vk::QuadIndexBuffer> quadIndices,
+                           bool buildLod) {
+    this->quadIndices = quadIndices;
+
     auto framework = Renderer::instance().framework();
     auto vma = framework->vma();
     auto device = framework->device();
     auto physicalDevice = framework->physicalDevice();
 
+    std::vector<std::vector<vk::VertexFormat::PositionVertex>> positionVertices(geometryCount);
+    std::vector<std::vector<uint8_t>> materialStreams(geometryCount);
+    bool packedMaterial = Renderer::instance().world()->packedMaterialVertex();
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    for (int i = 0; i < geometryCount; i++) {
+        positionVertices[i] = vk::Vertex::buildPositionVertices(vertices[i]);
+        materialStreams[i] = vk::Vertex::buildMaterialStream(vertices[i], packedMaterial);
+        for (const auto &vertex : vertices[i]) {
+            boundsMin = glm::min(boundsMin, vertex.pos);
+            boundsMax = glm::max(boundsMax, vertex.pos);
+        }
+    }
+    if (allVertexCount == 0) { boundsMin = boundsMax = glm::vec3(0.0f); }
+
+    // the BLAS reads the 16 byte position stream, or an 8 byte half stream when every position survives the
+    // conversion unchanged
+    bool useHalfPositions = Renderer::options.chunkHalfPositionBLAS &&
+                            physicalDevice->supportsAccelerationStructureVertexFormat(VK_FORMAT_R16G16B16A16_SFLOAT);
+    std::vector<std::vector<vk::HalfPositionVertex>> halfPositionVertices(geometryCount);
+    for (int i = 0; i < geometryCount && useHalfPositions; i++) {
+        useHalfPositions = vk::Vertex::buildHalfPositionVertices(vertices[i], halfPositionVertices[i]);
+    }
+
+    // merged faces for tracing from afar, only worth their memory when they drop a good part of the quads
+    std::vector<uint32_t> lodGeometries;
+    std::vector<std::vector<vk::VertexFormat::PBRVertex>> lodVertices;
+    std::vector<std::vector<vk::VertexFormat::PositionVertex>> lodPositionVertices;
+    std::vector<std::vector<uint8_t>> lodMaterialStreams;
+    if (buildLod) {
+        auto lodBeginTime = std::chrono::steady_clock::now();
+        size_t lodVertexCount = 0;
+        for (int i = 0; i < geometryCount; i++) {
+            auto merged = vk::Vertex::mergeCoplanarQuads(vertices[i]);
+            if (merged.empty()) continue;
+            lodVertexCount += merged.size();
+            lodGeometries.push_back(i);
+            lodVertices.push_back(std::move(merged));
+        }
+        if (lodVertexCount * 4 > static_cast<size_t>(allVertexCount) * 3) {
+            lodGeometries.clear();
+            lodVertices.clear();
+        }
+        for (const auto &geometryVertices : lodVertices) {
+            lodPositionVertices.push_back(vk::Vertex::buildPositionVertices(geometryVertices));
+            lodMaterialStreams.push_back(vk::Vertex::buildMaterialStream(geometryVertices, packedMaterial));
+        }
+        lodBuildTime = std::chrono::steady_clock::now() - lodBeginTime;
+    }
+
+    VkDeviceSize stagingSize = 0;
+    for (int i = 0; i < geometryCount; i++) {
+        stagingSize += vertices[i].size() * sizeof(vk::VertexFormat::PBRVertex);
+        stagingSize += positionVertices[i].size() * sizeof(vk::VertexFormat::PositionVertex);
+        stagingSize += materialStreams[i].size();
+        if (useHalfPositions) stagingSize += halfPositionVertices[i].size() * sizeof(vk::HalfPositionVertex);
+    }
+    for (int i = 0; i < lodVertices.size(); i++) {
+        stagingSize += lodVertices[i].size() * sizeof(vk::VertexFormat::PBRVertex);
+        stagingSize += lodPositionVertices[i].size() * sizeof(vk::VertexFormat::PositionVertex);
+        stagingSize += lodMaterialStreams[i].size();
+    }
+    geometryStaging = vk::GeometryStaging::create(vma, device, stagingSize);
+
     for (int i = 0; i < geometryCount; i++) {
-        auto vertexBuffer =
-            vk::DeviceLocalBuffer::create(vma, device, vertices[i].size() * sizeof(vk::VertexFormat::PBRVertex),
-                                          VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-                                              VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
-                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-        vertexBuffer->uploadToStagingBuffer(vertices[i].data());
+        auto vertexBuffer = geometryArena->allocate(vertices[i].size() * sizeof(vk::VertexFormat::PBRVertex));
+        geometryStaging->write(vertexBuffer, vertices[i].data());
         vertexBuffers.push_back(vertexBuffer);
 
-        auto indexBuffer =
-            vk::DeviceLocalBuffer::create(vma, device, indices[i].size() * sizeof(uint32_t),
-                                          VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-                                              VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
-                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-        indexBuffer->uploadToStagingBuffer(indices[i].data());
-        indexBuffers.push_back(indexBuffer);
-
-        auto positionVertices = vk::Vertex::buildPositionVertices(vertices[i]);
-        auto positionBuffer = vk::DeviceLocalBuffer::create(
-            vma, device, positionVertices.size() * sizeof(vk::VertexFormat::PositionVertex),
-            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-        positionBuffer->uploadToStagingBuffer(positionVertices.data());
+        auto positionBuffer =
+            geometryArena->allocate(positionVertices[i].size() * sizeof(vk::VertexFormat::PositionVertex));
+        geometryStaging->write(positionBuffer, positionVertices[i].data());
         positionBuffers.push_back(positionBuffer);
 
-        auto materialVertices = vk::Vertex::buildMaterialVertices(vertices[i]);
-        auto materialBuffer = vk::DeviceLocalBuffer::create(
-            vma, device, materialVertices.size() * sizeof(vk::VertexFormat::MaterialVertex),
-            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-        materialBuffer->uploadToStagingBuffer(materialVertices.data());
+        auto materialBuffer = geometryArena->allocate(materialStreams[i].size());
+        geometryStaging->write(materialBuffer, materialStreams[i].data());
         materialBuffers.push_back(materialBuffer);
     }
 
+    if (useHalfPositions) {
+        for (int i = 0; i < geometryCount; i++) {
+            auto blasInputBuffer =
+                geometryArena->allocate(halfPositionVertices[i].size() * sizeof(vk::HalfPositionVertex));
+            geometryStaging->write(blasInputBuffer, halfPositionVertices[i].data());
+            blasInputBuffers.push_back(blasInputBuffer);
+        }
+    }
+
     blasBuilder = vk::BLASBuilder::create();
     auto blasGeometryBuilder = blasBuilder->beginGeometries();
     for (int i = 0; i < geometryCount; i++) {
-        blasGeometryBuilder->defineTriangleGeomrtry<vk::VertexFormat::PBRVertex>(
-            vertexBuffers[i], vertices[i].size(), indexBuffers[i], indices[i].size(),
-            geometryTypes[i] == World::WORLD_SOLID);
+        if (useHalfPositions) {
+            blasGeometryBuilder->defineTriangleGeomrtry(
+                blasInputBuffers[i]->bufferAddress(), VK_FORMAT_R16G16B16A16_SFLOAT, sizeof(vk::HalfPositionVertex),
+                vertices[i].size(), quadIndices->bufferAddress(), vk::QuadIndexBuffer::indexCount(vertices[i].size()),
+                geometryTypes[i] == World::WORLD_SOLID);
+        } else {
+            blasGeometryBuilder->defineTriangleGeomrtry<vk::VertexFormat::PositionVertex>(
+                positionBuffers[i]->bufferAddress(), vertices[i].size(), quadIndices->bufferAddress(),
+                vk::QuadIndexBuffer::indexCount(vertices[i].size()), geometryTypes[i] == World::WORLD_SOLID);
+        }
     }
     blasGeometryBuilder->endGeometries();
-    blas = blasBuilder->defineBuildProperty(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR)
+    blas = blasBuilder
+               ->defineBuildProperty(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR |
+                                     VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR)
                ->querySizeInfo(device)
                ->allocateBuffers(physicalDevice, device, vma)
                ->build(device);
+
+    if (lodVertices.empty()) return;
+
+    lod = ChunkLod::create();
+    lod->geometries = std::move(lodGeometries);
+    lod->vertexBuffers = std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>();
+    lod->positionBuffers = std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>();
+    lod->materialBuffers = std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>();
+    for (int i = 0; i < lodVertices.size(); i++) {
+        auto vertexBuffer = geometryArena->allocate(lodVertices[i].size() * sizeof(vk::VertexFormat::PBRVertex));
+        geometryStaging->write(vertexBuffer, lodVertices[i].data());
+        lod->vertexBuffers->push_back(vertexBuffer);
+
+        auto positionBuffer =
+            geometryArena->allocate(lodPositionVertices[i].size() * sizeof(vk::VertexFormat::PositionVertex));
+        geometryStaging->write(positionBuffer, lodPositionVertices[i].data());
+        lod->positionBuffers->push_back(positionBuffer);
+
+        auto materialBuffer = geometryArena->allocate(lodMaterialStreams[i].size());
+        geometryStaging->write(materialBuffer, lodMaterialStreams[i].data());
+        lod->materialBuffers->push_back(materialBuffer);
+
+        lod->vertexCounts.push_back(lodVertices[i].size());
+        lod->bytes += vertexBuffer->size() + positionBuffer->size() + materialBuffer->size();
+    }
+
+    lodBlasBuilder = vk::BLASBuilder::create();
+    auto lodGeometryBuilder = lodBlasBuilder->beginGeometries();
+    for (int i = 0; i < lodVertices.size(); i++) {
+        lodGeometryBuilder->defineTriangleGeomrtry<vk::VertexFormat::PositionVertex>(
+            (*lod->positionBuffers)[i]->bufferAddress(), lodVertices[i].size(), quadIndices->bufferAddress(),
+            vk::QuadIndexBuffer::indexCount(lodVertices[i].size()),
+            geometryTypes[lod->geometries[i]] == World::WORLD_SOLID);
+    }
+    lodGeometryBuilder->endGeometries();
+    // never compacted, traced often but only from afar
+    lod->blas = lodBlasBuilder->defineBuildProperty(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR)
+                    ->querySizeInfo(device)
+                    ->allocateBuffers(physicalDevice, device, vma)
+                    ->build(device);
+    lod->bytes += lod->blas->blasSize();
+    ChunkLod::residentBytes += lod->bytes;
+}
+
+void ChunkBuildQueue::insert(int64_t id, std::vector<std::shared_ptr<Chunk1>> &chunks) {
+    // scored against the cached camera and time, so it compares fairly with the chunks already queued
+    heap_.push(id, chunks[id]->buildFactor(bucketTime_, cameraPos_));
+}
+
+int64_t ChunkBuildQueue::pop(std::vector<std::shared_ptr<Chunk1>> &chunks, glm::vec3 cameraPos) {
+    refresh(chunks, cameraPos);
+    return static_cast<int64_t>(heap_.pop());
+}
+
+void ChunkBuildQueue::refresh(std::vector<std::shared_ptr<Chunk1>> &chunks, glm::vec3 cameraPos) {
+    auto currentTime = std::chrono::steady_clock::now();
+    int64_t bucket = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime.time_since_epoch()).count() /
+                     timeBucket.count();
+    glm::ivec3 cameraChunk = glm::ivec3(glm::floor(cameraPos / chunkSize));
+    if (bucket == bucket_ && cameraChunk == cameraChunk_) return;
+
+    bucket_ = bucket;
+    cameraChunk_ = cameraChunk;
+    bucketTime_ = currentTime;
+    cameraPos_ = cameraPos;
+    heap_.reprioritize([&](size_t id) { return chunks[id]->buildFactor(bucketTime_, cameraPos_); });
+}
+
+void ChunkBuildQueue::clear() {
+    heap_.clear();
+}
+
+bool ChunkBuildQueue::empty() {
+    return heap_.empty();
+}
+
+size_t ChunkBuildQueue::size() {
+    return heap_.size();
 }
 
 ChunkBuildDataBatch::ChunkBuildDataBatch(uint32_t maxBatchSize,
-                                         std::set<int64_t> &queuedIndexSet,
+                                         ChunkBuildQueue &queuedIndex,
                                          std::vector<std::shared_ptr<Chunk1>> &chunks,
                                          std::vector<std::shared_ptr<ChunkBuildData>> &chunkBuildDatas,
                                          glm::vec3 cameraPos) {
-    std::vector<int64_t> queuedIndices;
-    std::copy(queuedIndexSet.begin(), queuedIndexSet.end(), std::back_inserter(queuedIndices));
-    auto currentTime = std::chrono::steady_clock::now();
-    std::sort(queuedIndices.begin(), queuedIndices.end(), [&](int64_t a, int64_t b) -> bool {
-        return chunks[a]->buildFactor(currentTime, cameraPos) > chunks[b]->buildFactor(currentTime, cameraPos);
-    });
-
-    for (int i = 0; i < std::min((size_t)maxBatchSize, queuedIndices.size()); i++) {
-        auto iter = queuedIndexSet.find(queuedIndices[i]);
-        if (iter != queuedIndexSet.end()) { queuedIndexSet.erase(iter); }
-
-        auto data = chunkBuildDatas[queuedIndices[i]];
-        data->build();
-        batchData.push_back(data);
+    while (batchData.size() < maxBatchSize && !queuedIndex.empty()) {
+        // already prepared by the chunk build workers
+        batchData.push_back(chunkBuildDatas[queuedIndex.pop(chunks, cameraPos)]);
     }
 }
 
-ChunkBuildScheduler::ChunkBuildScheduler(std::set<int64_t> &queuedIndex,
+ChunkBuildScheduler::ChunkBuildScheduler(ChunkBuildQueue &queuedIndex,
                                          std::vector<std::shared_ptr<Chunk1>> &chunks,
                                          std::vector<std::shared_ptr<ChunkBuildData>> &chunkBuildDatas,
                                          std::recursive_mutex &mutex,
                                          std::shared_ptr<vk::HostVisibleBuffer> &chunkPackedData,
+                                         ChunkBuildStats &buildStats,
                                          uint32_t chunkBuildingBatchSize,
                                          uint32_t chunkBuildingTotalBatches)
     : queuedIndex_(queuedIndex),
@@ -122,6 +319,7 @@ ChunkBuildScheduler::ChunkBuildScheduler(std::set<int64_t> &queuedIndex,
       chunkBuildDatas_(chunkBuildDatas),
       mutex_(mutex),
       chunkPackedData_(chunkPackedData),
+      buildStats_(buildStats),
       chunkBuildingBatchSize_(chunkBuildingBatchSize),
       chunkBuildingTotalBatches_(chunkBuildingTotalBatches) {
     auto framework = Renderer::instance().framework();
@@ -129,6 +327,23 @@ ChunkBuildScheduler::ChunkBuildScheduler(std::set<int64_t> &queuedIndex,
 
     uint32_t numFences = chunkBuildingTotalBatches_;
     for (int i = 0; i < numFences; i++) { freeFences_.push(vk::Fence::create(device)); }
+
+    if (framework->gpuProfiler()->supportsTimestamps(framework->physicalDevice()->secondaryQueueIndex())) {
+        queryPool_ = vk::QueryPool::create(device, VK_QUERY_TYPE_TIMESTAMP, numFences * 2);
+        for (uint32_t i = 0; i < numFences; i++) { freeQuerySlots_.push(i); }
+    }
+}
+
+void ChunkBuildScheduler::recordBatchTiming(std::shared_ptr<ChunkBuildDataBatch> batch) {
+    if (batch->querySlot == UINT32_MAX) return;
+
+    auto gpuProfiler = Renderer::instance().framework()->gpuProfiler();
+    std::vector<uint64_t> values;
+    if (queryPool_->results(batch->querySlot * 2, 2, values) && values[1] >= values[0]) {
+        double milliseconds = static_cast<double>(values[1] - values[0]) * gpuProfiler->timestampPeriod() / 1e6;
+        gpuProfiler->record("chunk_blas", milliseconds);
+    }
+    freeQuerySlots_.push(batch->querySlot);
 }
 
 void ChunkBuildScheduler::tryCheckBatchesFinish() {
@@ -143,7 +358,9 @@ void ChunkBuildScheduler::tryCheckBatchesFinish() {
             vkResetFences(device->vkDevice(), 1, &(*iterFence)->vkFence());
             freeFences_.push(*iterFence);
 
+            auto finishedTime = std::chrono::steady_clock::now();
             for (auto chunkBuildData : (*iterBatch)->batchData) {
+                buildStats_.gpu.record(finishedTime - chunkBuildData->submittedTime);
                 chunks_[chunkBuildData->id]->enqueue(chunkBuildData);
 
                 ChunkPackedData data = {
@@ -154,6 +371,7 @@ void ChunkBuildScheduler::tryCheckBatchesFinish() {
                                                  chunkBuildData->id * sizeof(ChunkPackedData));
             }
 
+            recordBatchTiming(*iterBatch);
             iterFence = buildingFences_.erase(iterFence);
             iterBatch = buildingBatches_.erase(iterBatch);
         }
@@ -172,7 +390,9 @@ void ChunkBuildScheduler::waitAllBatchesFinish() {
             vkResetFences(device->vkDevice(), 1, &(*iterFence)->vkFence());
             freeFences_.push(*iterFence);
 
+            auto finishedTime = std::chrono::steady_clock::now();
             for (auto chunkBuildData : (*iterBatch)->batchData) {
+                buildStats_.gpu.record(finishedTime - chunkBuildData->submittedTime);
                 chunks_[chunkBuildData->id]->enqueue(chunkBuildData);
 
                 ChunkPackedData data = {
@@ -183,6 +403,7 @@ void ChunkBuildScheduler::waitAllBatchesFinish() {
                                                  chunkBuildData->id * sizeof(ChunkPackedData));
             }
 
+            recordBatchTiming(*iterBatch);
             iterFence = buildingFences_.erase(iterFence);
             iterBatch = buildingBatches_.erase(iterBatch);
         }
@@ -210,69 +431,40 @@ void ChunkBuildScheduler::tryScheduleBatches(uint32_t maxBatchSize) {
         if (chunkBuildDataBatch->batchData.size() > 0) {
             worldAsyncBuffer->begin();
 
-            for (auto chunkBuildData : chunkBuildDataBatch->batchData) {
-                for (int i = 0; i < chunkBuildData->geometryCount; i++) {
-                    chunkBuildData->vertexBuffers[i]->uploadToBuffer(worldAsyncBuffer);
-                    chunkBuildData->indexBuffers[i]->uploadToBuffer(worldAsyncBuffer);
-                    chunkBuildData->positionBuffers[i]->uploadToBuffer(worldAsyncBuffer);
-                    chunkBuildData->materialBuffers[i]->uploadToBuffer(worldAsyncBuffer);
-                }
+            if (queryPool_ != nullptr && Renderer::options.gpuProfiler && !freeQuerySlots_.empty()) {
+                chunkBuildDataBatch->querySlot = freeQuerySlots_.front();
+                freeQuerySlots_.pop();
+                vkCmdResetQueryPool(worldAsyncBuffer->vkCommandBuffer(), queryPool_->vkQueryPool(),
+                                    chunkBuildDataBatch->querySlot * 2, 2);
+                vkCmdWriteTimestamp2(worldAsyncBuffer->vkCommandBuffer(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                     queryPool_->vkQueryPool(), chunkBuildDataBatch->querySlot * 2);
             }
 
-            std::vector<vk::CommandBuffer::BufferMemoryBarrier> bufferBarriers;
             for (auto chunkBuildData : chunkBuildDataBatch->batchData) {
-                for (int i = 0; i < chunkBuildData->geometryCount; i++) {
-                    bufferBarriers.push_back(vk::CommandBuffer::BufferMemoryBarrier{
-                        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                        .srcAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-                        .dstStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR |
-                                        VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
-                        .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-                        .srcQueueFamilyIndex = secondaryQueueIndex,
-                        .dstQueueFamilyIndex = secondaryQueueIndex,
-                        .buffer = chunkBuildData->vertexBuffers[i],
-                    });
-
-                    bufferBarriers.push_back(vk::CommandBuffer::BufferMemoryBarrier{
-                        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                        .srcAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-                        .dstStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR |
-                                        VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
-                        .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-                        .srcQueueFamilyIndex = secondaryQueueIndex,
-                        .dstQueueFamilyIndex = secondaryQueueIndex,
-                        .buffer = chunkBuildData->indexBuffers[i],
-                    });
-
-                    bufferBarriers.push_back(vk::CommandBuffer::BufferMemoryBarrier{
-                        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                        .srcAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-                        .dstStageMask = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
-                        .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-                        .srcQueueFamilyIndex = secondaryQueueIndex,
-                        .dstQueueFamilyIndex = secondaryQueueIndex,
-                        .buffer = chunkBuildData->positionBuffers[i],
-                    });
-
-                    bufferBarriers.push_back(vk::CommandBuffer::BufferMemoryBarrier{
-                        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                        .srcAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-                        .dstStageMask = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
-                        .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-                        .srcQueueFamilyIndex = secondaryQueueIndex,
-                        .dstQueueFamilyIndex = secondaryQueueIndex,
-                        .buffer = chunkBuildData->materialBuffers[i],
-                    });
-                }
-                worldAsyncBuffer->barriersBufferImage(bufferBarriers, {});
+                chunkBuildData->geometryStaging->uploadToBuffer(worldAsyncBuffer);
             }
 
+            // the streams of a batch share a few arena blocks, a buffer barrier per stream would be mostly redundant
+            worldAsyncBuffer->barriersMemory({vk::CommandBuffer::MemoryBarrier{
+                .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR |
+                                VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+                .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+            }});
+
             std::vector<std::shared_ptr<vk::BLASBuilder>> builders;
             for (auto chunkBuildData : chunkBuildDataBatch->batchData) {
                 builders.push_back(chunkBuildData->blasBuilder);
+                if (chunkBuildData->lodBlasBuilder != nullptr) builders.push_back(chunkBuildData->lodBlasBuilder);
             }
             vk::BLASBuilder::batchSubmit(builders, worldAsyncBuffer);
 
+            if (chunkBuildDataBatch->querySlot != UINT32_MAX) {
+                vkCmdWriteTimestamp2(worldAsyncBuffer->vkCommandBuffer(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                     queryPool_->vkQueryPool(), chunkBuildDataBatch->querySlot * 2 + 1);
+            }
+
             worldAsyncBuffer->end();
 
             VkSubmitInfo vkSubmitInfo = {};
@@ -287,6 +479,12 @@ void ChunkBuildScheduler::tryScheduleBatches(uint32_t maxBatchSize) {
 
             vkQueueSubmit(device->secondaryQueue(), 1, &vkSubmitInfo, fence->vkFence());
 
+            auto submittedTime = std::chrono::steady_clock::now();
+            for (auto chunkBuildData : chunkBuildDataBatch->batchData) {
+                chunkBuildData->submittedTime = submittedTime;
+                buildStats_.schedule.record(submittedTime - chunkBuildData->preparedTime);
+            }
+
             freeFences_.pop();
             buildingFences_.push_back(fence);
             buildingBatches_.push_back(chunkBuildDataBatch);
@@ -302,6 +500,204 @@ uint32_t ChunkBuildScheduler::chunkBuildingTotalBatches() {
     return chunkBuildingTotalBatches_;
 }
 
+ChunkCompactor::ChunkCompactor(std::vector<std::shared_ptr<Chunk1>> &chunks,
+                               std::recursive_mutex &mutex,
+                               ChunkCompactionStats &stats,
+                               uint32_t compactionDelay,
+                               uint32_t compactionBatchSize)
+    : chunks_(chunks),
+      mutex_(mutex),
+      compactionDelay_(compactionDelay),
+      compactionBatchSize_(compactionBatchSize),
+      stats_(stats) {
+    auto framework = Renderer::instance().framework();
+    auto device = framework->device();
+
+    commandBuffer_ = vk::CommandBuffer::create(device, framework->asyncCommandPool());
+    fence_ = vk::Fence::create(device);
+    queryPool_ = vk::QueryPool::create(device, VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+                                       std::max(compactionBatchSize_, 1u));
+}
+
+void ChunkCompactor::tryCompact() {
+    if (compactionDelay_ == 0 || compactionBatchSize_ == 0) return;
+    if (!Renderer::instance().framework()->isRunning()) return;
+
+    auto framework = Renderer::instance().framework();
+    auto device = framework->device();
+
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    if (stage_ != Stage::Idle) {
+        if (vkWaitForFences(device->vkDevice(), 1, &fence_->vkFence(), true, 0) != VK_SUCCESS) return;
+        vkResetFences(device->vkDevice(), 1, &fence_->vkFence());
+
+        if (stage_ == Stage::QuerySize) {
+            scheduleCopy();
+            return;
+        }
+
+        swapCompacted();
+    }
+
+    scheduleQuery();
+}
+
+void ChunkCompactor::waitIdle() {
+    auto framework = Renderer::instance().framework();
+    auto device = framework->device();
+
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    if (stage_ == Stage::Idle) return;
+
+    vkWaitForFences(device->vkDevice(), 1, &fence_->vkFence(), true, UINT64_MAX);
+    vkResetFences(device->vkDevice(), 1, &fence_->vkFence());
+    if (stage_ == Stage::Copy) swapCompacted();
+
+    candidates_.clear();
+    stage_ = Stage::Idle;
+}
+
+void ChunkCompactor::printStats() {
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    uint64_t originalBytes = stats_.originalBytes;
+    uint64_t compactedBytes = stats_.compactedBytes;
+    if (stats_.compacted == 0) return;
+
+    chunksCout() << "compacted " << stats_.compacted << " chunk BLAS, " << originalBytes / 1024 << " KiB -> "
+                 << compactedBytes / 1024 << " KiB, saved " << (originalBytes - compactedBytes) / 1024 << " KiB"
+                 << std::endl;
+}
+
+void ChunkCompactor::scheduleQuery() {
+    candidates_.clear();
+    stage_ = Stage::Idle;
+    if (chunks_.empty()) return;
+
+    auto currentTime = std::chrono::steady_clock::now();
+    auto delay = std::chrono::milliseconds(compactionDelay_);
+
+    // round robin over all chunks so that a busy region near the camera does not starve the rest
+    uint32_t numChunks = static_cast<uint32_t>(chunks_.size());
+    for (uint32_t visited = 0; visited < numChunks && candidates_.size() < compactionBatchSize_; visited++) {
+        uint32_t id = nextIndex_;
+        nextIndex_ = (nextIndex_ + 1) % numChunks;
+
+        auto &chunk = chunks_[id];
+        if (chunk->blas == nullptr || chunk->blasCompacted) continue;
+        if (currentTime - chunk->lastUpdate < delay) continue;
+
+        candidates_.push_back({
+            .id = id,
+            .srcBLAS = chunk->blas,
+            .dstBLAS = nullptr,
+        });
+    }
+    if (candidates_.empty()) return;
+
+    std::vector<std::shared_ptr<vk::BLAS>> blass;
+    for (auto &candidate : candidates_) { blass.push_back(candidate.srcBLAS); }
+
+    commandBuffer_->begin();
+    commandBuffer_->barriersMemory({vk::CommandBuffer::MemoryBarrier{
+        .srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        .srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        .dstStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        .dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+    }});
+    vk::BLASBuilder::writeCompactedSizes(blass, queryPool_, 0, commandBuffer_);
+    commandBuffer_->end();
+
+    submit();
+    stage_ = Stage::QuerySize;
+}
+
+void ChunkCompactor::scheduleCopy() {
+    stage_ = Stage::Idle;
+
+    std::vector<uint64_t> compactedSizes;
+    if (!queryPool_->results(0, static_cast<uint32_t>(candidates_.size()), compactedSizes)) {
+        candidates_.clear();
+        return;
+    }
+
+    auto framework = Renderer::instance().framework();
+    auto vma = framework->vma();
+    auto device = framework->device();
+
+    bool anyCopy = false;
+    for (int i = 0; i < candidates_.size(); i++) {
+        auto &candidate = candidates_[i];
+        auto &chunk = chunks_[candidate.id];
+
+        // rebuilt or invalidated while the query was in flight
+        if (chunk->blas != candidate.srcBLAS) continue;
+
+        VkDeviceSize compactedSize = compactedSizes[i];
+        if (compactedSize == 0 || compactedSize >= candidate.srcBLAS->blasSize()) {
+            chunk->blasCompacted = true;
+            continue;
+        }
+
+        if (!anyCopy) {
+            commandBuffer_->begin();
+            anyCopy = true;
+        }
+        candidate.dstBLAS = vk::BLASBuilder::compact(device, vma, candidate.srcBLAS, compactedSize, commandBuffer_);
+    }
+
+    if (!anyCopy) {
+        candidates_.clear();
+        return;
+    }
+
+    commandBuffer_->end();
+    submit();
+    stage_ = Stage::Copy;
+}
+
+void ChunkCompactor::swapCompacted() {
+    auto framework = Renderer::instance().framework();
+    auto &gc = framework->gc();
+
+    for (auto &candidate : candidates_) {
+        if (candidate.dstBLAS == nullptr) continue;
+
+        auto &chunk = chunks_[candidate.id];
+        if (chunk->blas != candidate.srcBLAS) {
+            gc.collect(candidate.dstBLAS);
+            continue;
+        }
+
+        gc.collect(chunk->blas);
+        chunk->blas = candidate.dstBLAS;
+        chunk->blasCompacted = true;
+
+        VkDeviceSize originalSize = candidate.srcBLAS->blasSize();
+        VkDeviceSize compactedSize = candidate.dstBLAS->blasSize();
+        stats_.record(originalSize, compactedSize);
+
+#ifdef DEBUG
+        chunksCout() << "compacted chunk " << candidate.id << " BLAS " << originalSize << " -> " << compactedSize
+                     << " bytes, total saved " << (stats_.originalBytes - stats_.compactedBytes) / 1024 << " KiB"
+                     << std::endl;
+#endif
+    }
+
+    candidates_.clear();
+}
+
+void ChunkCompactor::submit() {
+    auto framework = Renderer::instance().framework();
+    auto device = framework->device();
+
+    VkSubmitInfo vkSubmitInfo = {};
+    vkSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    vkSubmitInfo.commandBufferCount = 1;
+    vkSubmitInfo.pCommandBuffers = &commandBuffer_->vkCommandBuffer();
+
+    vkQueueSubmit(device->secondaryQueue(), 1, &vkSubmitInfo, fence_->vkFence());
+}
+
 float Chunk1::buildFactor(std::chrono::steady_clock::time_point currentTime, glm::vec3 cameraPos) {
     double tDiff = std::chrono::duration<double, std::milli>(currentTime - lastUpdate).count();
     double dDiff = glm::distance(cameraPos, glm::vec3{x, y, z});
@@ -322,40 +718,50 @@ void Chunk1::enqueue(std::shared_ptr<ChunkBuildData> chunkBuildData) {
     y = chunkBuildData->y;
     z = chunkBuildData->z;
 
+    // the BLAS is built, its input is no longer needed
+    gc.collect(std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>(
+        std::move(chunkBuildData->blasInputBuffers)));
+    gc.collect(chunkBuildData->geometryStaging);
+    chunkBuildData->geometryStaging = nullptr;
+
     if (chunkBuildData->version > blasVersion) {
         blasVersion = chunkBuildData->version;
 
         gc.collect(blas);
         blas = chunkBuildData->blas;
+        blasCompacted = false;
+        gc.collect(lod);
+        lod = chunkBuildData->lod;
+        boundsMin = chunkBuildData->boundsMin;
+        boundsMax = chunkBuildData->boundsMax;
 
         gc.collect(vertexBuffers);
-        vertexBuffers = std::make_shared<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>>(
+        vertexBuffers = std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>(
             std::move(chunkBuildData->vertexBuffers));
 
-        gc.collect(indexBuffers);
-        indexBuffers = std::make_shared<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>>(
-            std::move(chunkBuildData->indexBuffers));
+        gc.collect(quadIndices);
+        quadIndices = chunkBuildData->quadIndices;
 
         gc.collect(positionBuffers);
-        positionBuffers = std::make_shared<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>>(
+        positionBuffers = std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>(
             std::move(chunkBuildData->positionBuffers));
 
         gc.collect(materialBuffers);
-        materialBuffers = std::make_shared<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>>(
+        materialBuffers = std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>(
             std::move(chunkBuildData->materialBuffers));
     } else {
         gc.collect(chunkBuildData->blas);
+        gc.collect(chunkBuildData->lod);
 
-        gc.collect(std::make_shared<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>>(
+        gc.collect(std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>(
             std::move(chunkBuildData->vertexBuffers)));
 
-        gc.collect(std::make_shared<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>>(
-            std::move(chunkBuildData->indexBuffers)));
+        gc.collect(chunkBuildData->quadIndices);
 
-        gc.collect(std::make_shared<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>>(
+        gc.collect(std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>(
             std::move(chunkBuildData->positionBuffers)));
 
-        gc.collect(std::make_shared<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>>(
+        gc.collect(std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>(
             std::move(chunkBuildData->materialBuffers)));
     }
 
@@ -363,10 +769,13 @@ void Chunk1::enqueue(std::shared_ptr<ChunkBuildData> chunkBuildData) {
     allIndexCount = chunkBuildData->allIndexCount;
     geometryCount = chunkBuildData->geometryCount;
     geometryTypes = std::make_shared<std::vector<World::GeometryTypes>>(std::move(chunkBuildData->geometryTypes));
-    geometryGroupNames = std::make_shared<std::vector<std::string>>(std::move(chunkBuildData->geometryGroupNames));
-    vertices =
+    geometryGroups = std::make_shared<std::vector<uint32_t>>(std::move(chunkBuildData->geometryGroups));
+
+    auto builtVertices =
         std::make_shared<std::vector<std::vector<vk::VertexFormat::PBRVertex>>>(std::move(chunkBuildData->vertices));
-    indices = std::make_shared<std::vector<std::vector<uint32_t>>>(std::move(chunkBuildData->indices));
+    gc.collect(vertices);
+    // the GPU streams are uploaded from the staging copy, the vertices are not needed for that
+    vertices = Renderer::options.chunkRetainCpuGeometry ? builtVertices : nullptr;
 }
 
 void Chunk1::invalidate() {
@@ -379,12 +788,16 @@ void Chunk1::invalidate() {
 
     gc.collect(blas);
     blas = nullptr;
+    blasCompacted = false;
+
+    gc.collect(lod);
+    lod = nullptr;
 
     gc.collect(vertexBuffers);
     vertexBuffers = nullptr;
 
-    gc.collect(indexBuffers);
-    indexBuffers = nullptr;
+    gc.collect(quadIndices);
+    quadIndices = nullptr;
 
     gc.collect(positionBuffers);
     positionBuffers = nullptr;
@@ -400,22 +813,25 @@ std::shared_ptr<ChunkRenderData> Chunk1::tryGetValid() {
     ret->z = z;
     ret->blas = blas;
     ret->vertexBuffers = vertexBuffers;
-    ret->indexBuffers = indexBuffers;
+    ret->quadIndices = quadIndices;
     ret->positionBuffers = positionBuffers;
     ret->materialBuffers = materialBuffers;
     ret->allVertexCount = allVertexCount;
     ret->allIndexCount = allIndexCount;
     ret->geometryCount = geometryCount;
     ret->geometryTypes = geometryTypes;
-    ret->geometryGroupNames = geometryGroupNames;
+    ret->geometryGroups = geometryGroups;
     ret->vertices = vertices;
-    ret->indices = indices;
 
     return ret;
 }
 
 Chunks::Chunks(std::shared_ptr<Framework> framework) {
+    geometryArena_ = vk::GeometryArena::create(framework->vma(), framework->device());
     importantBLASBuilders_ = std::make_shared<std::vector<std::shared_ptr<vk::BLASBuilder>>>();
+    chunkBuildWorkers_ =
+        ChunkBuildWorkers::create(Renderer::options.chunkBuildingThreads,
+                                  [this](std::shared_ptr<ChunkBuildData> data) { prepareChunkBuild(data); });
 }
 
 void Chunks::reset(uint32_t numChunks) {
@@ -431,6 +847,7 @@ void Chunks::reset(uint32_t numChunks) {
 
     importantBLASBuilders_ = std::make_shared<std::vector<std::shared_ptr<vk::BLASBuilder>>>();
 
+    generation_++;
     chunks_.clear();
     chunks_.resize(numChunks);
     chunkPackedData_ =
@@ -448,8 +865,13 @@ void Chunks::reset(uint32_t numChunks) {
     uint32_t chunkBuildingBatchSize = Renderer::instance().options.chunkBuildingBatchSize;
     uint32_t chunkBuildingTotalBatches = Renderer::instance().options.chunkBuildingTotalBatches;
     chunkBuildScheduler_ =
-        ChunkBuildScheduler::create(queuedIndex_, chunks_, chunkBuildDatas_, mutex_, chunkPackedData_,
+        ChunkBuildScheduler::create(queuedIndex_, chunks_, chunkBuildDatas_, mutex_, chunkPackedData_, buildStats_,
                                     chunkBuildingBatchSize, chunkBuildingTotalBatches);
+
+    if (chunkCompactor_ != nullptr) chunkCompactor_->printStats();
+    chunkCompactor_ =
+        ChunkCompactor::create(chunks_, mutex_, compactionStats_, Renderer::instance().options.chunkCompactionDelay,
+                               Renderer::instance().options.chunkCompactionBatchSize);
 }
 
 void Chunks::resetScheduler() {
@@ -462,10 +884,35 @@ void Chunks::resetScheduler() {
     uint32_t chunkBuildingBatchSize = Renderer::instance().options.chunkBuildingBatchSize;
     uint32_t chunkBuildingTotalBatches = Renderer::instance().options.chunkBuildingTotalBatches;
     chunkBuildScheduler_ =
-        ChunkBuildScheduler::create(queuedIndex_, chunks_, chunkBuildDatas_, mutex_, chunkPackedData_,
+        ChunkBuildScheduler::create(queuedIndex_, chunks_, chunkBuildDatas_, mutex_, chunkPackedData_, buildStats_,
                                     chunkBuildingBatchSize, chunkBuildingTotalBatches);
 }
 
+void Chunks::resetWorkers() {
+    std::shared_ptr<ChunkBuildWorkers> oldWorkers;
+    {
+        std::unique_lock<std::recursive_mutex> lock(mutex_);
+        oldWorkers = chunkBuildWorkers_;
+        chunkBuildWorkers_ =
+            ChunkBuildWorkers::create(Renderer::options.chunkBuildingThreads,
+                                      [this](std::shared_ptr<ChunkBuildData> data) { prepareChunkBuild(data); });
+    }
+    // the old workers finish their queue, which needs the mutex
+    oldWorkers = nullptr;
+}
+
+void Chunks::resetCompactor() {
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    if (chunkCompactor_ == nullptr) return;
+
+    chunkCompactor_->waitIdle();
+    chunkCompactor_->printStats();
+    chunkCompactor_ =
+        ChunkCompactor::create(chunks_, mutex_, compactionStats_, Renderer::instance().options.chunkCompactionDelay,
+                               Renderer::instance().options.chunkCompactionBatchSize);
+}
+
 void Chunks::resetFrame() {
     std::unique_lock<std::recursive_mutex> lock(mutex_);
     auto framework = Renderer::instance().framework();
@@ -473,6 +920,11 @@ void Chunks::resetFrame() {
 
     gc.collect(importantBLASBuilders_);
     importantBLASBuilders_ = std::make_shared<std::vector<std::shared_ptr<vk::BLASBuilder>>>();
+
+    // unspent time does not carry over, a backlog of far chunks must not stall the workers for several frames
+    lodBuildBudget_ = Renderer::options.chunkLodBuildBudget;
+    // the render thread is the only writer of the world camera, queued builds copy it from here
+    cameraPos_ = Renderer::instance().world()->getCameraPos();
 }
 
 void Chunks::invalidateChunk(int id) {
@@ -486,97 +938,302 @@ void Chunks::invalidateChunk(int id) {
     chunkPackedData_->uploadToBuffer(&data, sizeof(ChunkPackedData), id * sizeof(ChunkPackedData));
 }
 
-// maybe called async
+// maybe called async, only copies the vertices, everything else happens on the chunk build workers
 void Chunks::queueChunkBuild(ChunkBuildTask task) {
-    uint32_t allVertexCount = 0, allIndexCount = 0;
+    auto queuedTime = std::chrono::steady_clock::now();
+
+    uint32_t allVertexCount = 0;
     std::vector<World::GeometryTypes> geometryTypes;
-    std::vector<std::string> geometryGroupNames;
+    std::vector<uint32_t> geometryGroups;
     std::vector<std::vector<vk::VertexFormat::PBRVertex>> vertices;
-    std::vector<std::vector<uint32_t>> indices;
 
     for (int i = 0; i < task.geometryCount; i++) {
         World::GeometryTypes geometryType = static_cast<World::GeometryTypes>(task.geometryTypes[i]);
-        int geometryTexture = task.geometryTextures[i];
         geometryTypes.push_back(geometryType);
         if (task.geometryGroupNames != nullptr && task.geometryGroupNames[i] != nullptr) {
-            geometryGroupNames.emplace_back(task.geometryGroupNames[i]);
+            geometryGroups.push_back(World::internGeometryGroup(task.geometryGroupNames[i]));
         } else {
-            geometryGroupNames.emplace_back("default");
+            geometryGroups.push_back(World::internGeometryGroup("default"));
         }
 
         auto &geometryVertices = vertices.emplace_back();
-        auto &geometryIndices = indices.emplace_back();
-
         geometryVertices.resize(task.vertexCounts[i]);
         std::memcpy(geometryVertices.data(), task.vertices[i],
                     task.vertexCounts[i] * sizeof(vk::VertexFormat::PBRVertex));
 
-        for (int j = 0; j < task.vertexCounts[i]; j += 4) {
-            geometryIndices.push_back(j + 0);
-            geometryIndices.push_back(j + 1);
-            geometryIndices.push_back(j + 2);
-            geometryIndices.push_back(j + 2);
-            geometryIndices.push_back(j + 3);
-            geometryIndices.push_back(j + 0);
+        allVertexCount += geometryVertices.size();
+    }
+
+    std::shared_ptr<ChunkBuildWorkers> chunkBuildWorkers;
+    std::shared_ptr<ChunkBuildData> chunkBuildData;
+    {
+        std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+        chunkBuildData = ChunkBuildData::create(task.id, task.x, task.y, task.z, chunks_[task.id]->latestVersion++,
+                                                allVertexCount, 0, task.geometryCount, std::move(geometryTypes),
+                                                std::move(geometryGroups), std::move(vertices));
+        chunkBuildData->generation = generation_;
+        chunkBuildData->queuedTime = queuedTime;
+        chunkBuildData->cameraPos = cameraPos_;
+
+        if (task.isImportant) {
+            // needed in this very frame, no time for a round trip through the workers
+            auto beginTime = std::chrono::steady_clock::now();
+            chunkBuildData->prepare();
+            auto indexedTime = std::chrono::steady_clock::now();
+            // important chunks are next to the player, they never need a LOD
+            chunkBuildData->build(geometryArena_, quadIndices(chunkBuildData->quadCount()), false);
+            chunkBuildData->preparedTime = std::chrono::steady_clock::now();
+            buildStats_.index.record(indexedTime - beginTime);
+            buildStats_.buffer.record(chunkBuildData->preparedTime - indexedTime);
+
+            Renderer::instance().buffers()->queueImportantWorldUpload(chunkBuildData->geometryStaging);
+            importantBLASBuilders_->push_back(chunkBuildData->blasBuilder);
+
+            chunks_[task.id]->enqueue(chunkBuildData);
+
+            ChunkPackedData data = {
+                .geometryCount = chunkBuildData->geometryCount,
+            };
+
+            chunkPackedData_->uploadToBuffer(&data, sizeof(ChunkPackedData),
+                                             chunkBuildData->id * sizeof(ChunkPackedData));
+            return;
         }
 
-        allVertexCount += geometryVertices.size();
-        allIndexCount += geometryIndices.size();
+        chunkBuildWorkers = chunkBuildWorkers_;
     }
 
-    auto framework = Renderer::instance().framework();
-    auto vma = framework->vma();
-    auto device = framework->device();
-    auto physicalDevice = framework->physicalDevice();
+    if (chunkBuildWorkers != nullptr) chunkBuildWorkers->submit(chunkBuildData);
+}
+
+void Chunks::defragmentGeometry(std::shared_ptr<vk::CommandBuffer> commandBuffer, VkDeviceSize budget) {
+    if (budget == 0) return;
 
     std::unique_lock<std::recursive_mutex> lock(mutex_);
+    uint32_t block = geometryArena_->beginDrain();
+    if (block == vk::GeometryArena::invalidBlock) return;
+
+    auto &gc = Renderer::instance().framework()->gc();
+    VkDeviceSize movedBytes = 0;
+    bool barrierRecorded = false;
+    bool full = false;
+
+    // the old ranges go through the gc, frames in flight keep reading them while the copies land
+    auto relocateStreams = [&](std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryAllocation>>> &streams) {
+        if (streams == nullptr || full) return;
+        if (std::none_of(streams->begin(), streams->end(), [&](auto &stream) { return stream->block() == block; })) {
+            return;
+        }
+
+        if (!barrierRecorded) {
+            // important chunks may have been uploaded earlier in this frame
+            commandBuffer->barriersMemory({vk::CommandBuffer::MemoryBarrier{
+                .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+            }});
+            barrierRecorded = true;
+        }
 
-    std::shared_ptr<ChunkBuildData> chunkBuildData = ChunkBuildData::create(
-        task.id, task.x, task.y, task.z, chunks_[task.id]->latestVersion++, allVertexCount, allIndexCount,
-        task.geometryCount, std::move(geometryTypes), std::move(geometryGroupNames), std::move(vertices),
-        std::move(indices));
-
-    if (task.isImportant) {
-        chunkBuildData->build();
-        for (int i = 0; i < chunkBuildData->geometryCount; i++) {
-            Renderer::instance().buffers()->queueImportantWorldUpload(chunkBuildData->vertexBuffers[i],
-                                                                      chunkBuildData->indexBuffers[i]);
-            Renderer::instance().buffers()->queueImportantWorldUpload(chunkBuildData->positionBuffers[i]);
-            Renderer::instance().buffers()->queueImportantWorldUpload(chunkBuildData->materialBuffers[i]);
+        auto relocated = std::make_shared<std::vector<std::shared_ptr<vk::GeometryAllocation>>>(*streams);
+        for (auto &stream : *relocated) {
+            if (stream->block() != block) continue;
+            auto moved = geometryArena_->relocate(commandBuffer, stream);
+            // keep what was already copied, the copies are recorded
+            if (moved == nullptr) {
+                full = true;
+                break;
+            }
+            movedBytes += stream->size();
+            stream = moved;
         }
-        importantBLASBuilders_->push_back(chunkBuildData->blasBuilder);
 
-        chunks_[task.id]->enqueue(chunkBuildData);
+        gc.collect(streams);
+        streams = relocated;
+    };
 
-        ChunkPackedData data = {
-            .geometryCount = chunkBuildData->geometryCount,
-        };
+    for (auto &chunk : chunks_) {
+        if (movedBytes >= budget || full) break;
+        relocateStreams(chunk->vertexBuffers);
+        relocateStreams(chunk->positionBuffers);
+        relocateStreams(chunk->materialBuffers);
+        if (chunk->lod != nullptr) {
+            relocateStreams(chunk->lod->vertexBuffers);
+            relocateStreams(chunk->lod->positionBuffers);
+            relocateStreams(chunk->lod->materialBuffers);
+        }
+    }
 
-        chunkPackedData_->uploadToBuffer(&data, sizeof(ChunkPackedData), chunkBuildData->id * sizeof(ChunkPackedData));
-    } else {
-        queuedIndex_.insert(task.id);
-        chunkBuildDatas_[task.id] = chunkBuildData;
+    // the other blocks filled up meanwhile, try again with another block later
+    if (full) geometryArena_->cancelDrain();
+
+    if (barrierRecorded) {
+        commandBuffer->barriersMemory({vk::CommandBuffer::MemoryBarrier{
+            .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR |
+                            VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+        }});
     }
 }
 
+int64_t Chunks::reserveLodBuild(std::shared_ptr<ChunkBuildData> chunkBuildData) {
+    if (Renderer::options.chunkLodDistance == 0) return 0;
+    if (ChunkLod::residentBytes >= Renderer::options.chunkLodMemoryBudget) return 0;
+
+    // chunks closer than half the distance are rebuilt or unloaded long before they are traced with a LOD
+    glm::dvec3 chunkCenter = glm::dvec3(chunkBuildData->x, chunkBuildData->y, chunkBuildData->z) + chunkSize * 0.5;
+    glm::dvec3 offset = chunkCenter - chunkBuildData->cameraPos;
+    double minDistance = Renderer::options.chunkLodDistance * 0.5;
+    if (glm::dot(offset, offset) <= minDistance * minDistance) return 0;
+
+    // reserved before merging so concurrent workers cannot all pass the check and overshoot together, the estimate is
+    // corrected with the measured time once the merge is done
+    int64_t estimate = std::max<int64_t>(1, chunkBuildData->quadCount() * lodNanosecondsPerQuad_ / 1000);
+    if (lodBuildBudget_.fetch_sub(estimate) <= 0) {
+        lodBuildBudget_ += estimate;
+        return 0;
+    }
+    return estimate;
+}
+
+bool Chunks::isStale(std::shared_ptr<ChunkBuildData> chunkBuildData) {
+    if (chunkBuildData->generation != generation_) return true;
+    if (chunkBuildData->id < 0 || static_cast<size_t>(chunkBuildData->id) >= chunks_.size()) return true;
+    // a newer build of the same chunk was queued meanwhile
+    return chunks_[chunkBuildData->id]->latestVersion > chunkBuildData->version + 1;
+}
+
+void Chunks::prepareChunkBuild(std::shared_ptr<ChunkBuildData> chunkBuildData) {
+    auto beginTime = std::chrono::steady_clock::now();
+    buildStats_.queue.record(beginTime - chunkBuildData->queuedTime);
+
+    {
+        std::unique_lock<std::recursive_mutex> lock(mutex_);
+        if (isStale(chunkBuildData)) return;
+    }
+
+    chunkBuildData->prepare();
+    auto indexedTime = std::chrono::steady_clock::now();
+    int64_t lodReservation = reserveLodBuild(chunkBuildData);
+    chunkBuildData->build(geometryArena_, quadIndices(chunkBuildData->quadCount()), lodReservation > 0);
+    chunkBuildData->preparedTime = std::chrono::steady_clock::now();
+    buildStats_.index.record(indexedTime - beginTime);
+    buildStats_.buffer.record(chunkBuildData->preparedTime - indexedTime);
+    if (lodReservation > 0) {
+        buildStats_.lod.record(chunkBuildData->lodBuildTime);
+        int64_t lodNanoseconds =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(chunkBuildData->lodBuildTime).count();
+        lodBuildBudget_ += lodReservation - lodNanoseconds / 1000;
+        if (uint32_t quadCount = chunkBuildData->quadCount(); quadCount > 0) {
+            int64_t previous = lodNanosecondsPerQuad_;
+            lodNanosecondsPerQuad_ = (previous * 7 + lodNanoseconds / quadCount) / 8;
+        }
+    }
+
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    if (isStale(chunkBuildData)) return;
+
+    // workers may finish out of order, never replace a newer build
+    auto &queuedBuildData = chunkBuildDatas_[chunkBuildData->id];
+    if (queuedBuildData != nullptr && queuedBuildData->version > chunkBuildData->version) return;
+
+    queuedBuildData = chunkBuildData;
+    queuedIndex_.insert(chunkBuildData->id, chunks_);
+}
+
 bool Chunks::isChunkReady(int64_t id) {
     std::unique_lock<std::recursive_mutex> lock(mutex_);
     auto chunkRenderData = chunks_[id]->tryGetValid();
     return chunkRenderData->blas != nullptr;
 }
 
+size_t Chunks::cpuGeometryBytes() {
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+
+    auto bytesOf = [](const std::vector<std::vector<vk::VertexFormat::PBRVertex>> &vertices) {
+        size_t bytes = 0;
+        for (const auto &geometryVertices : vertices) {
+            bytes += geometryVertices.capacity() * sizeof(vk::VertexFormat::PBRVertex);
+        }
+        return bytes;
+    };
+
+    size_t bytes = 0;
+    for (const auto &chunk : chunks_) {
+        if (chunk->vertices != nullptr) bytes += bytesOf(*chunk->vertices);
+    }
+    for (const auto &chunkBuildData : chunkBuildDatas_) {
+        if (chunkBuildData != nullptr) bytes += bytesOf(chunkBuildData->vertices);
+    }
+    return bytes;
+}
+
+std::shared_ptr<vk::QuadIndexBuffer> Chunks::quadIndices(uint32_t quadCount) {
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    if (quadIndices_ != nullptr && quadIndices_->quadCount() >= quadCount) return quadIndices_;
+
+    uint32_t grownQuadCount = quadIndices_ != nullptr ? quadIndices_->quadCount() : initialQuadCount;
+    while (grownQuadCount < quadCount) grownQuadCount *= 2;
+
+    auto framework = Renderer::instance().framework();
+    auto device = framework->device();
+    auto grown = vk::QuadIndexBuffer::create(framework->vma(), device, VK_INDEX_TYPE_UINT32, grownQuadCount);
+
+    // rare enough to wait for, afterwards it is valid on every queue without further synchronization
+    auto commandBuffer = vk::CommandBuffer::create(device, framework->asyncCommandPool());
+    auto fence = vk::Fence::create(device);
+    commandBuffer->begin();
+    auto staging = grown->uploadToBuffer(commandBuffer);
+    commandBuffer->end();
+
+    VkSubmitInfo vkSubmitInfo = {};
+    vkSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    vkSubmitInfo.commandBufferCount = 1;
+    vkSubmitInfo.pCommandBuffers = &commandBuffer->vkCommandBuffer();
+    vkQueueSubmit(device->secondaryQueue(), 1, &vkSubmitInfo, fence->vkFence());
+    vkWaitForFences(device->vkDevice(), 1, &fence->vkFence(), true, UINT64_MAX);
+
+    // chunks built against the previous buffer keep it alive
+    quadIndices_ = grown;
+    return quadIndices_;
+}
+
 void Chunks::close() {
+    std::shared_ptr<ChunkBuildWorkers> chunkBuildWorkers;
+    {
+        std::unique_lock<std::recursive_mutex> lock(mutex_);
+        generation_++;
+        chunkBuildWorkers = chunkBuildWorkers_;
+        chunkBuildWorkers_ = nullptr;
+    }
+    // queued jobs are stale now and return right away, but they still take the mutex
+    chunkBuildWorkers = nullptr;
+
     std::unique_lock<std::recursive_mutex> lock(mutex_);
+    buildStats_.print();
     if (chunkBuildScheduler_ != nullptr) {
         chunkBuildScheduler_->waitAllBatchesFinish();
         chunkBuildScheduler_ = nullptr;
     }
 
+    if (chunkCompactor_ != nullptr) {
+        chunkCompactor_->waitIdle();
+        chunkCompactor_->printStats();
+        chunkCompactor_ = nullptr;
+    }
+
     queuedIndex_.clear();
     chunkBuildDatas_.clear();
     importantBLASBuilders_ = nullptr;
     chunkPackedData_ = nullptr;
     chunks_.clear();
+
+    // the streams of the cleared chunks are still held by the gc, so this reports the loaded world
+    geometryArena_->printStats();
 }
 
 std::recursive_mutex &Chunks::mutex() {
@@ -587,11 +1244,20 @@ std::vector<std::shared_ptr<Chunk1>> &Chunks::chunks() {
     return chunks_;
 }
 
+std::shared_ptr<vk::GeometryArena> Chunks::geometryArena() {
+    return geometryArena_;
+}
+
 std::shared_ptr<ChunkBuildScheduler> Chunks::chunkBuildScheduler() {
     std::unique_lock<std::recursive_mutex> lock(mutex_);
     return chunkBuildScheduler_;
 }
 
+std::shared_ptr<ChunkCompactor> Chunks::chunkCompactor() {
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
+    return chunkCompactor_;
+}
+
 std::vector<std::shared_ptr<vk::BLASBuilder>> &Chunks::importantBLASBuilders() {
     return *importantBLASBuilders_;
 }
@@ -599,3 +1265,35 @@ std::vector<std::shared_ptr<vk::BLASBuilder>> &Chunks::importantBLASBuilders() {
 std::shared_ptr<vk::HostVisibleBuffer> Chunks::chunkPackedData() {
     return chunkPackedData_;
 }
+
+ChunkBuildStats &Chunks::buildStats() {
+    return buildStats_;
+}
+
+ChunkCompactionStats &Chunks::compactionStats() {
+    return compactionStats_;
+}
+
+void Chunks::recordCulling(uint32_t instanced, uint32_t lod, uint32_t culledDistance, uint32_t culledEmpty) {
+    instancedChunks_ = instanced;
+    lodChunks_ = lod;
+    culledDistanceChunks_ = culledDistance;
+    culledEmptyChunks_ = culledEmpty;
+    totalInstancedChunks_ += instanced;
+    totalLodChunks_ += lod;
+    totalCulledDistanceChunks_ += culledDistance;
+    totalCulledEmptyChunks_ += culledEmpty;
+}
+
+ChunkCullingStats Chunks::cullingStats() {
+    return {
+        .instanced = instancedChunks_.load(),
+        .lod = lodChunks_.load(),
+        .culledDistance = culledDistanceChunks_.load(),
+        .culledEmpty = culledEmptyChunks_.load(),
+        .totalInstanced = totalInstancedChunks_.load(),
+        .totalLod = totalLodChunks_.load(),
+        .totalCulledDistance = totalCulledDistanceChunks_.load(),
+        .totalCulledEmpty = totalCulledEmptyChunks_.load(),
+    };
+}
@@ -1,12 +1,15 @@
 #pragma once
 
+#include "common/indexed_heap.hpp"
 #include "common/shared.hpp"
 #include "common/singleton.hpp"
 #include "core/all_extern.hpp"
 #include "core/vulkan/all_core_vulkan.hpp"
 
+#include "core/render/chunk_workers.hpp"
 #include "core/render/world.hpp"
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <deque>
@@ -21,6 +24,9 @@
 
 class Framework;
 
+// edge length of a chunk section in blocks
+inline constexpr float chunkSize = 16.0f;
+
 struct ChunkBuildTask {
     int x, y, z;
     int64_t id;
@@ -34,6 +40,69 @@ struct ChunkBuildTask {
     bool isImportant;
 };
 
+// Latency of one stage of the chunk build pipeline, recorded from any thread.
+struct ChunkBuildLatency {
+    std::atomic<uint64_t> count = 0;
+    std::atomic<uint64_t> totalMicroseconds = 0;
+    std::atomic<uint64_t> maxMicroseconds = 0;
+
+    void record(std::chrono::steady_clock::duration duration);
+};
+
+struct ChunkBuildStats {
+    ChunkBuildLatency queue;    // queued until a worker picked it up
+    ChunkBuildLatency index;    // index generation
+    ChunkBuildLatency buffer;   // vertex conversion, staging and BLAS setup
+    ChunkBuildLatency schedule; // prepared until recorded on the async queue
+    ChunkBuildLatency gpu;      // submitted until its fence was observed
+    ChunkBuildLatency lod;      // face merging of builds that tried a LOD
+
+    void print();
+};
+
+// chunk BLASes swapped for their compacted copy by the ChunkCompactor, kept across compactor resets
+struct ChunkCompactionStats {
+    static constexpr int histogramBuckets = 10;
+
+    std::atomic<uint64_t> compacted = 0;
+    std::atomic<uint64_t> originalBytes = 0;
+    std::atomic<uint64_t> compactedBytes = 0;
+    // compactions by the saved fraction of the original size, in tenths
+    std::atomic<uint64_t> savedHistogram[histogramBuckets]{};
+
+    void record(VkDeviceSize originalSize, VkDeviceSize compactedSize);
+};
+
+// chunk instances left out of the world TLAS by WorldPrepareContext
+struct ChunkCullingStats {
+    uint32_t instanced;      // last frame
+    uint32_t lod;            // last frame, instanced with their ChunkLod
+    uint32_t culledDistance; // last frame, beyond Options::tlasCullDistance plus the margin
+    uint32_t culledEmpty;    // last frame, built without any vertex
+    uint64_t totalInstanced;
+    uint64_t totalLod;
+    uint64_t totalCulledDistance;
+    uint64_t totalCulledEmpty;
+};
+
+// Merged faces of a chunk, traced instead of the full geometry beyond Options::chunkLodDistance. Built next to the
+// full detail BLAS by the chunk build workers for chunks that are far away at that time, while the memory budget and
+// the per frame build time budget last.
+struct ChunkLod : public SharedObject<ChunkLod> {
+    // LOD geometries and BLASes alive, counted against Options::chunkLodMemoryBudget
+    static inline std::atomic<uint64_t> residentBytes = 0;
+
+    std::shared_ptr<vk::BLAS> blas;
+    std::vector<uint32_t> geometries; // full detail geometry of each LOD geometry, for its type and group
+    std::vector<uint32_t> vertexCounts;
+    std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryAllocation>>> vertexBuffers;
+    std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryAllocation>>> positionBuffers;
+    std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryAllocation>>> materialBuffers;
+    uint64_t bytes = 0;
+
+    ~ChunkLod();
+};
+
 struct ChunkBuildData : public SharedObject<ChunkBuildData> {
     int64_t id;
     int x, y, z;
@@ -42,15 +111,33 @@ struct ChunkBuildData : public SharedObject<ChunkBuildData> {
     uint32_t allIndexCount;
     uint32_t geometryCount;
     std::vector<World::GeometryTypes> geometryTypes;
-    std::vector<std::string> geometryGroupNames;
+    std::vector<uint32_t> geometryGroups; // World::internGeometryGroup ids
     std::vector<std::vector<vk::VertexFormat::PBRVertex>> vertices;
-    std::vector<std::vector<uint32_t>> indices;
-    std::vector<std::shared_ptr<vk::DeviceLocalBuffer>> vertexBuffers;
-    std::vector<std::shared_ptr<vk::DeviceLocalBuffer>> indexBuffers;
-    std::vector<std::shared_ptr<vk::DeviceLocalBuffer>> positionBuffers;
-    std::vector<std::shared_ptr<vk::DeviceLocalBuffer>> materialBuffers;
+    std::vector<std::shared_ptr<vk::GeometryAllocation>> vertexBuffers;
+    // shared by every geometry, the quads of a geometry index it from the start
+    std::shared_ptr<vk::QuadIndexBuffer> quadIndices;
+    std::vector<std::shared_ptr<vk::GeometryAllocation>> positionBuffers;
+    std::vector<std::shared_ptr<vk::GeometryAllocation>> materialBuffers;
+    // half precision positions, only alive until the BLAS is built
+    std::vector<std::shared_ptr<vk::GeometryAllocation>> blasInputBuffers;
+    // every stream above, only alive until it is uploaded
+    std::shared_ptr<vk::GeometryStaging> geometryStaging;
     std::shared_ptr<vk::BLAS> blas;
     std::shared_ptr<vk::BLASBuilder> blasBuilder;
+    // nullptr unless build() was asked for a LOD and merging saved enough
+    std::shared_ptr<ChunkLod> lod;
+    std::shared_ptr<vk::BLASBuilder> lodBlasBuilder;
+    // camera when the build was queued, workers must not read World::getCameraPos
+    glm::dvec3 cameraPos = glm::dvec3(0.0);
+    // chunk local, of every vertex, set by build()
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    uint32_t generation = 0;
+    std::chrono::steady_clock::time_point queuedTime;
+    std::chrono::steady_clock::time_point preparedTime;
+    std::chrono::steady_clock::duration lodBuildTime{};
+    std::chrono::steady_clock::time_point submittedTime;
 
     ChunkBuildData(int64_t id,
                    int x,
@@ -61,20 +148,49 @@ struct ChunkBuildData : public SharedObject<ChunkBuildData> {
                    uint32_t allIndexCount,
                    uint32_t geometryCount,
                    std::vector<World::GeometryTypes> &&geometryTypes,
-                   std::vector<std::string> &&geometryGroupNames,
-                   std::vector<std::vector<vk::VertexFormat::PBRVertex>> &&vertices,
-                   std::vector<std::vector<uint32_t>> &&indices);
-
-    void build();
+                   std::vector<uint32_t> &&geometryGroups,
+                   std::vector<std::vector<vk::VertexFormat::PBRVertex>> &&vertices);
+
+    void prepare();
+    // quads of the largest geometry
+    uint32_t quadCount();
+    void build(std::shared_ptr<vk::GeometryArena> geometryArena,
+               std::shared_ptr<vk::QuadIndexBuffer> quadIndices,
+               bool buildLod);
 };
 
 struct Chunk1;
 
+// Prepared chunks waiting for the async queue, best Chunk1::buildFactor first. The factors are cached and only
+// recomputed once the camera enters another chunk or the time bucket changes, not on every comparison.
+class ChunkBuildQueue {
+  public:
+    // re-queuing a chunk refreshes its factor
+    void insert(int64_t id, std::vector<std::shared_ptr<Chunk1>> &chunks);
+    int64_t pop(std::vector<std::shared_ptr<Chunk1>> &chunks, glm::vec3 cameraPos);
+    void clear();
+    bool empty();
+    size_t size();
+
+  private:
+    static constexpr std::chrono::milliseconds timeBucket{100};
+
+    void refresh(std::vector<std::shared_ptr<Chunk1>> &chunks, glm::vec3 cameraPos);
+
+  private:
+    IndexedHeap<float> heap_;
+    glm::ivec3 cameraChunk_{INT32_MAX};
+    int64_t bucket_ = -1;
+    glm::vec3 cameraPos_{0.0f};
+    std::chrono::steady_clock::time_point bucketTime_;
+};
+
 struct ChunkBuildDataBatch : public SharedObject<ChunkBuildDataBatch> {
     std::vector<std::shared_ptr<ChunkBuildData>> batchData;
+    uint32_t querySlot = UINT32_MAX; // UINT32_MAX when the batch is not profiled
 
     ChunkBuildDataBatch(uint32_t maxBatchSize,
-                        std::set<int64_t> &queuedIndex,
+                        ChunkBuildQueue &queuedIndex,
                         std::vector<std::shared_ptr<Chunk1>> &chunks,
                         std::vector<std::shared_ptr<ChunkBuildData>> &chunkBuildDatas,
                         glm::vec3 cameraPos);
@@ -82,11 +198,12 @@ struct ChunkBuildDataBatch : public SharedObject<ChunkBuildDataBatch> {
 
 class ChunkBuildScheduler : public SharedObject<ChunkBuildScheduler> {
   public:
-    ChunkBuildScheduler(std::set<int64_t> &queuedIndex,
+    ChunkBuildScheduler(ChunkBuildQueue &queuedIndex,
                         std::vector<std::shared_ptr<Chunk1>> &chunks,
                         std::vector<std::shared_ptr<ChunkBuildData>> &chunkBuildDatas,
                         std::recursive_mutex &mutex,
                         std::shared_ptr<vk::HostVisibleBuffer> &chunkPackedData,
+                        ChunkBuildStats &buildStats,
                         uint32_t chunkBuildingBatchSize,
                         uint32_t chunkBuildingTotalBatches);
 
@@ -98,20 +215,78 @@ class ChunkBuildScheduler : public SharedObject<ChunkBuildScheduler> {
     uint32_t chunkBuildingTotalBatches();
 
   private:
-    std::set<int64_t> &queuedIndex_;
+    void recordBatchTiming(std::shared_ptr<ChunkBuildDataBatch> batch);
+
+  private:
+    ChunkBuildQueue &queuedIndex_;
     std::vector<std::shared_ptr<Chunk1>> &chunks_;
     std::vector<std::shared_ptr<ChunkBuildData>> &chunkBuildDatas_;
     std::recursive_mutex &mutex_;
     std::shared_ptr<vk::HostVisibleBuffer> &chunkPackedData_;
+    ChunkBuildStats &buildStats_;
 
     std::queue<std::shared_ptr<vk::Fence>> freeFences_;
     std::list<std::shared_ptr<vk::Fence>> buildingFences_;
     std::list<std::shared_ptr<ChunkBuildDataBatch>> buildingBatches_;
 
+    // two timestamps per in flight batch, nullptr when the secondary queue cannot write timestamps
+    std::shared_ptr<vk::QueryPool> queryPool_;
+    std::queue<uint32_t> freeQuerySlots_;
+
     uint32_t chunkBuildingBatchSize_;
     uint32_t chunkBuildingTotalBatches_;
 };
 
+// Copies the BLAS of chunks that stopped changing into compacted storage on the async queue. The compacted sizes are
+// only known on the host after a first submission, so every batch takes two rounds: query sizes, then copy.
+class ChunkCompactor : public SharedObject<ChunkCompactor> {
+  public:
+    ChunkCompactor(std::vector<std::shared_ptr<Chunk1>> &chunks,
+                   std::recursive_mutex &mutex,
+                   ChunkCompactionStats &stats,
+                   uint32_t compactionDelay,
+                   uint32_t compactionBatchSize);
+
+    void tryCompact();
+    void waitIdle();
+    void printStats();
+
+  private:
+    enum class Stage {
+        Idle,
+        QuerySize,
+        Copy,
+    };
+
+    struct Candidate {
+        int64_t id;
+        std::shared_ptr<vk::BLAS> srcBLAS;
+        std::shared_ptr<vk::BLAS> dstBLAS;
+    };
+
+    void scheduleQuery();
+    void scheduleCopy();
+    void swapCompacted();
+    void submit();
+
+  private:
+    std::vector<std::shared_ptr<Chunk1>> &chunks_;
+    std::recursive_mutex &mutex_;
+
+    std::shared_ptr<vk::CommandBuffer> commandBuffer_;
+    std::shared_ptr<vk::Fence> fence_;
+    std::shared_ptr<vk::QueryPool> queryPool_;
+
+    Stage stage_ = Stage::Idle;
+    std::vector<Candidate> candidates_;
+    uint32_t nextIndex_ = 0;
+
+    uint32_t compactionDelay_;
+    uint32_t compactionBatchSize_;
+
+    ChunkCompactionStats &stats_;
+};
+
 struct ChunkRenderData : public SharedObject<ChunkRenderData> {
     int x, y, z;
     std::shared_ptr<vk::BLAS> blas;
@@ -119,13 +294,12 @@ struct ChunkRenderData : public SharedObject<ChunkRenderData> {
     uint32_t allIndexCount;
     uint32_t geometryCount;
     std::shared_ptr<std::vector<World::GeometryTypes>> geometryTypes;
-    std::shared_ptr<std::vector<std::string>> geometryGroupNames;
-    std::shared_ptr<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>> vertexBuffers;
-    std::shared_ptr<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>> indexBuffers;
-    std::shared_ptr<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>> positionBuffers;
-    std::shared_ptr<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>> materialBuffers;
+    std::shared_ptr<std::vector<uint32_t>> geometryGroups;
+    std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryAllocation>>> vertexBuffers;
+    std::shared_ptr<vk::QuadIndexBuffer> quadIndices;
+    std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryAllocation>>> positionBuffers;
+    std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryAllocation>>> materialBuffers;
     std::shared_ptr<std::vector<std::vector<vk::VertexFormat::PBRVertex>>> vertices;
-    std::shared_ptr<std::vector<std::vector<uint32_t>>> indices;
 };
 
 struct Chunk1 : public SharedObject<Chunk1> {
@@ -142,18 +316,23 @@ struct Chunk1 : public SharedObject<Chunk1> {
 
     std::shared_ptr<vk::BLAS> blas;
     int64_t blasVersion = -1;
-    std::shared_ptr<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>> vertexBuffers;
-    std::shared_ptr<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>> indexBuffers;
-    std::shared_ptr<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>> positionBuffers;
-    std::shared_ptr<std::vector<std::shared_ptr<vk::DeviceLocalBuffer>>> materialBuffers;
+    bool blasCompacted = false;
+    std::shared_ptr<ChunkLod> lod;
+    // chunk local bounds of the geometry in blas
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryAllocation>>> vertexBuffers;
+    std::shared_ptr<vk::QuadIndexBuffer> quadIndices;
+    std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryAllocation>>> positionBuffers;
+    std::shared_ptr<std::vector<std::shared_ptr<vk::GeometryAllocation>>> materialBuffers;
 
     uint32_t allVertexCount;
     uint32_t allIndexCount;
     uint32_t geometryCount;
     std::shared_ptr<std::vector<World::GeometryTypes>> geometryTypes;
-    std::shared_ptr<std::vector<std::string>> geometryGroupNames;
+    std::shared_ptr<std::vector<uint32_t>> geometryGroups;
+    // nullptr unless Options::chunkRetainCpuGeometry, consumers of dropped copies re-request the chunk from Java
     std::shared_ptr<std::vector<std::vector<vk::VertexFormat::PBRVertex>>> vertices;
-    std::shared_ptr<std::vector<std::vector<uint32_t>>> indices;
 
     float buildFactor(std::chrono::steady_clock::time_point currentTime, glm::vec3 cameraPos);
 
@@ -174,27 +353,75 @@ class Chunks : public SharedObject<Chunks> {
 
     void reset(uint32_t numChunks);
     void resetScheduler();
+    void resetWorkers();
+    void resetCompactor();
     void resetFrame();
     void invalidateChunk(int id);
     void queueChunkBuild(ChunkBuildTask task);
+    // moves the streams of loaded chunks out of a sparse arena block, at most budget bytes per call
+    void defragmentGeometry(std::shared_ptr<vk::CommandBuffer> commandBuffer, VkDeviceSize budget);
 
     bool isChunkReady(int64_t id);
+    // vertices held on the host by built and queued chunks
+    size_t cpuGeometryBytes();
 
     void close();
 
     std::recursive_mutex &mutex();
     std::vector<std::shared_ptr<Chunk1>> &chunks();
     std::shared_ptr<ChunkBuildScheduler> chunkBuildScheduler();
+    std::shared_ptr<ChunkCompactor> chunkCompactor();
     std::vector<std::shared_ptr<vk::BLASBuilder>> &importantBLASBuilders();
     std::shared_ptr<vk::HostVisibleBuffer> chunkPackedData();
+    std::shared_ptr<vk::GeometryArena> geometryArena();
+    ChunkBuildStats &buildStats();
+    ChunkCompactionStats &compactionStats();
+    // once per frame by the TLAS build
+    void recordCulling(uint32_t instanced, uint32_t lod, uint32_t culledDistance, uint32_t culledEmpty);
+    ChunkCullingStats cullingStats();
+
+  private:
+    // runs on the chunk build workers
+    void prepareChunkBuild(std::shared_ptr<ChunkBuildData> chunkBuildData);
+    bool isStale(std::shared_ptr<ChunkBuildData> chunkBuildData);
+    // far enough from the camera for Options::chunkLodDistance to matter soon, and within the memory budget. Reserves
+    // the estimated merge time from lodBuildBudget_ and returns it, 0 if no LOD should be built
+    int64_t reserveLodBuild(std::shared_ptr<ChunkBuildData> chunkBuildData);
+    // grows the shared quad indices first when they cover fewer quads, thread safe
+    std::shared_ptr<vk::QuadIndexBuffer> quadIndices(uint32_t quadCount);
 
   private:
+    // covers the geometries of almost every chunk, larger ones double it
+    static constexpr uint32_t initialQuadCount = 1 << 14;
+
     std::recursive_mutex mutex_;
     std::vector<std::shared_ptr<Chunk1>> chunks_;
     std::shared_ptr<vk::HostVisibleBuffer> chunkPackedData_ = nullptr;
     std::vector<std::shared_ptr<ChunkBuildData>> chunkBuildDatas_;
-    std::set<int64_t> queuedIndex_;
+    ChunkBuildQueue queuedIndex_;
     std::shared_ptr<ChunkBuildScheduler> chunkBuildScheduler_;
+    std::shared_ptr<ChunkCompactor> chunkCompactor_;
+    uint32_t generation_ = 0; // bumped whenever chunks_ is reset, jobs of older generations are dropped
+    ChunkBuildStats buildStats_;
+    ChunkCompactionStats compactionStats_;
+    std::atomic<uint32_t> instancedChunks_ = 0;
+    std::atomic<uint32_t> lodChunks_ = 0;
+    // microseconds of LOD face merging the workers may still spend this frame, refilled by resetFrame
+    std::atomic<int64_t> lodBuildBudget_ = 0;
+    // measured merge cost, estimates the reservation of the next LOD build
+    std::atomic<int64_t> lodNanosecondsPerQuad_ = 100;
+    glm::dvec3 cameraPos_ = glm::dvec3(0.0); // copied from the world by resetFrame, guarded by mutex_
+    std::atomic<uint32_t> culledDistanceChunks_ = 0;
+    std::atomic<uint32_t> culledEmptyChunks_ = 0;
+    std::atomic<uint64_t> totalInstancedChunks_ = 0;
+    std::atomic<uint64_t> totalLodChunks_ = 0;
+    std::atomic<uint64_t> totalCulledDistanceChunks_ = 0;
+    std::atomic<uint64_t> totalCulledEmptyChunks_ = 0;
+    std::shared_ptr<vk::GeometryArena> geometryArena_;
+    std::shared_ptr<vk::QuadIndexBuffer> quadIndices_;
 
     std::shared_ptr<std::vector<std::shared_ptr<vk::BLASBuilder>>> importantBLASBuilders_;
+
+    // declared last so that its workers are joined before anything they touch is destroyed
+    std::shared_ptr<ChunkBuildWorkers> chunkBuildWorkers_;
 };
@@ -9,6 +9,8 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <filesystem>
+#include <string_view>
 #include <unordered_map>
 
 using Vertex = glm::vec3;
@@ -28,6 +30,101 @@ struct TriangleHash {
     }
 };
 
+namespace {
+// picks the conversion kernel once per geometry, unknown formats leave the zero initialized vertices in place
+void convertVertices(World::VertexFormats format, void *src, uint32_t count, int textureID,
+                     vk::VertexFormat::PBRVertex *dst) {
+    auto convert = [&]<typename T>() {
+        vk::Vertex::convertToPBRVertices(static_cast<const T *>(src), count, textureID, dst);
+    };
+
+    switch (format) {
+        case World::POSITION_COLOR_TEXTURE_LIGHT_NORMAL:
+            convert.operator()<vk::VertexFormat::PositionColorTexLightNormal>();
+            break;
+        case World::POSITION_COLOR_TEXTURE_OVERLAY_LIGHT_NORMAL:
+            convert.operator()<vk::VertexFormat::PositionColorTexOverlayLightNormal>();
+            break;
+        case World::POSITION_TEXTURE_COLOR_LIGHT: convert.operator()<vk::VertexFormat::PositionTexColorLight>(); break;
+        case World::POSITION: convert.operator()<vk::VertexFormat::PositionOnly>(); break;
+        case World::POSITION_COLOR: convert.operator()<vk::VertexFormat::PositionColor>(); break;
+        case World::LINES: convert.operator()<vk::VertexFormat::PositionColorNormal>(); break;
+        case World::POSITION_COLOR_LIGHT: convert.operator()<vk::VertexFormat::PositionColorLight>(); break;
+        case World::POSITION_TEXTURE: convert.operator()<vk::VertexFormat::PositionTex>(); break;
+        case World::POSITION_TEXTURE_COLOR: convert.operator()<vk::VertexFormat::PositionTexColor>(); break;
+        case World::POSITION_COLOR_TEXTURE_LIGHT: convert.operator()<vk::VertexFormat::PositionColorTexLight>(); break;
+        case World::POSITION_TEXTURE_LIGHT_COLOR: convert.operator()<vk::VertexFormat::PositionTexLightColor>(); break;
+        case World::POSITION_TEXTURE_COLOR_NORMAL:
+            convert.operator()<vk::VertexFormat::PositionTexColorNormal>();
+            break;
+        default: break;
+    }
+}
+
+size_t rawVertexSize(World::VertexFormats format) {
+    // PBR_TRIANGLE is already in its final layout and never expanded
+    return format == World::PBR_TRIANGLE ? 0 : World::vertexSize(format);
+}
+
+// matches the push constant block of expand_vertices.comp
+struct ExpandPushConstant {
+    uint32_t jobCount;
+    uint32_t threadCount;
+    uint32_t packedMaterial;
+    uint32_t pad0;
+};
+
+// everything a BLAS refit has to keep: geometry count, vertex and index counts, opacity and the index data itself
+uint64_t geometrySignature(const EntityBuildData &data) {
+    std::size_t seed = 0;
+    TriangleHash::hash_combine(seed, data.geometryCount);
+    for (int i = 0; i < data.geometryCount; i++) {
+        TriangleHash::hash_combine(seed, data.vertexCount(i));
+        TriangleHash::hash_combine(seed, data.indices[i].size());
+        TriangleHash::hash_combine(seed, data.geometryTypes[i] == World::WORLD_SOLID);
+        for (uint32_t index : data.indices[i]) { TriangleHash::hash_combine(seed, index); }
+    }
+    return seed;
+}
+
+uint64_t geometryContentHash(const EntityBuildData &data) {
+    std::size_t seed = geometrySignature(data);
+    for (int i = 0; i < data.geometryCount; i++) {
+        std::string_view bytes(reinterpret_cast<const char *>(data.vertices[i].data()),
+                               data.vertices[i].size() * sizeof(vk::VertexFormat::PBRVertex));
+        TriangleHash::hash_combine(seed, std::hash<std::string_view>{}(bytes));
+        if (data.expandsOnGpu(i)) {
+            const auto &raw = data.rawGeometries[i];
+            TriangleHash::hash_combine(seed, raw.format);
+            TriangleHash::hash_combine(seed, std::hash<std::string_view>{}(std::string_view(
+                                                 reinterpret_cast<const char *>(raw.bytes.data()), raw.bytes.size())));
+        }
+    }
+    return seed;
+}
+
+bool sameGeometry(const EntityBuildData &a, const EntityBuildData &b) {
+    if (a.geometryCount != b.geometryCount) return false;
+    for (int i = 0; i < a.geometryCount; i++) {
+        if (a.geometryTypes[i] != b.geometryTypes[i] || a.indices[i] != b.indices[i]) return false;
+        if (a.vertices[i].size() != b.vertices[i].size()) return false;
+        if (std::memcmp(a.vertices[i].data(), b.vertices[i].data(),
+                        a.vertices[i].size() * sizeof(vk::VertexFormat::PBRVertex)) != 0) {
+            return false;
+        }
+        if (a.expandsOnGpu(i) != b.expandsOnGpu(i)) return false;
+        if (a.expandsOnGpu(i)) {
+            const auto &rawA = a.rawGeometries[i];
+            const auto &rawB = b.rawGeometries[i];
+            if (a.coordinate != b.coordinate || rawA.format != rawB.format || rawA.textureID != rawB.textureID ||
+                rawA.normalOffset != rawB.normalOffset || rawA.bytes != rawB.bytes) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+} // namespace
 
 EntityBuildData::EntityBuildData(int hashCode,
                                  double x,
@@ -38,7 +135,7 @@ EntityBuildData::EntityBuildData(int hashCode,
                                  World::Coordinates coordinate,
                                  uint32_t geometryCount,
                                  std::vector<World::GeometryTypes> &&geometryTypes,
-                                 std::vector<std::string> &&geometryGroupNames,
+                                 std::vector<uint32_t> &&geometryGroups,
                                  std::vector<std::vector<vk::VertexFormat::PBRVertex>> &&vertices,
                                  std::vector<std::vector<uint32_t>> &&indices)
     : hashCode(hashCode),
@@ -50,7 +147,7 @@ EntityBuildData::EntityBuildData(int hashCode,
       coordinate(coordinate),
       geometryCount(geometryCount),
       geometryTypes(std::move(geometryTypes)),
-      geometryGroupNames(std::move(geometryGroupNames)),
+      geometryGroups(std::move(geometryGroups)),
       vertices(std::move(vertices)),
       indices(std::move(indices)),
       vertexBufferAddresses(),
@@ -58,11 +155,20 @@ EntityBuildData::EntityBuildData(int hashCode,
       positionBufferAddresses(),
       materialBufferAddresses() {}
 
+uint32_t EntityBuildData::vertexCount(uint32_t geometry) const {
+    return expandsOnGpu(geometry) ? rawGeometries[geometry].vertexCount
+                                  : static_cast<uint32_t>(vertices[geometry].size());
+}
+
+bool EntityBuildData::expandsOnGpu(uint32_t geometry) const {
+    return geometry < rawGeometries.size() && !rawGeometries[geometry].bytes.empty();
+}
+
 void EntityBuildDataBatch::addData(std::shared_ptr<EntityBuildData> data) {
     datas.push_back(data);
 }
 
-void EntityBuildDataBatch::build() {
+void EntityBuildDataBatch::build(std::unordered_map<int, EntityBLAS> &blasCache) {
     auto framework = Renderer::instance().framework();
     auto vma = framework->vma();
     auto device = framework->device();
@@ -75,28 +181,72 @@ void EntityBuildDataBatch::build() {
     uint32_t totalVertexCount = 0;
     uint32_t totalIndexCount = 0;
 
-    for (auto data : datas) {
+    // entities with identical geometry (dropped items, minecarts, chests...) share the streams and the BLAS of the
+    // first of them and only differ in their instance transform
+    std::vector<int> sharedWith(datas.size(), -1);
+    {
+        std::unordered_map<uint64_t, std::vector<uint32_t>> representatives;
+        for (uint32_t i = 0; i < datas.size(); i++) {
+            if (datas[i]->prebuiltBLAS >= 0) continue;
+            auto &candidates = representatives[geometryContentHash(*datas[i])];
+            for (uint32_t candidate : candidates) {
+                if (sameGeometry(*datas[candidate], *datas[i])) {
+                    sharedWith[i] = candidate;
+                    break;
+                }
+            }
+            if (sharedWith[i] < 0) candidates.push_back(i);
+        }
+    }
+    instancedCount = static_cast<uint32_t>(
+        std::count_if(sharedWith.begin(), sharedWith.end(), [](int representative) { return representative >= 0; }));
+    uniqueCount = static_cast<uint32_t>(datas.size()) - instancedCount;
+
+    // geometries expanded on the gpu go behind all the others so that the cpu part uploads as one range
+    cpuVertexCount = 0;
+    for (int instanceIndex = 0; auto data : datas) {
+        if (sharedWith[instanceIndex++] >= 0) continue;
+        for (int i = 0; i < data->geometryCount; i++) {
+            if (!data->expandsOnGpu(i)) cpuVertexCount += data->vertices[i].size();
+        }
+    }
+    uint32_t expandedVertexCursor = cpuVertexCount;
+    uint32_t cpuVertexCursor = 0;
+
+    for (int instanceIndex = 0; auto data : datas) {
+        if (sharedWith[instanceIndex] >= 0) {
+            instanceOffsets.push_back(instanceOffsets[sharedWith[instanceIndex]]);
+            instanceIndex++;
+            continue;
+        }
+        instanceIndex++;
+
         instanceOffsets.push_back(totalGeometryCount);
         for (int i = 0; i < data->geometryCount; i++) {
-            geometryVertexOffsets.push_back(totalVertexCount);
+            uint32_t &vertexCursor = data->expandsOnGpu(i) ? expandedVertexCursor : cpuVertexCursor;
+            geometryVertexOffsets.push_back(vertexCursor);
             geometryIndexOffsets.push_back(totalIndexCount);
 
-            totalVertexCount += data->vertices[i].size();
+            vertexCursor += data->vertexCount(i);
+            totalVertexCount += data->vertexCount(i);
             totalIndexCount += data->indices[i].size();
         }
 
         totalGeometryCount += data->geometryCount;
     }
+    expandedVertexCount = totalVertexCount - cpuVertexCount;
 
     vertexBuffer = vk::DeviceLocalBuffer::create(
         vma, device, totalVertexCount * sizeof(vk::VertexFormat::PBRVertex),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
     positionBuffer = vk::DeviceLocalBuffer::create(
         vma, device, totalVertexCount * sizeof(vk::VertexFormat::PositionVertex),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    packedMaterial = Renderer::instance().world()->packedMaterialVertex();
+    size_t materialVertexSize = vk::Vertex::materialVertexSize(packedMaterial);
     materialBuffer = vk::DeviceLocalBuffer::create(
-        vma, device, totalVertexCount * sizeof(vk::VertexFormat::MaterialVertex),
+        vma, device, totalVertexCount * materialVertexSize,
         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
     indexBuffer = vk::DeviceLocalBuffer::create(
         vma, device, totalIndexCount * sizeof(uint32_t),
@@ -105,10 +255,36 @@ void EntityBuildDataBatch::build() {
 
     vk::VertexFormat::PBRVertex *vertexPtr = static_cast<vk::VertexFormat::PBRVertex *>(vertexBuffer->mappedPtr());
     auto *positionPtr = static_cast<vk::VertexFormat::PositionVertex *>(positionBuffer->mappedPtr());
-    auto *materialPtr = static_cast<vk::VertexFormat::MaterialVertex *>(materialBuffer->mappedPtr());
+    auto *materialPtr = static_cast<uint8_t *>(materialBuffer->mappedPtr());
     uint32_t *indexPtr = static_cast<uint32_t *>(indexBuffer->mappedPtr());
-    for (auto data : datas) {
+    std::vector<uint8_t> rawBytes;
+    expandJobs.clear();
+    for (int instanceIndex = 0; auto data : datas) {
+        if (sharedWith[instanceIndex] >= 0) {
+            instanceIndex++;
+            continue;
+        }
+        uint32_t instanceOffset = instanceOffsets[instanceIndex++];
         for (int i = 0; i < data->geometryCount; i++) {
+            std::memcpy(indexPtr, data->indices[i].data(), data->indices[i].size() * sizeof(uint32_t));
+            indexPtr += data->indices[i].size();
+
+            if (data->expandsOnGpu(i)) {
+                const auto &raw = data->rawGeometries[i];
+                expandJobs.push_back({
+                    .srcWord = static_cast<uint32_t>(rawBytes.size() / sizeof(uint32_t)),
+                    .format = static_cast<uint32_t>(raw.format),
+                    .firstThread = geometryVertexOffsets[instanceOffset + i] - cpuVertexCount,
+                    .vertexCount = raw.vertexCount,
+                    .dstVertex = geometryVertexOffsets[instanceOffset + i],
+                    .textureID = raw.textureID,
+                    .coordinate = static_cast<uint32_t>(data->coordinate),
+                    .normalOffset = raw.normalOffset ? 1u : 0u,
+                });
+                rawBytes.insert(rawBytes.end(), raw.bytes.begin(), raw.bytes.end());
+                continue;
+            }
+
             std::memcpy(vertexPtr, data->vertices[i].data(),
                         data->vertices[i].size() * sizeof(vk::VertexFormat::PBRVertex));
             vertexPtr += data->vertices[i].size();
@@ -118,13 +294,9 @@ void EntityBuildDataBatch::build() {
                         positionVertices.size() * sizeof(vk::VertexFormat::PositionVertex));
             positionPtr += positionVertices.size();
 
-            auto materialVertices = vk::Vertex::buildMaterialVertices(data->vertices[i]);
-            std::memcpy(materialPtr, materialVertices.data(),
-                        materialVertices.size() * sizeof(vk::VertexFormat::MaterialVertex));
-            materialPtr += materialVertices.size();
-
-            std::memcpy(indexPtr, data->indices[i].data(), data->indices[i].size() * sizeof(uint32_t));
-            indexPtr += data->indices[i].size();
+            auto materialStream = vk::Vertex::buildMaterialStream(data->vertices[i], packedMaterial);
+            std::memcpy(materialPtr, materialStream.data(), materialStream.size());
+            materialPtr += materialStream.size();
         }
 
         totalGeometryCount += data->geometryCount;
@@ -134,15 +306,55 @@ void EntityBuildDataBatch::build() {
     materialBuffer->flushStagingBuffer();
     indexBuffer->flushStagingBuffer();
 
+    if (!expandJobs.empty()) {
+        rawVertexBuffer =
+            vk::DeviceLocalBuffer::create(vma, device, rawBytes.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        rawVertexBuffer->uploadToStagingBuffer(rawBytes.data());
+        expandJobBuffer =
+            vk::DeviceLocalBuffer::create(vma, device, expandJobs.size() * sizeof(vk::Data::EntityExpandJob),
+                                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        expandJobBuffer->uploadToStagingBuffer(expandJobs.data());
+    }
+
+    uint32_t maxRefits = Renderer::options.entityBLASMaxRefits;
+    std::unordered_map<int, EntityBLAS> nextBlasCache;
+
     blasBatchBuilder = vk::BLASBatchBuilder::create();
     std::vector<uint32_t> nonPrebuildInstances;
+    std::vector<EntityBLAS *> cacheEntries; // nullptr for BLASes that are not kept
     for (int instanceIndex = 0; auto data : datas) {
         auto instanceOffset = instanceOffsets[instanceIndex];
         std::shared_ptr<vk::BLASBuilder> blasBuilder = nullptr;
         std::shared_ptr<vk::BLASBuilder::BLASGeometryBuilder> blasGeometryBuilder = nullptr;
-        if (data->prebuiltBLAS < 0) {
+        std::shared_ptr<vk::BLAS> refitBLAS = nullptr;
+        bool cacheable = false;
+        bool ownsBLAS = data->prebuiltBLAS < 0 && sharedWith[instanceIndex] < 0;
+        if (ownsBLAS) {
             nonPrebuildInstances.push_back(instanceIndex);
-            blasBuilder = blasBatchBuilder->defineBLASBuilder();
+
+            // a hash code showing up twice in one frame gets a throwaway BLAS for every repetition
+            cacheable = maxRefits > 0 && !nextBlasCache.contains(data->hashCode);
+            if (cacheable) {
+                uint64_t signature = geometrySignature(*data);
+                auto cached = blasCache.find(data->hashCode);
+                bool refit = cached != blasCache.end() && cached->second.signature == signature &&
+                             cached->second.refitsSinceRebuild < maxRefits;
+
+                auto &entry = nextBlasCache[data->hashCode];
+                entry.signature = signature;
+                if (refit) {
+                    refitBLAS = cached->second.blas;
+                    entry.refitsSinceRebuild = cached->second.refitsSinceRebuild + 1;
+                    blasBuilder = blasBatchBuilder->defineRefitBLASBuilder(refitBLAS);
+                } else {
+                    entry.refitsSinceRebuild = 0;
+                    blasBuilder = blasBatchBuilder->defineDedicatedBLASBuilder();
+                }
+                cacheEntries.push_back(&entry);
+            } else {
+                blasBuilder = blasBatchBuilder->defineBLASBuilder();
+                cacheEntries.push_back(nullptr);
+            }
             blasGeometryBuilder = blasBuilder->beginGeometries();
         }
         for (int i = 0; i < data->geometryCount; i++) {
@@ -155,29 +367,44 @@ void EntityBuildDataBatch::build() {
                 positionBuffer->bufferAddress() +
                 geometryVertexOffsets[instanceOffset + i] * sizeof(vk::VertexFormat::PositionVertex);
             VkDeviceAddress materialBufferAddress =
-                materialBuffer->bufferAddress() +
-                geometryVertexOffsets[instanceOffset + i] * sizeof(vk::VertexFormat::MaterialVertex);
+                materialBuffer->bufferAddress() + geometryVertexOffsets[instanceOffset + i] * materialVertexSize;
             data->vertexBufferAddresses.push_back(vertexBufferAddress);
             data->indexBufferAddresses.push_back(indexBufferAddress);
             data->positionBufferAddresses.push_back(positionBufferAddress);
             data->materialBufferAddresses.push_back(materialBufferAddress);
-            if (data->prebuiltBLAS < 0) {
-                blasGeometryBuilder->defineTriangleGeomrtry<vk::VertexFormat::PBRVertex>(
-                    vertexBufferAddress, data->vertices[i].size(), indexBufferAddress, data->indices[i].size(),
+            if (ownsBLAS) {
+                blasGeometryBuilder->defineTriangleGeomrtry<vk::VertexFormat::PositionVertex>(
+                    positionBufferAddress, data->vertexCount(i), indexBufferAddress, data->indices[i].size(),
                     data->geometryTypes[i] == World::WORLD_SOLID);
             }
         }
-        if (data->prebuiltBLAS < 0) {
+        if (ownsBLAS) {
             blasGeometryBuilder->endGeometries();
-            blasBuilder->defineBuildProperty(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR)
-                ->querySizeInfo(device);
+            VkBuildAccelerationStructureFlagsKHR flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+            if (cacheable) flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+            if (refitBLAS != nullptr) {
+                blasBuilder->defineUpdateProperty(flags, refitBLAS->blas())->querySizeInfo(device);
+            } else {
+                blasBuilder->defineBuildProperty(flags)->querySizeInfo(device);
+            }
         }
 
         instanceIndex++;
     }
 
     auto blass = blasBatchBuilder->allocateBuffers(physicalDevice, device, vma)->build(device);
-    for (int i = 0; i < nonPrebuildInstances.size(); i++) { datas[nonPrebuildInstances[i]]->blas = blass[i]; }
+    for (int i = 0; i < nonPrebuildInstances.size(); i++) {
+        datas[nonPrebuildInstances[i]]->blas = blass[i];
+        if (cacheEntries[i] != nullptr) cacheEntries[i]->blas = blass[i];
+    }
+    for (int i = 0; i < datas.size(); i++) {
+        if (sharedWith[i] >= 0) datas[i]->blas = datas[sharedWith[i]]->blas;
+    }
+
+    // the previous frame on this context has finished, BLASes that were not carried over can go
+    auto &gc = framework->gc();
+    for (auto &[hashCode, entry] : blasCache) { gc.collect(entry.blas); }
+    blasCache = std::move(nextBlasCache);
 }
 
 void EntityPostBuildDataBatch::addData(std::shared_ptr<EntityBuildData> data) {
@@ -205,7 +432,8 @@ Entity::Entity(std::shared_ptr<EntityBuildData> chunkBuildData) {
 
     geometryCount = chunkBuildData->geometryCount;
     geometryTypes = std::make_shared<std::vector<World::GeometryTypes>>(std::move(chunkBuildData->geometryTypes));
-    geometryGroupNames = std::make_shared<std::vector<std::string>>(std::move(chunkBuildData->geometryGroupNames));
+    geometryGroups = std::make_shared<std::vector<uint32_t>>(std::move(chunkBuildData->geometryGroups));
+    for (int i = 0; i < geometryCount; i++) { vertexCounts.push_back(chunkBuildData->vertexCount(i)); }
     vertices =
         std::make_shared<std::vector<std::vector<vk::VertexFormat::PBRVertex>>>(std::move(chunkBuildData->vertices));
     indices = std::make_shared<std::vector<std::vector<uint32_t>>>(std::move(chunkBuildData->indices));
@@ -280,6 +508,10 @@ void Entities::resetFrame() {
 
     gc.collect(blasBatchBuilder_);
     blasBatchBuilder_ = nullptr;
+
+    // the queues are idle whenever the number of frame contexts changes
+    blasCaches_.resize(framework->swapchain()->imageCount());
+    expandDescriptorTables_.resize(framework->swapchain()->imageCount());
 }
 
 void Entities::queueBuild(EntitiesBuildTask task) {
@@ -299,9 +531,11 @@ void Entities::queueBuild(EntitiesBuildTask task) {
 
         uint32_t allVertexCount = 0, allIndexCount = 0;
         std::vector<World::GeometryTypes> geometryTypes;
-        std::vector<std::string> geometryGroupNames;
+        std::vector<uint32_t> geometryGroups;
         std::vector<std::vector<vk::VertexFormat::PBRVertex>> vertices;
         std::vector<std::vector<uint32_t>> indices;
+        std::vector<EntityRawGeometry> rawGeometries;
+        bool anyRawGeometry = false;
         int hashCode = task.entityHashCodes[e];
         double x = task.entityXs[e];
         double y = task.entityYs[e];
@@ -318,311 +552,48 @@ void Entities::queueBuild(EntitiesBuildTask task) {
             int geometryTexture = task.geometryTextures[geometryIndex + i];
             geometryTypes.push_back(geometryType);
             if (task.geometryGroupNames != nullptr && task.geometryGroupNames[geometryIndex + i] != nullptr) {
-                geometryGroupNames.emplace_back(task.geometryGroupNames[geometryIndex + i]);
+                geometryGroups.push_back(World::internGeometryGroup(task.geometryGroupNames[geometryIndex + i]));
             } else {
-                geometryGroupNames.emplace_back("Entity");
+                geometryGroups.push_back(World::internGeometryGroup("Entity"));
             }
 
             auto &geometryVertices = vertices.emplace_back();
             auto &geometryIndices = indices.emplace_back();
-
-            if (task.vertexFormats[geometryIndex + i] == World::PBR_TRIANGLE) {
+            auto &rawGeometry = rawGeometries.emplace_back();
+
+            // quads need no cpu side rework besides the normal offset, the expansion pass does that one as well
+            auto drawMode = static_cast<World::DrawMode>(task.indexFormats[geometryIndex + i]);
+            auto vertexFormat = static_cast<World::VertexFormats>(task.vertexFormats[geometryIndex + i]);
+            bool expandOnGpu = Renderer::options.gpuEntityVertexExpansion && !post &&
+                               drawMode == World::DrawMode::QUADS && rawVertexSize(vertexFormat) > 0 &&
+                               task.vertexCounts[geometryIndex + i] > 0;
+
+            if (expandOnGpu) {
+                auto *src = static_cast<const uint8_t *>(task.vertices[geometryIndex + i]);
+                rawGeometry.format = vertexFormat;
+                rawGeometry.vertexCount = task.vertexCounts[geometryIndex + i];
+                rawGeometry.textureID = geometryTexture;
+                rawGeometry.normalOffset = task.normalOffset;
+                rawGeometry.bytes.assign(src, src + rawGeometry.vertexCount * rawVertexSize(vertexFormat));
+                anyRawGeometry = true;
+            } else if (task.vertexFormats[geometryIndex + i] == World::PBR_TRIANGLE) {
                 geometryVertices.resize(task.vertexCounts[geometryIndex + i]);
                 std::memcpy(geometryVertices.data(), task.vertices[geometryIndex + i],
                             task.vertexCounts[geometryIndex + i] * sizeof(vk::VertexFormat::PBRVertex));
             } else {
-                for (int j = 0; j < task.vertexCounts[geometryIndex + i]; j++) {
-                    vk::VertexFormat::PBRVertex vertex{};
-
-                    switch (task.vertexFormats[geometryIndex + i]) {
-                        case World::POSITION_COLOR_TEXTURE_LIGHT_NORMAL: {
-                            vk::VertexFormat::PositionColorTexLightNormal *vertices =
-                                static_cast<vk::VertexFormat::PositionColorTexLightNormal *>(
-                                    task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useColorLayer = 1;
-                            vertex.colorLayer = glm::vec4{
-                                vertices[j].color & 0xFF,
-                                (vertices[j].color >> 8) & 0xFF,
-                                (vertices[j].color >> 16) & 0xFF,
-                                (vertices[j].color >> 24) & 0xFF,
-                            };
-                            vertex.colorLayer /= 255.0;
-
-                            vertex.useTexture = 1;
-                            vertex.textureUV = vertices[j].uv0;
-
-                            vertex.useLight = 1;
-                            vertex.lightUV = glm::ivec2{
-                                vertices[j].uv2 & 0xFFFF,
-                                (vertices[j].uv2 >> 16) & 0xFFFF,
-                            };
-
-                            vertex.useNorm = 1;
-                            vertex.norm = glm::vec3{
-                                (int8_t)(vertices[j].normal & 0xFF),
-                                (int8_t)((vertices[j].normal >> 8) & 0xFF),
-                                (int8_t)((vertices[j].normal >> 16) & 0xFF),
-                            };
-
-                            break;
-                        }
-                        case World::POSITION_COLOR_TEXTURE_OVERLAY_LIGHT_NORMAL: {
-                            vk::VertexFormat::PositionColorTexOverlayLightNormal *vertices =
-                                static_cast<vk::VertexFormat::PositionColorTexOverlayLightNormal *>(
-                                    task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useColorLayer = 1;
-                            vertex.colorLayer = glm::vec4{
-                                vertices[j].color & 0xFF,
-                                (vertices[j].color >> 8) & 0xFF,
-                                (vertices[j].color >> 16) & 0xFF,
-                                (vertices[j].color >> 24) & 0xFF,
-                            };
-                            vertex.colorLayer /= 255.0;
-
-                            vertex.useTexture = 1;
-                            vertex.textureUV = vertices[j].uv0;
-
-                            vertex.useOverlay = 1;
-                            vertex.overlayUV = glm::ivec2{vertices[j].uv1 & 0xFFFF, (vertices[j].uv1 >> 16) & 0xFFFF};
-
-                            vertex.useLight = 1;
-                            vertex.lightUV = glm::vec2{
-                                vertices[j].uv2 & 0xFFFF,
-                                (vertices[j].uv2 >> 16) & 0xFFFF,
-                            };
-
-                            vertex.useNorm = 1;
-                            vertex.norm = glm::vec3{
-                                (int8_t)(vertices[j].normal & 0xFF),
-                                (int8_t)((vertices[j].normal >> 8) & 0xFF),
-                                (int8_t)((vertices[j].normal >> 16) & 0xFF),
-                            };
-
-                            break;
-                        }
-                        case World::POSITION_TEXTURE_COLOR_LIGHT: {
-                            vk::VertexFormat::PositionTexColorLight *vertices =
-                                static_cast<vk::VertexFormat::PositionTexColorLight *>(
-                                    task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useTexture = 1;
-                            vertex.textureUV = vertices[j].uv0;
-
-                            vertex.useColorLayer = 1;
-                            vertex.colorLayer = glm::vec4{
-                                vertices[j].color & 0xFF,
-                                (vertices[j].color >> 8) & 0xFF,
-                                (vertices[j].color >> 16) & 0xFF,
-                                (vertices[j].color >> 24) & 0xFF,
-                            };
-                            vertex.colorLayer /= 255.0;
-
-                            vertex.useLight = 1;
-                            vertex.lightUV = glm::vec2{
-                                vertices[j].uv2 & 0xFFFF,
-                                (vertices[j].uv2 >> 16) & 0xFFFF,
-                            };
-
-                            break;
-                        }
-                        case World::POSITION: {
-                            vk::VertexFormat::PositionOnly *vertices =
-                                static_cast<vk::VertexFormat::PositionOnly *>(task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            break;
-                        }
-                        case World::POSITION_COLOR: {
-                            vk::VertexFormat::PositionColor *vertices =
-                                static_cast<vk::VertexFormat::PositionColor *>(task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useColorLayer = 1;
-                            vertex.colorLayer = glm::vec4{
-                                vertices[j].color & 0xFF,
-                                (vertices[j].color >> 8) & 0xFF,
-                                (vertices[j].color >> 16) & 0xFF,
-                                (vertices[j].color >> 24) & 0xFF,
-                            };
-                            vertex.colorLayer /= 255.0;
-
-                            break;
-                        }
-                        case World::LINES: {
-                            vk::VertexFormat::PositionColorNormal *vertices =
-                                static_cast<vk::VertexFormat::PositionColorNormal *>(task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useColorLayer = 1;
-                            vertex.colorLayer = glm::vec4{
-                                vertices[j].color & 0xFF,
-                                (vertices[j].color >> 8) & 0xFF,
-                                (vertices[j].color >> 16) & 0xFF,
-                                (vertices[j].color >> 24) & 0xFF,
-                            };
-                            vertex.colorLayer /= 255.0;
-
-                            vertex.useNorm = 1;
-                            vertex.norm = glm::vec3{
-                                (int8_t)(vertices[j].normal & 0xFF),
-                                (int8_t)((vertices[j].normal >> 8) & 0xFF),
-                                (int8_t)((vertices[j].normal >> 16) & 0xFF),
-                            };
-
-                            break;
-                        }
-                        case World::POSITION_COLOR_LIGHT: {
-                            vk::VertexFormat::PositionColorLight *vertices =
-                                static_cast<vk::VertexFormat::PositionColorLight *>(task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useColorLayer = 1;
-                            vertex.colorLayer = glm::vec4{
-                                vertices[j].color & 0xFF,
-                                (vertices[j].color >> 8) & 0xFF,
-                                (vertices[j].color >> 16) & 0xFF,
-                                (vertices[j].color >> 24) & 0xFF,
-                            };
-                            vertex.colorLayer /= 255.0;
-
-                            vertex.useLight = 1;
-                            vertex.lightUV = glm::vec2{
-                                vertices[j].uv2 & 0xFFFF,
-                                (vertices[j].uv2 >> 16) & 0xFFFF,
-                            };
-
-                            break;
-                        }
-                        case World::POSITION_TEXTURE: {
-                            vk::VertexFormat::PositionTex *vertices =
-                                static_cast<vk::VertexFormat::PositionTex *>(task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useTexture = 1;
-                            vertex.textureUV = vertices[j].uv;
-
-                            break;
-                        }
-                        case World::POSITION_TEXTURE_COLOR: {
-                            vk::VertexFormat::PositionTexColor *vertices =
-                                static_cast<vk::VertexFormat::PositionTexColor *>(task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useTexture = 1;
-                            vertex.textureUV = vertices[j].uv;
-
-                            vertex.useColorLayer = 1;
-                            vertex.colorLayer = glm::vec4{
-                                vertices[j].color & 0xFF,
-                                (vertices[j].color >> 8) & 0xFF,
-                                (vertices[j].color >> 16) & 0xFF,
-                                (vertices[j].color >> 24) & 0xFF,
-                            };
-                            vertex.colorLayer /= 255.0;
-
-                            break;
-                        }
-                        case World::POSITION_COLOR_TEXTURE_LIGHT: {
-                            vk::VertexFormat::PositionColorTexLight *vertices =
-                                static_cast<vk::VertexFormat::PositionColorTexLight *>(
-                                    task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useColorLayer = 1;
-                            vertex.colorLayer = glm::vec4{
-                                vertices[j].color & 0xFF,
-                                (vertices[j].color >> 8) & 0xFF,
-                                (vertices[j].color >> 16) & 0xFF,
-                                (vertices[j].color >> 24) & 0xFF,
-                            };
-                            vertex.colorLayer /= 255.0;
-
-                            vertex.useTexture = 1;
-                            vertex.textureUV = vertices[j].uv0;
-
-                            vertex.useLight = 1;
-                            vertex.lightUV = glm::vec2{
-                                vertices[j].uv2 & 0xFFFF,
-                                (vertices[j].uv2 >> 16) & 0xFFFF,
-                            };
-
-                            break;
-                        }
-                        case World::POSITION_TEXTURE_LIGHT_COLOR: {
-                            vk::VertexFormat::PositionTexLightColor *vertices =
-                                static_cast<vk::VertexFormat::PositionTexLightColor *>(
-                                    task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useTexture = 1;
-                            vertex.textureUV = vertices[j].uv0;
-
-                            vertex.useLight = 1;
-                            vertex.lightUV = glm::vec2{
-                                vertices[j].uv2 & 0xFFFF,
-                                (vertices[j].uv2 >> 16) & 0xFFFF,
-                            };
-
-                            vertex.useColorLayer = 1;
-                            vertex.colorLayer = glm::vec4{
-                                vertices[j].color & 0xFF,
-                                (vertices[j].color >> 8) & 0xFF,
-                                (vertices[j].color >> 16) & 0xFF,
-                                (vertices[j].color >> 24) & 0xFF,
-                            };
-                            vertex.colorLayer /= 255.0;
-
-                            break;
-                        }
-                        case World::POSITION_TEXTURE_COLOR_NORMAL: {
-                            vk::VertexFormat::PositionTexColorNormal *vertices =
-                                static_cast<vk::VertexFormat::PositionTexColorNormal *>(
-                                    task.vertices[geometryIndex + i]);
-
-                            vertex.pos = vertices[j].position;
-
-                            vertex.useTexture = 1;
-                            vertex.textureUV = vertices[j].uv0;
-
-                            vertex.useColorLayer = 1;
-                            vertex.colorLayer = glm::vec4{
-                                vertices[j].color & 0xFF,
-                                (vertices[j].color >> 8) & 0xFF,
-                                (vertices[j].color >> 16) & 0xFF,
-                                (vertices[j].color >> 24) & 0xFF,
-                            };
-                            vertex.colorLayer /= 255.0;
-
-                            vertex.useNorm = 1;
-                            vertex.norm = glm::vec3{
-                                (int8_t)(vertices[j].normal & 0xFF),
-                                (int8_t)((vertices[j].normal >> 8) & 0xFF),
-                                (int8_t)((vertices[j].normal >> 16) & 0xFF),
-                            };
-
-                            break;
-                        }
-                    }
-
-                    vertex.textureID = geometryTexture;
-
-                    geometryVertices.push_back(vertex);
+                auto format = static_cast<World::VertexFormats>(task.vertexFormats[geometryIndex + i]);
+                uint32_t vertexCount = task.vertexCounts[geometryIndex + i];
+                geometryVertices.resize(vertexCount);
+
+                auto conversionStart = std::chrono::steady_clock::now();
+                convertVertices(format, task.vertices[geometryIndex + i], vertexCount, geometryTexture,
+                                geometryVertices.data());
+                auto conversionTime = std::chrono::steady_clock::now() - conversionStart;
+
+                if (format < World::NUM_VERTEX_FORMATS) {
+                    convertedVertices_[format] += vertexCount;
+                    conversionNanoseconds_[format] +=
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(conversionTime).count();
                 }
             }
 
@@ -672,7 +643,7 @@ void Entities::queueBuild(EntitiesBuildTask task) {
                 return {true, {b00, b10, b11, b01, t00, t10, t11, t01}};
             };
 
-            switch (static_cast<World::DrawMode>(task.indexFormats[geometryIndex + i])) {
+            switch (drawMode) {
                 case World::DrawMode::QUADS: {
                     for (int j = 0; j < task.vertexCounts[geometryIndex + i]; j += 4) {
                         geometryIndices.push_back(j + 0);
@@ -682,6 +653,8 @@ void Entities::queueBuild(EntitiesBuildTask task) {
                         geometryIndices.push_back(j + 3);
                         geometryIndices.push_back(j + 0);
 
+                        if (expandOnGpu) continue;
+
                         if (task.normalOffset) {
                             if (geometryVertices[j + 0].useNorm)
                                 geometryVertices[j + 0].pos += 0.00001f * glm::normalize(geometryVertices[j + 0].norm);
@@ -874,13 +847,15 @@ void Entities::queueBuild(EntitiesBuildTask task) {
                 }
             }
 
-            if (geometryVertices.empty() || geometryIndices.empty()) {
+            uint32_t geometryVertexCount = expandOnGpu ? rawGeometry.vertexCount : geometryVertices.size();
+            if (geometryVertexCount == 0 || geometryIndices.empty()) {
                 vertices.pop_back();
                 indices.pop_back();
+                rawGeometries.pop_back();
                 geometryTypes.pop_back();
-                geometryGroupNames.pop_back();
+                geometryGroups.pop_back();
             } else {
-                allVertexCount += geometryVertices.size();
+                allVertexCount += geometryVertexCount;
                 allIndexCount += geometryIndices.size();
                 geometryCountWithoutGlint++;
             }
@@ -890,8 +865,9 @@ void Entities::queueBuild(EntitiesBuildTask task) {
 
         std::shared_ptr<EntityBuildData> chunkBuildData =
             EntityBuildData::create(hashCode, x, y, z, rayTracingFlag, prebuiltBLAS, coordinate, geometryCountWithoutGlint,
-                                    std::move(geometryTypes), std::move(geometryGroupNames), std::move(vertices),
+                                    std::move(geometryTypes), std::move(geometryGroups), std::move(vertices),
                                     std::move(indices));
+        if (anyRawGeometry) chunkBuildData->rawGeometries = std::move(rawGeometries);
 
         if (post) {
             entityPostBuildDataBatch_->addData(chunkBuildData);
@@ -912,12 +888,19 @@ void Entities::build() {
     auto device = framework->device();
     auto physicalDevice = framework->physicalDevice();
 
-    entityBuildDataBatch_->build();
-
-    Renderer::instance().buffers()->queueImportantWorldUpload(entityBuildDataBatch_->vertexBuffer,
-                                                              entityBuildDataBatch_->indexBuffer);
-    Renderer::instance().buffers()->queueImportantWorldUpload(entityBuildDataBatch_->positionBuffer);
-    Renderer::instance().buffers()->queueImportantWorldUpload(entityBuildDataBatch_->materialBuffer);
+    entityBuildDataBatch_->build(blasCaches_[framework->safeAcquireCurrentContext()->frameIndex]);
+    uniqueEntities_ = entityBuildDataBatch_->uniqueCount;
+    instancedEntities_ = entityBuildDataBatch_->instancedCount;
+    totalUniqueEntities_ += entityBuildDataBatch_->uniqueCount;
+    totalInstancedEntities_ += entityBuildDataBatch_->instancedCount;
+
+    Renderer::instance().buffers()->queueImportantWorldUpload(entityBuildDataBatch_->indexBuffer);
+    // with geometry left for the expansion pass, it uploads the cpu converted part of the streams itself
+    if (entityBuildDataBatch_->expandJobs.empty()) {
+        Renderer::instance().buffers()->queueImportantWorldUpload(entityBuildDataBatch_->vertexBuffer);
+        Renderer::instance().buffers()->queueImportantWorldUpload(entityBuildDataBatch_->positionBuffer);
+        Renderer::instance().buffers()->queueImportantWorldUpload(entityBuildDataBatch_->materialBuffer);
+    }
     blasBatchBuilder_ = entityBuildDataBatch_->blasBatchBuilder;
 
     entityBatch_ = EntityBatch::create(entityBuildDataBatch_);
@@ -937,6 +920,104 @@ void Entities::close() {
     entityBuildDataBatch_ = nullptr;
     entityPostBuildDataBatch_ = nullptr;
     blasBatchBuilder_ = nullptr;
+    blasCaches_.clear();
+    expandDescriptorTables_.clear();
+    expandPipeline_ = nullptr;
+    expandShader_ = nullptr;
+}
+
+void Entities::expandVertices(std::shared_ptr<vk::CommandBuffer> commandBuffer) {
+    auto batch = entityBuildDataBatch_;
+    if (batch == nullptr || batch->expandJobs.empty()) return;
+
+    auto framework = Renderer::instance().framework();
+    auto device = framework->device();
+    auto frameIndex = framework->safeAcquireCurrentContext()->frameIndex;
+    auto mainQueueIndex = framework->physicalDevice()->mainQueueIndex();
+
+    auto &descriptorTable = expandDescriptorTables_[frameIndex];
+    if (descriptorTable == nullptr) {
+        // jobs, raw vertices, then the vertex, position and material streams, the material one twice for both layouts
+        vk::DescriptorTableBuilder builder;
+        auto &setBinding = builder.beginDescriptorLayoutSet().beginDescriptorLayoutSetBinding();
+        for (uint32_t binding = 0; binding < 6; binding++) {
+            setBinding.defineDescriptorLayoutSetBinding({
+                .binding = binding,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            });
+        }
+        descriptorTable = setBinding.endDescriptorLayoutSetBinding()
+                              .endDescriptorLayoutSet()
+                              .definePushConstant(VkPushConstantRange{
+                                  .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                                  .offset = 0,
+                                  .size = sizeof(ExpandPushConstant),
+                              })
+                              .build(device);
+    }
+    if (expandPipeline_ == nullptr) {
+        std::filesystem::path shaderPath = Renderer::folderPath / "shaders";
+        expandShader_ = vk::Shader::create(device, (shaderPath / "world/entity/expand_vertices_comp.spv").string());
+        expandPipeline_ = vk::ComputePipelineBuilder{}
+                              .defineShader(expandShader_)
+                              .definePipelineLayout(descriptorTable)
+                              .build(device);
+    }
+
+    descriptorTable->bindBuffer(batch->expandJobBuffer, 0, 0);
+    descriptorTable->bindBuffer(batch->rawVertexBuffer, 0, 1);
+    descriptorTable->bindBuffer(batch->vertexBuffer, 0, 2);
+    descriptorTable->bindBuffer(batch->positionBuffer, 0, 3);
+    descriptorTable->bindBuffer(batch->materialBuffer, 0, 4);
+    descriptorTable->bindBuffer(batch->materialBuffer, 0, 5);
+
+    // every buffer here was created for this frame, nothing older can still be reading or writing them
+    size_t materialVertexSize = vk::Vertex::materialVertexSize(batch->packedMaterial);
+    if (batch->cpuVertexCount > 0) {
+        batch->vertexBuffer->uploadToBuffer(commandBuffer, batch->cpuVertexCount * sizeof(vk::VertexFormat::PBRVertex),
+                                            0, 0);
+        batch->positionBuffer->uploadToBuffer(
+            commandBuffer, batch->cpuVertexCount * sizeof(vk::VertexFormat::PositionVertex), 0, 0);
+        batch->materialBuffer->uploadToBuffer(commandBuffer, batch->cpuVertexCount * materialVertexSize, 0, 0);
+    }
+    batch->rawVertexBuffer->uploadToBuffer(commandBuffer);
+    batch->expandJobBuffer->uploadToBuffer(commandBuffer);
+
+    commandBuffer->barriersMemory({vk::CommandBuffer::MemoryBarrier{
+        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+    }});
+
+    ExpandPushConstant pc{
+        .jobCount = static_cast<uint32_t>(batch->expandJobs.size()),
+        .threadCount = batch->expandedVertexCount,
+        .packedMaterial = batch->packedMaterial ? 1u : 0u,
+        .pad0 = 0,
+    };
+    vkCmdPushConstants(commandBuffer->vkCommandBuffer(), descriptorTable->vkPipelineLayout(),
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ExpandPushConstant), &pc);
+    commandBuffer->bindDescriptorTable(descriptorTable, VK_PIPELINE_BIND_POINT_COMPUTE)
+        ->bindComputePipeline(expandPipeline_);
+    vkCmdDispatch(commandBuffer->vkCommandBuffer(), (batch->expandedVertexCount + 63) / 64, 1, 1);
+
+    std::vector<vk::CommandBuffer::BufferMemoryBarrier> barriers;
+    for (auto buffer : {batch->vertexBuffer, batch->positionBuffer, batch->materialBuffer}) {
+        barriers.push_back({
+            .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR |
+                            VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+            .srcQueueFamilyIndex = mainQueueIndex,
+            .dstQueueFamilyIndex = mainQueueIndex,
+            .buffer = buffer,
+        });
+    }
+    commandBuffer->barriersBufferImage(barriers, {});
 }
 
 std::shared_ptr<EntityBatch> Entities::entityBatch() {
@@ -960,3 +1041,21 @@ std::shared_ptr<EntityPostBatch> Entities::entityPostBatch() {
 std::shared_ptr<vk::BLASBatchBuilder> Entities::blasBatchBuilder() {
     return blasBatchBuilder_;
 }
+
+EntityInstancingStats Entities::instancingStats() {
+    return {
+        .unique = uniqueEntities_.load(),
+        .instanced = instancedEntities_.load(),
+        .totalUnique = totalUniqueEntities_.load(),
+        .totalInstanced = totalInstancedEntities_.load(),
+    };
+}
+
+EntityConversionStats Entities::conversionStats() {
+    EntityConversionStats stats{};
+    for (int format = 0; format < World::NUM_VERTEX_FORMATS; format++) {
+        stats.vertices[format] = convertedVertices_[format].load();
+        stats.nanoseconds[format] = conversionNanoseconds_[format].load();
+    }
+    return stats;
+}
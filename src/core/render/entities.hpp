@@ -7,6 +7,8 @@
 
 #include "core/render/world.hpp"
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <deque>
@@ -43,6 +45,15 @@ struct EntitiesBuildTask {
     void **vertices;
 };
 
+// game vertex bytes of one geometry, uploaded as they are and expanded by a compute pass before the BLAS build
+struct EntityRawGeometry {
+    World::VertexFormats format = World::NUM_VERTEX_FORMATS;
+    uint32_t vertexCount = 0;
+    uint32_t textureID = 0;
+    bool normalOffset = false;
+    std::vector<uint8_t> bytes; // empty for geometries converted on the cpu
+};
+
 struct EntityBuildData : public SharedObject<EntityBuildData> {
     int hashCode;
     double x, y, z;
@@ -51,9 +62,11 @@ struct EntityBuildData : public SharedObject<EntityBuildData> {
     World::Coordinates coordinate;
     uint32_t geometryCount;
     std::vector<World::GeometryTypes> geometryTypes;
-    std::vector<std::string> geometryGroupNames;
+    std::vector<uint32_t> geometryGroups; // World::internGeometryGroup ids
     std::vector<std::vector<vk::VertexFormat::PBRVertex>> vertices;
     std::vector<std::vector<uint32_t>> indices;
+    // empty unless Options::gpuEntityVertexExpansion left some geometry unconverted, one per geometry otherwise
+    std::vector<EntityRawGeometry> rawGeometries;
     std::vector<VkDeviceAddress> vertexBufferAddresses;
     std::vector<VkDeviceAddress> indexBufferAddresses;
     std::vector<VkDeviceAddress> positionBufferAddresses;
@@ -69,13 +82,40 @@ struct EntityBuildData : public SharedObject<EntityBuildData> {
                     World::Coordinates coordinate,
                     uint32_t geometryCount,
                     std::vector<World::GeometryTypes> &&geometryTypes,
-                    std::vector<std::string> &&geometryGroupNames,
+                    std::vector<uint32_t> &&geometryGroups,
                     std::vector<std::vector<vk::VertexFormat::PBRVertex>> &&vertices,
                     std::vector<std::vector<uint32_t>> &&indices);
+
+    // vertices[geometry] stays empty for geometries expanded on the gpu
+    uint32_t vertexCount(uint32_t geometry) const;
+    bool expandsOnGpu(uint32_t geometry) const;
+};
+
+// BLAS of one entity kept between the frames that use the same frame context. It is refit while the entity keeps its
+// geometry layout and index data, and rebuilt once too many refits piled up.
+struct EntityBLAS {
+    uint64_t signature;
+    uint32_t refitsSinceRebuild;
+    std::shared_ptr<vk::BLAS> blas;
+};
+
+struct EntityInstancingStats {
+    uint32_t unique;    // last frame, entities with geometry and BLAS of their own
+    uint32_t instanced; // last frame, entities reusing those of an identical entity
+    uint64_t totalUnique;
+    uint64_t totalInstanced;
+};
+
+// cumulative per World::VertexFormats, vertices converted to PBR vertices and the time spent doing it
+struct EntityConversionStats {
+    uint64_t vertices[World::NUM_VERTEX_FORMATS];
+    uint64_t nanoseconds[World::NUM_VERTEX_FORMATS];
 };
 
 struct EntityBuildDataBatch : public SharedObject<EntityBuildDataBatch> {
     std::vector<std::shared_ptr<EntityBuildData>> datas;
+    uint32_t uniqueCount = 0;
+    uint32_t instancedCount = 0;
 
     std::shared_ptr<vk::DeviceLocalBuffer> vertexBuffer;
     std::shared_ptr<vk::DeviceLocalBuffer> indexBuffer;
@@ -83,8 +123,18 @@ struct EntityBuildDataBatch : public SharedObject<EntityBuildDataBatch> {
     std::shared_ptr<vk::DeviceLocalBuffer> materialBuffer;
     std::shared_ptr<vk::BLASBatchBuilder> blasBatchBuilder;
 
+    // geometries converted on the cpu take the first cpuVertexCount vertices of the streams, the expansion pass
+    // writes the rest
+    bool packedMaterial = false;
+    uint32_t cpuVertexCount = 0;
+    uint32_t expandedVertexCount = 0;
+    std::vector<vk::Data::EntityExpandJob> expandJobs;
+    std::shared_ptr<vk::DeviceLocalBuffer> rawVertexBuffer;
+    std::shared_ptr<vk::DeviceLocalBuffer> expandJobBuffer;
+
     void addData(std::shared_ptr<EntityBuildData> data);
-    void build();
+    // blasCache holds the BLASes of the last frame on this frame context, it is replaced by the ones of this frame
+    void build(std::unordered_map<int, EntityBLAS> &blasCache);
 };
 
 struct EntityPostBuildDataBatch : public SharedObject<EntityPostBuildDataBatch> {
@@ -117,9 +167,10 @@ struct Entity : public SharedObject<Entity> {
 
     uint32_t geometryCount;
     std::shared_ptr<std::vector<World::GeometryTypes>> geometryTypes;
-    std::shared_ptr<std::vector<std::string>> geometryGroupNames;
+    std::shared_ptr<std::vector<uint32_t>> geometryGroups;
     std::shared_ptr<std::vector<std::vector<vk::VertexFormat::PBRVertex>>> vertices;
     std::shared_ptr<std::vector<std::vector<uint32_t>>> indices;
+    std::vector<uint32_t> vertexCounts;
 
     Entity(std::shared_ptr<EntityBuildData> entityBuildData);
 };
@@ -167,6 +218,10 @@ class Entities : public SharedObject<Entities> {
     std::shared_ptr<EntityBatch> entityBatch();
     std::shared_ptr<EntityPostBatch> entityPostBatch();
     std::shared_ptr<vk::BLASBatchBuilder> blasBatchBuilder();
+    EntityInstancingStats instancingStats();
+    EntityConversionStats conversionStats();
+    // uploads and expands the game vertices of this frame's entities, must be recorded before their BLAS build
+    void expandVertices(std::shared_ptr<vk::CommandBuffer> commandBuffer);
 
   private:
     std::shared_ptr<EntityBatch> entityBatch_;
@@ -175,4 +230,19 @@ class Entities : public SharedObject<Entities> {
     std::shared_ptr<EntityPostBuildDataBatch> entityPostBuildDataBatch_;
 
     std::shared_ptr<vk::BLASBatchBuilder> blasBatchBuilder_;
+    // per frame context, keyed by entity hash code
+    std::vector<std::unordered_map<int, EntityBLAS>> blasCaches_;
+
+    std::shared_ptr<vk::Shader> expandShader_;
+    std::shared_ptr<vk::ComputePipeline> expandPipeline_;
+    // per frame context
+    std::vector<std::shared_ptr<vk::DescriptorTable>> expandDescriptorTables_;
+
+    std::atomic<uint32_t> uniqueEntities_ = 0;
+    std::atomic<uint32_t> instancedEntities_ = 0;
+    std::atomic<uint64_t> totalUniqueEntities_ = 0;
+    std::atomic<uint64_t> totalInstancedEntities_ = 0;
+
+    std::array<std::atomic<uint64_t>, World::NUM_VERTEX_FORMATS> convertedVertices_{};
+    std::array<std::atomic<uint64_t>, World::NUM_VERTEX_FORMATS> conversionNanoseconds_{};
 };
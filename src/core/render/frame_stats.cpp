@@ -0,0 +1,308 @@
+#include "core/render/frame_stats.hpp"
+
+#include "core/render/chunks.hpp"
+#include "core/render/entities.hpp"
+#include "core/render/render_framework.hpp"
+#include "core/render/renderer.hpp"
+#include "core/render/world.hpp"
+
+#include <algorithm>
+#include <nlohmann/json.hpp>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#    include <psapi.h>
+#elif defined(__linux__)
+#    include <fstream>
+#    include <unistd.h>
+#endif
+
+namespace {
+// 0 where the platform has no cheap way to ask
+size_t residentBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.WorkingSetSize;
+    return 0;
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    size_t totalPages = 0, residentPages = 0;
+    if (!(statm >> totalPages >> residentPages)) return 0;
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+size_t chunkCpuGeometryBytes() {
+    auto world = Renderer::instance().world();
+    if (world == nullptr || world->chunks() == nullptr) return 0;
+    return world->chunks()->cpuGeometryBytes();
+}
+
+EntityInstancingStats entityInstancingStats() {
+    auto world = Renderer::instance().world();
+    if (world == nullptr || world->entities() == nullptr) return {};
+    return world->entities()->instancingStats();
+}
+
+EntityConversionStats entityConversionStats() {
+    auto world = Renderer::instance().world();
+    if (world == nullptr || world->entities() == nullptr) return {};
+    return world->entities()->conversionStats();
+}
+
+// indexed by World::VertexFormats
+constexpr const char *vertexFormatNames[World::NUM_VERTEX_FORMATS] = {
+    "positionColorTextureLightNormal",
+    "positionColorTextureOverlayLightNormal",
+    "positionTextureColorLight",
+    "position",
+    "positionColor",
+    "lines",
+    "positionColorLight",
+    "positionTexture",
+    "positionTextureColor",
+    "positionColorTextureLight",
+    "positionTextureLightColor",
+    "positionTextureColorNormal",
+    "pbrTriangle",
+};
+
+ChunkCullingStats chunkCullingStats() {
+    auto world = Renderer::instance().world();
+    if (world == nullptr || world->chunks() == nullptr) return {};
+    return world->chunks()->cullingStats();
+}
+
+ChunkBuildStats *chunkBuildStats() {
+    auto world = Renderer::instance().world();
+    if (world == nullptr || world->chunks() == nullptr) return nullptr;
+    return &world->chunks()->buildStats();
+}
+
+ChunkCompactionStats *chunkCompactionStats() {
+    auto world = Renderer::instance().world();
+    if (world == nullptr || world->chunks() == nullptr) return nullptr;
+    return &world->chunks()->compactionStats();
+}
+} // namespace
+
+FrameStats::FrameStats(std::shared_ptr<vk::VMA> vma) : vma_(vma), start_(std::chrono::steady_clock::now()) {
+    frameMilliseconds_.reserve(4096);
+    residentBytesAtStart_ = residentBytes();
+}
+
+void FrameStats::frameBegin() {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    auto now = std::chrono::steady_clock::now();
+    if (hasLastFrame_ && frameMilliseconds_.size() < maxSamples) {
+        frameMilliseconds_.push_back(std::chrono::duration<float, std::milli>(now - lastFrame_).count());
+    }
+    lastFrame_ = now;
+    hasLastFrame_ = true;
+
+    memoryHighWater_ = std::max(memoryHighWater_, memoryUsage());
+}
+
+void FrameStats::reset() {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    frameMilliseconds_.clear();
+    start_ = std::chrono::steady_clock::now();
+    hasLastFrame_ = false;
+    memoryHighWater_ = memoryUsage();
+    residentBytesAtStart_ = residentBytes();
+
+    auto buildStats = chunkBuildStats();
+    preparedBuildsAtStart_ = buildStats != nullptr ? buildStats->index.count.load() : 0;
+    uploadedBuildsAtStart_ = buildStats != nullptr ? buildStats->gpu.count.load() : 0;
+
+    auto stagingRing = Renderer::instance().framework()->stagingRing();
+    auto staging = stagingRing->stats();
+    stagingBytesAtStart_ = staging.uploadedBytes;
+    stagingStallsAtStart_ = staging.stalls;
+    stagingDedicatedAtStart_ = staging.dedicatedUploads;
+    stagingRing->resetPeak();
+
+    auto instancing = entityInstancingStats();
+    uniqueEntitiesAtStart_ = instancing.totalUnique;
+    instancedEntitiesAtStart_ = instancing.totalInstanced;
+    auto culling = chunkCullingStats();
+    instancedChunksAtStart_ = culling.totalInstanced;
+    lodChunksAtStart_ = culling.totalLod;
+    culledDistanceChunksAtStart_ = culling.totalCulledDistance;
+    culledEmptyChunksAtStart_ = culling.totalCulledEmpty;
+    auto compaction = chunkCompactionStats();
+    compactedChunksAtStart_ = compaction != nullptr ? compaction->compacted.load() : 0;
+    compactionOriginalBytesAtStart_ = compaction != nullptr ? compaction->originalBytes.load() : 0;
+    compactionCompactedBytesAtStart_ = compaction != nullptr ? compaction->compactedBytes.load() : 0;
+    compactionHistogramAtStart_.assign(ChunkCompactionStats::histogramBuckets, 0);
+    for (int bucket = 0; compaction != nullptr && bucket < ChunkCompactionStats::histogramBuckets; bucket++) {
+        compactionHistogramAtStart_[bucket] = compaction->savedHistogram[bucket];
+    }
+    auto conversion = entityConversionStats();
+    convertedVerticesAtStart_.assign(std::begin(conversion.vertices), std::end(conversion.vertices));
+    conversionNanosecondsAtStart_.assign(std::begin(conversion.nanoseconds), std::end(conversion.nanoseconds));
+}
+
+std::string FrameStats::report() {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+
+    std::vector<float> sorted = frameMilliseconds_;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](double p) -> double {
+        if (sorted.empty()) return 0.0;
+        size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[index];
+    };
+    double total = 0.0;
+    for (float milliseconds : sorted) { total += milliseconds; }
+
+    auto buildStats = chunkBuildStats();
+    uint64_t prepared = buildStats != nullptr ? buildStats->index.count.load() - preparedBuildsAtStart_ : 0;
+    uint64_t uploaded = buildStats != nullptr ? buildStats->gpu.count.load() - uploadedBuildsAtStart_ : 0;
+
+    nlohmann::json report;
+    report["seconds"] = seconds;
+    report["frames"] = sorted.size();
+    report["fps"] = total > 0.0 ? sorted.size() * 1000.0 / total : 0.0;
+    report["frameTimeMs"] = {
+        {"avg", sorted.empty() ? 0.0 : total / sorted.size()},
+        {"p50", percentile(0.50)},
+        {"p90", percentile(0.90)},
+        {"p99", percentile(0.99)},
+        {"p999", percentile(0.999)},
+        {"max", sorted.empty() ? 0.0 : sorted.back()},
+    };
+    report["chunkBuilds"] = {
+        {"prepared", prepared},
+        {"uploaded", uploaded},
+        {"uploadedPerSecond", seconds > 0.0 ? uploaded / seconds : 0.0},
+    };
+    report["memory"] = {
+        {"currentBytes", memoryUsage()},
+        {"highWaterBytes", memoryHighWater_},
+    };
+    report["nativeMemory"] = {
+        {"residentBytesAtStart", residentBytesAtStart_},
+        {"residentBytes", residentBytes()},
+        {"chunkCpuGeometryBytes", chunkCpuGeometryBytes()},
+    };
+
+    auto staging = Renderer::instance().framework()->stagingRing()->stats();
+    uint64_t stagingBytes = staging.uploadedBytes - stagingBytesAtStart_;
+    report["stagingRing"] = {
+        {"sizeBytes", staging.size},
+        {"uploadedBytes", stagingBytes},
+        {"avgFrameBytes", sorted.empty() ? 0.0 : static_cast<double>(stagingBytes) / sorted.size()},
+        {"maxFrameBytes", staging.maxFrameBytes},
+        {"stalls", staging.stalls - stagingStallsAtStart_},
+        {"dedicatedUploads", staging.dedicatedUploads - stagingDedicatedAtStart_},
+    };
+
+    auto instancing = entityInstancingStats();
+    uint64_t uniqueEntities = instancing.totalUnique - uniqueEntitiesAtStart_;
+    uint64_t instancedEntities = instancing.totalInstanced - instancedEntitiesAtStart_;
+    report["entities"] = {
+        {"unique", instancing.unique},
+        {"instanced", instancing.instanced},
+        {"avgUnique", sorted.empty() ? 0.0 : static_cast<double>(uniqueEntities) / sorted.size()},
+        {"avgInstanced", sorted.empty() ? 0.0 : static_cast<double>(instancedEntities) / sorted.size()},
+    };
+
+    auto culling = chunkCullingStats();
+    auto perFrame = [&](uint64_t total, uint64_t atStart) {
+        return sorted.empty() ? 0.0 : static_cast<double>(total - atStart) / sorted.size();
+    };
+    report["chunkCulling"] = {
+        {"instanced", culling.instanced},
+        {"lod", culling.lod},
+        {"culledDistance", culling.culledDistance},
+        {"culledEmpty", culling.culledEmpty},
+        {"avgInstanced", perFrame(culling.totalInstanced, instancedChunksAtStart_)},
+        {"avgLod", perFrame(culling.totalLod, lodChunksAtStart_)},
+        {"avgCulledDistance", perFrame(culling.totalCulledDistance, culledDistanceChunksAtStart_)},
+        {"avgCulledEmpty", perFrame(culling.totalCulledEmpty, culledEmptyChunksAtStart_)},
+        {"lodResidentBytes", ChunkLod::residentBytes.load()},
+    };
+
+    auto compaction = chunkCompactionStats();
+    if (compaction != nullptr) {
+        uint64_t originalBytes = compaction->originalBytes - compactionOriginalBytesAtStart_;
+        uint64_t compactedBytes = compaction->compactedBytes - compactionCompactedBytesAtStart_;
+        // bucket i counts chunks whose compaction saved i to i + 1 tenths of the original size
+        nlohmann::json savedHistogram = nlohmann::json::array();
+        for (int bucket = 0; bucket < ChunkCompactionStats::histogramBuckets; bucket++) {
+            uint64_t atStart = bucket < compactionHistogramAtStart_.size() ? compactionHistogramAtStart_[bucket] : 0;
+            savedHistogram.push_back(compaction->savedHistogram[bucket] - atStart);
+        }
+        report["chunkCompaction"] = {
+            {"compacted", compaction->compacted - compactedChunksAtStart_},
+            {"originalBytes", originalBytes},
+            {"compactedBytes", compactedBytes},
+            {"savedBytes", originalBytes - compactedBytes},
+            {"savedHistogram", savedHistogram},
+        };
+    }
+
+    auto conversion = entityConversionStats();
+    nlohmann::json vertexConversion = nlohmann::json::object();
+    for (int format = 0; format < World::NUM_VERTEX_FORMATS; format++) {
+        uint64_t vertices = conversion.vertices[format];
+        uint64_t nanoseconds = conversion.nanoseconds[format];
+        if (format < convertedVerticesAtStart_.size()) {
+            vertices -= convertedVerticesAtStart_[format];
+            nanoseconds -= conversionNanosecondsAtStart_[format];
+        }
+        if (vertices == 0) continue;
+        vertexConversion[vertexFormatNames[format]] = {
+            {"vertices", vertices},
+            {"verticesPerSecond", nanoseconds == 0 ? 0.0 : vertices * 1e9 / nanoseconds},
+        };
+    }
+    report["vertexConversion"] = vertexConversion;
+
+    auto world = Renderer::instance().world();
+    if (world != nullptr && world->chunks() != nullptr) {
+        auto arena = world->chunks()->geometryArena()->stats();
+        report["geometryArena"] = {
+            {"blocks", arena.blockCount},
+            {"allocations", arena.allocationCount},
+            {"reservedBytes", arena.reservedBytes},
+            {"usedBytes", arena.usedBytes},
+            {"occupancy", arena.occupancy},
+            {"fragmentation", arena.fragmentation},
+        };
+    }
+
+    nlohmann::json gpu = nlohmann::json::array();
+    for (const auto &timing : Renderer::instance().framework()->gpuProfiler()->timings()) {
+        gpu.push_back({
+            {"name", timing.name},
+            {"avgMs", timing.averageMilliseconds},
+            {"maxMs", timing.maxMilliseconds},
+        });
+    }
+    report["gpu"] = gpu;
+
+    return report.dump();
+}
+
+VkDeviceSize FrameStats::memoryUsage() {
+    const VkPhysicalDeviceMemoryProperties *memoryProperties = nullptr;
+    vmaGetMemoryProperties(vma_->allocator(), &memoryProperties);
+
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(vma_->allocator(), budgets);
+
+    VkDeviceSize usage = 0;
+    for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++) { usage += budgets[i].statistics.blockBytes; }
+    return usage;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+#include "core/vulkan/all_core_vulkan.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Frame pacing, chunk build throughput and memory numbers since the last reset, reported as json so that scripted
+// in-game runs can be compared between builds and drivers.
+class FrameStats : public SharedObject<FrameStats> {
+  public:
+    FrameStats(std::shared_ptr<vk::VMA> vma);
+
+    // called once per acquired frame
+    void frameBegin();
+    void reset();
+    std::string report();
+
+  private:
+    // roughly four hours at 60 fps, later frames are dropped from the percentiles
+    static constexpr size_t maxSamples = 1 << 20;
+
+    VkDeviceSize memoryUsage();
+
+  private:
+    std::shared_ptr<vk::VMA> vma_;
+
+    std::vector<float> frameMilliseconds_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point lastFrame_;
+    bool hasLastFrame_ = false;
+
+    uint64_t preparedBuildsAtStart_ = 0;
+    uint64_t uploadedBuildsAtStart_ = 0;
+    VkDeviceSize memoryHighWater_ = 0;
+    size_t residentBytesAtStart_ = 0;
+    uint64_t stagingBytesAtStart_ = 0;
+    uint64_t stagingStallsAtStart_ = 0;
+    uint64_t stagingDedicatedAtStart_ = 0;
+    uint64_t uniqueEntitiesAtStart_ = 0;
+    uint64_t instancedEntitiesAtStart_ = 0;
+    uint64_t instancedChunksAtStart_ = 0;
+    uint64_t lodChunksAtStart_ = 0;
+    uint64_t culledDistanceChunksAtStart_ = 0;
+    uint64_t culledEmptyChunksAtStart_ = 0;
+    uint64_t compactedChunksAtStart_ = 0;
+    uint64_t compactionOriginalBytesAtStart_ = 0;
+    uint64_t compactionCompactedBytesAtStart_ = 0;
+    // per ChunkCompactionStats::savedHistogram bucket
+    std::vector<uint64_t> compactionHistogramAtStart_;
+    // per World::VertexFormats
+    std::vector<uint64_t> convertedVerticesAtStart_;
+    std::vector<uint64_t> conversionNanosecondsAtStart_;
+    std::mutex mutex_;
+};
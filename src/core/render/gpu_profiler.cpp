@@ -0,0 +1,115 @@
+#include "core/render/gpu_profiler.hpp"
+
+#include "core/render/renderer.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+std::ostream &gpuProfilerCout() {
+    return std::cout << "[GPU Profiler] ";
+}
+
+std::ostream &gpuProfilerCerr() {
+    return std::cerr << "[GPU Profiler] ";
+}
+
+GpuProfiler::GpuProfiler(std::shared_ptr<vk::PhysicalDevice> physicalDevice, std::shared_ptr<vk::Device> device)
+    : physicalDevice_(physicalDevice), device_(device) {
+    supported_ = supportsTimestamps(physicalDevice_->mainQueueIndex());
+
+#ifdef DEBUG
+    if (!supported_) gpuProfilerCout() << "main queue does not support timestamps, profiling disabled" << std::endl;
+#endif
+}
+
+void GpuProfiler::beginFrame(uint32_t frameIndex, std::shared_ptr<vk::CommandBuffer> commandBuffer) {
+    currentFrame_ = nullptr;
+    if (!supported_) return;
+
+    if (frames_.size() <= frameIndex) frames_.resize(frameIndex + 1);
+    auto &frame = frames_[frameIndex];
+    collect(frame);
+
+    if (!Renderer::options.gpuProfiler) return;
+
+    if (frame.queryPool == nullptr) {
+        frame.queryPool = vk::QueryPool::create(device_, VK_QUERY_TYPE_TIMESTAMP, maxScopes * 2);
+    }
+    vkCmdResetQueryPool(commandBuffer->vkCommandBuffer(), frame.queryPool->vkQueryPool(), 0, maxScopes * 2);
+    currentFrame_ = &frame;
+}
+
+uint32_t GpuProfiler::beginScope(std::shared_ptr<vk::CommandBuffer> commandBuffer, const std::string &name) {
+    if (currentFrame_ == nullptr || currentFrame_->names.size() >= maxScopes) return invalidScope;
+
+    uint32_t scope = static_cast<uint32_t>(currentFrame_->names.size());
+    currentFrame_->names.push_back(name);
+    vkCmdWriteTimestamp2(commandBuffer->vkCommandBuffer(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                         currentFrame_->queryPool->vkQueryPool(), scope * 2);
+    return scope;
+}
+
+void GpuProfiler::endScope(std::shared_ptr<vk::CommandBuffer> commandBuffer, uint32_t scope) {
+    if (currentFrame_ == nullptr || scope == invalidScope) return;
+
+    vkCmdWriteTimestamp2(commandBuffer->vkCommandBuffer(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                         currentFrame_->queryPool->vkQueryPool(), scope * 2 + 1);
+}
+
+void GpuProfiler::collect(FrameQueries &frame) {
+    if (frame.names.empty()) return;
+
+    // the frame may have been recorded but never submitted, e.g. around a swapchain recreation
+    std::vector<uint64_t> values;
+    if (frame.queryPool->results(0, static_cast<uint32_t>(frame.names.size()) * 2, values)) {
+        double period = timestampPeriod();
+        for (uint32_t i = 0; i < frame.names.size(); i++) {
+            if (values[i * 2 + 1] < values[i * 2]) continue;
+            record(frame.names[i], static_cast<double>(values[i * 2 + 1] - values[i * 2]) * period / 1e6);
+        }
+    }
+    frame.names.clear();
+}
+
+void GpuProfiler::record(const std::string &name, double milliseconds) {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    auto iter = std::find_if(series_.begin(), series_.end(), [&](const Series &s) { return s.name == name; });
+    if (iter == series_.end()) {
+        iter = series_.emplace(series_.end());
+        iter->name = name;
+    }
+
+    iter->samples[iter->next] = milliseconds;
+    iter->next = (iter->next + 1) % windowSize;
+    iter->count = std::min(iter->count + 1, windowSize);
+}
+
+double GpuProfiler::timestampPeriod() {
+    return physicalDevice_->properties().limits.timestampPeriod;
+}
+
+bool GpuProfiler::supportsTimestamps(uint32_t queueFamilyIndex) {
+    return physicalDevice_->timestampValidBits(queueFamilyIndex) > 0;
+}
+
+std::vector<GpuTiming> GpuProfiler::timings() {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    std::vector<GpuTiming> result;
+    for (const auto &series : series_) {
+        double total = 0.0, max = 0.0;
+        for (uint32_t i = 0; i < series.count; i++) {
+            total += series.samples[i];
+            max = std::max(max, series.samples[i]);
+        }
+        uint32_t last = (series.next + windowSize - 1) % windowSize;
+        result.push_back({
+            .name = series.name,
+            .lastMilliseconds = series.samples[last],
+            .averageMilliseconds = series.count > 0 ? total / series.count : 0.0,
+            .maxMilliseconds = max,
+        });
+    }
+    return result;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+#include "core/vulkan/all_core_vulkan.hpp"
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct GpuTiming {
+    std::string name;
+    double lastMilliseconds;
+    double averageMilliseconds;
+    double maxMilliseconds;
+};
+
+// Timestamp query profiler. Every frame context writes into its own query pool, which is read back the next time the
+// same context is acquired. Its fence was waited on by then, so collecting results never stalls the GPU.
+class GpuProfiler : public SharedObject<GpuProfiler> {
+  public:
+    static constexpr uint32_t invalidScope = UINT32_MAX;
+
+    GpuProfiler(std::shared_ptr<vk::PhysicalDevice> physicalDevice, std::shared_ptr<vk::Device> device);
+
+    // collects the previous results of this frame context and resets its queries, commandBuffer has to be the first
+    // command buffer submitted in the frame
+    void beginFrame(uint32_t frameIndex, std::shared_ptr<vk::CommandBuffer> commandBuffer);
+    uint32_t beginScope(std::shared_ptr<vk::CommandBuffer> commandBuffer, const std::string &name);
+    void endScope(std::shared_ptr<vk::CommandBuffer> commandBuffer, uint32_t scope);
+
+    // for work whose timestamps are read back outside of the frame contexts, e.g. on the secondary queue
+    void record(const std::string &name, double milliseconds);
+    double timestampPeriod();
+    bool supportsTimestamps(uint32_t queueFamilyIndex);
+
+    std::vector<GpuTiming> timings();
+
+  private:
+    static constexpr uint32_t maxScopes = 64;
+    static constexpr uint32_t windowSize = 120;
+
+    struct FrameQueries {
+        std::shared_ptr<vk::QueryPool> queryPool;
+        std::vector<std::string> names;
+    };
+
+    struct Series {
+        std::string name;
+        std::array<double, windowSize> samples{};
+        uint32_t count = 0;
+        uint32_t next = 0;
+    };
+
+    void collect(FrameQueries &frame);
+
+  private:
+    std::shared_ptr<vk::PhysicalDevice> physicalDevice_;
+    std::shared_ptr<vk::Device> device_;
+
+    bool supported_;
+    std::vector<FrameQueries> frames_;
+    FrameQueries *currentFrame_ = nullptr;
+
+    std::vector<Series> series_;
+    std::mutex mutex_;
+};
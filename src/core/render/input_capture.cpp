@@ -0,0 +1,543 @@
+#include "core/render/input_capture.hpp"
+
+#include "core/render/chunks.hpp"
+#include "core/render/entities.hpp"
+#include "core/render/render_framework.hpp"
+#include "core/render/renderer.hpp"
+#include "core/render/world.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+std::ostream &inputCaptureCout() {
+    return std::cout << "[InputCapture] ";
+}
+
+std::ostream &inputCaptureCerr() {
+    return std::cerr << "[InputCapture] ";
+}
+
+namespace {
+// options are captured as their raw bytes, a capture only replays on a build with the same Options layout
+static_assert(std::is_trivially_copyable_v<Options>);
+
+struct CaptureFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t optionsSize;
+    uint32_t reserved;
+};
+
+struct CaptureRecordHeader {
+    uint32_t record;
+    uint32_t reserved;
+    uint64_t payloadSize;
+};
+
+class PayloadWriter {
+  public:
+    PayloadWriter(std::vector<char> &data) : data_(data) {}
+
+    template <typename T>
+    void put(const T &value) {
+        putBytes(&value, sizeof(T));
+    }
+
+    void putBytes(const void *src, size_t size) {
+        if (size == 0) return;
+        size_t offset = data_.size();
+        data_.resize(offset + size);
+        std::memcpy(data_.data() + offset, src, size);
+    }
+
+    // keeps nullptr apart from an empty string
+    void putString(const char *string) {
+        put<uint8_t>(string != nullptr);
+        if (string == nullptr) return;
+        uint32_t length = static_cast<uint32_t>(std::strlen(string));
+        put(length);
+        putBytes(string, length);
+    }
+
+  private:
+    std::vector<char> &data_;
+};
+
+class PayloadReader {
+  public:
+    PayloadReader(const std::vector<char> &data) : data_(data) {}
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (const char *src = bytes(sizeof(T))) std::memcpy(&value, src, sizeof(T));
+        return value;
+    }
+
+    // nullptr once the payload is exhausted
+    const char *bytes(size_t size) {
+        if (failed_ || size > data_.size() - offset_) {
+            failed_ = true;
+            return nullptr;
+        }
+        const char *src = data_.data() + offset_;
+        offset_ += size;
+        return src;
+    }
+
+    // false for a captured nullptr
+    bool getString(std::string &string) {
+        if (get<uint8_t>() == 0) return false;
+        uint32_t length = get<uint32_t>();
+        const char *src = bytes(length);
+        string.assign(src != nullptr ? src : "", src != nullptr ? length : 0);
+        return true;
+    }
+
+    bool failed() {
+        return failed_;
+    }
+
+  private:
+    const std::vector<char> &data_;
+    size_t offset_ = 0;
+    bool failed_ = false;
+};
+
+// owns the arrays a replayed build task points into
+struct ReplayGeometries {
+    std::vector<int> types;
+    std::vector<int> textures;
+    std::vector<int> vertexFormats;
+    std::vector<int> indexFormats;
+    std::vector<int> vertexCounts;
+    std::vector<std::string> groupNames;
+    std::vector<const char *> groupNamePointers;
+    std::vector<std::vector<char>> vertices;
+    std::vector<void *> vertexPointers;
+
+    void read(PayloadReader &reader, uint32_t count, bool hasIndexFormats) {
+        groupNames.resize(count);
+        groupNamePointers.resize(count);
+        vertices.resize(count);
+        vertexPointers.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            types.push_back(reader.get<int32_t>());
+            textures.push_back(reader.get<int32_t>());
+            vertexFormats.push_back(reader.get<int32_t>());
+            indexFormats.push_back(hasIndexFormats ? reader.get<int32_t>() : 0);
+            vertexCounts.push_back(reader.get<int32_t>());
+            bool hasGroupName = reader.getString(groupNames[i]);
+            uint64_t byteCount = reader.get<uint64_t>();
+            const char *src = reader.bytes(byteCount);
+            if (src != nullptr) vertices[i].assign(src, src + byteCount);
+            if (reader.failed()) return;
+            groupNamePointers[i] = hasGroupName ? groupNames[i].c_str() : nullptr;
+            vertexPointers[i] = vertices[i].data();
+        }
+    }
+};
+
+// indexFormat is only captured for entities, chunks have none
+void writeGeometry(PayloadWriter &writer,
+                   int type,
+                   int texture,
+                   int vertexFormat,
+                   const int *indexFormat,
+                   int vertexCount,
+                   size_t vertexSize,
+                   const char *groupName,
+                   const void *vertices) {
+    uint64_t byteCount = static_cast<uint64_t>(std::max(vertexCount, 0)) * vertexSize;
+    writer.put<int32_t>(type);
+    writer.put<int32_t>(texture);
+    writer.put<int32_t>(vertexFormat);
+    if (indexFormat != nullptr) writer.put<int32_t>(*indexFormat);
+    writer.put<int32_t>(vertexCount);
+    writer.putString(groupName);
+    writer.put(vertices != nullptr ? byteCount : 0);
+    if (vertices != nullptr) writer.putBytes(vertices, byteCount);
+}
+} // namespace
+
+InputCapture::~InputCapture() {
+    stop();
+}
+
+bool InputCapture::start(const std::filesystem::path &path) {
+    std::unique_lock<std::mutex> lck(mutex_);
+    if (file_.is_open()) {
+        inputCaptureCerr() << "already capturing to " << path_.string() << std::endl;
+        return false;
+    }
+
+    std::error_code ec;
+    if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), ec);
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        inputCaptureCerr() << "failed to open " << path.string() << std::endl;
+        return false;
+    }
+
+    CaptureFileHeader header{
+        .magic = magic,
+        .version = version,
+        .optionsSize = sizeof(Options),
+    };
+    file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    path_ = path;
+    lastOptions_.clear();
+    recordCount_ = 0;
+    byteCount_ = sizeof(header);
+    writeOptionsIfChanged();
+    active_ = true;
+
+    inputCaptureCout() << "capturing to " << path_.string() << std::endl;
+    return true;
+}
+
+void InputCapture::stop() {
+    std::unique_lock<std::mutex> lck(mutex_);
+    if (!file_.is_open()) return;
+
+    active_ = false;
+    file_.close();
+    inputCaptureCout() << "captured " << recordCount_ << " records, " << byteCount_ / 1024 << " KiB to "
+                       << path_.string() << std::endl;
+}
+
+bool InputCapture::active() {
+    return active_;
+}
+
+void InputCapture::recordCall(Record record) {
+    if (!active_) return;
+
+    std::unique_lock<std::mutex> lck(mutex_);
+    if (record == Record::AcquireContext) writeOptionsIfChanged();
+    write(record, {});
+}
+
+void InputCapture::recordShouldRenderWorld(bool shouldRender) {
+    if (!active_) return;
+
+    std::vector<char> payload;
+    PayloadWriter(payload).put<uint8_t>(shouldRender);
+
+    std::unique_lock<std::mutex> lck(mutex_);
+    write(Record::ShouldRenderWorld, payload);
+}
+
+void InputCapture::recordCameraPos(double x, double y, double z) {
+    if (!active_) return;
+
+    std::vector<char> payload;
+    PayloadWriter writer(payload);
+    writer.put(x);
+    writer.put(y);
+    writer.put(z);
+
+    std::unique_lock<std::mutex> lck(mutex_);
+    write(Record::CameraPos, payload);
+}
+
+void InputCapture::recordChunkReset(int32_t chunkCount) {
+    if (!active_) return;
+
+    std::vector<char> payload;
+    PayloadWriter(payload).put(chunkCount);
+
+    std::unique_lock<std::mutex> lck(mutex_);
+    write(Record::ChunkReset, payload);
+}
+
+void InputCapture::recordChunkBuild(const ChunkBuildTask &task) {
+    if (!active_) return;
+
+    // serialized before taking the lock, chunk builds are queued from several threads at once
+    std::vector<char> payload;
+    PayloadWriter writer(payload);
+    writer.put<int32_t>(task.x);
+    writer.put<int32_t>(task.y);
+    writer.put<int32_t>(task.z);
+    writer.put<int64_t>(task.id);
+    writer.put<int32_t>(task.geometryCount);
+    writer.put<uint8_t>(task.isImportant);
+    for (int i = 0; i < task.geometryCount; i++) {
+        const char *groupName = task.geometryGroupNames != nullptr ? task.geometryGroupNames[i] : nullptr;
+        int texture = task.geometryTextures != nullptr ? task.geometryTextures[i] : 0;
+        int vertexFormat = task.vertexFormats != nullptr ? task.vertexFormats[i] : World::PBR_TRIANGLE;
+        // chunk vertices always arrive as PBRVertex, whatever format Java reports
+        writeGeometry(writer, task.geometryTypes[i], texture, vertexFormat, nullptr, task.vertexCounts[i],
+                      sizeof(vk::VertexFormat::PBRVertex), groupName, task.vertices[i]);
+    }
+
+    std::unique_lock<std::mutex> lck(mutex_);
+    write(Record::ChunkBuild, payload);
+}
+
+void InputCapture::recordChunkInvalidate(int64_t id) {
+    if (!active_) return;
+
+    std::vector<char> payload;
+    PayloadWriter(payload).put(id);
+
+    std::unique_lock<std::mutex> lck(mutex_);
+    write(Record::ChunkInvalidate, payload);
+}
+
+void InputCapture::recordEntityQueueBuild(const EntitiesBuildTask &task) {
+    if (!active_) return;
+
+    std::vector<char> payload;
+    PayloadWriter writer(payload);
+    writer.put<float>(task.lineWidth);
+    writer.put<int32_t>(task.coordinate);
+    writer.put<uint8_t>(task.normalOffset);
+    writer.put<int32_t>(task.entityCount);
+
+    int geometryCount = 0;
+    for (int e = 0; e < task.entityCount; e++) {
+        writer.put<int32_t>(task.entityHashCodes[e]);
+        writer.put<double>(task.entityXs[e]);
+        writer.put<double>(task.entityYs[e]);
+        writer.put<double>(task.entityZs[e]);
+        writer.put<int32_t>(task.entityRTFlags[e]);
+        writer.put<int32_t>(task.entityPrebuiltBLASs[e]);
+        writer.put<int32_t>(task.entityPosts[e]);
+        writer.put<int32_t>(task.entityGeometryCounts[e]);
+        geometryCount += task.entityGeometryCounts[e];
+    }
+    for (int i = 0; i < geometryCount; i++) {
+        const char *groupName = task.geometryGroupNames != nullptr ? task.geometryGroupNames[i] : nullptr;
+        auto vertexFormat = static_cast<World::VertexFormats>(task.vertexFormats[i]);
+        writeGeometry(writer, task.geometryTypes[i], task.geometryTextures[i], vertexFormat, &task.indexFormats[i],
+                      task.vertexCounts[i], World::vertexSize(vertexFormat), groupName, task.vertices[i]);
+    }
+
+    std::unique_lock<std::mutex> lck(mutex_);
+    write(Record::EntityQueueBuild, payload);
+}
+
+void InputCapture::write(Record record, const std::vector<char> &payload) {
+    if (!file_.is_open()) return;
+
+    CaptureRecordHeader header{
+        .record = static_cast<uint32_t>(record),
+        .payloadSize = payload.size(),
+    };
+    file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file_.write(payload.data(), payload.size());
+    recordCount_++;
+    byteCount_ += sizeof(header) + payload.size();
+
+    if (!file_) {
+        inputCaptureCerr() << "failed to write " << path_.string() << ", capture stopped" << std::endl;
+        active_ = false;
+        file_.close();
+    }
+}
+
+void InputCapture::writeOptionsIfChanged() {
+    const char *options = reinterpret_cast<const char *>(&Renderer::options);
+    if (lastOptions_.size() == sizeof(Options) && std::memcmp(lastOptions_.data(), options, sizeof(Options)) == 0) {
+        return;
+    }
+    lastOptions_.assign(options, options + sizeof(Options));
+    write(Record::Options, lastOptions_);
+}
+
+InputReplay::InputReplay(const std::filesystem::path &path) : path_(path) {}
+
+bool InputReplay::run() {
+    std::ifstream file(path_, std::ios::binary);
+    if (!file.is_open()) {
+        inputCaptureCerr() << "failed to open " << path_.string() << std::endl;
+        return false;
+    }
+
+    CaptureFileHeader header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != InputCapture::magic ||
+        header.version != InputCapture::version || header.optionsSize != sizeof(Options)) {
+        inputCaptureCerr() << path_.string() << " is no capture of this build, not replaying" << std::endl;
+        return false;
+    }
+
+    auto framework = Renderer::instance().framework();
+    if (framework->inputCapture()->active()) {
+        inputCaptureCerr() << "cannot replay while capturing" << std::endl;
+        return false;
+    }
+    framework->frameStats()->reset();
+
+    frameCount_ = 0;
+    inFrame_ = false;
+    bool complete = true;
+    std::vector<char> payload;
+    CaptureRecordHeader recordHeader{};
+    while (file.read(reinterpret_cast<char *>(&recordHeader), sizeof(recordHeader))) {
+        payload.resize(recordHeader.payloadSize);
+        if (!file.read(payload.data(), payload.size())) {
+            complete = false;
+            break;
+        }
+        play(static_cast<InputCapture::Record>(recordHeader.record), payload);
+    }
+    // a partial record header
+    if (file.gcount() != 0) complete = false;
+    // the capture was stopped in the middle of a frame
+    if (inFrame_) {
+        framework->submitCommand();
+        framework->present();
+        inFrame_ = false;
+    }
+
+    if (!complete) inputCaptureCerr() << path_.string() << " is truncated, stopped the replay early" << std::endl;
+    inputCaptureCout() << "replayed " << frameCount_ << " frames from " << path_.string() << std::endl;
+    return complete;
+}
+
+void InputReplay::play(InputCapture::Record record, const std::vector<char> &payload) {
+    auto framework = Renderer::instance().framework();
+    auto world = Renderer::instance().world();
+    PayloadReader reader(payload);
+
+    switch (record) {
+        case InputCapture::Record::Options: applyOptions(payload); break;
+        case InputCapture::Record::AcquireContext: {
+            framework->acquireContext();
+            inFrame_ = true;
+            frameCount_++;
+            break;
+        }
+        case InputCapture::Record::FuseWorld: {
+            if (!inFrame_) break;
+            auto context = framework->safeAcquireCurrentContext();
+            framework->pipeline()->acquirePipelineContext(context)->fuseWorld();
+            break;
+        }
+        case InputCapture::Record::SubmitCommand: {
+            if (inFrame_) framework->submitCommand();
+            break;
+        }
+        case InputCapture::Record::Present: {
+            if (inFrame_) framework->present();
+            inFrame_ = false;
+            break;
+        }
+        case InputCapture::Record::ShouldRenderWorld: world->shouldRender() = reader.get<uint8_t>(); break;
+        case InputCapture::Record::CameraPos: {
+            double x = reader.get<double>();
+            double y = reader.get<double>();
+            double z = reader.get<double>();
+            world->setCameraPos(glm::dvec3{x, y, z});
+            break;
+        }
+        case InputCapture::Record::ChunkReset: world->chunks()->reset(reader.get<int32_t>()); break;
+        case InputCapture::Record::ChunkBuild: {
+            int x = reader.get<int32_t>();
+            int y = reader.get<int32_t>();
+            int z = reader.get<int32_t>();
+            int64_t id = reader.get<int64_t>();
+            int geometryCount = reader.get<int32_t>();
+            bool isImportant = reader.get<uint8_t>();
+            ReplayGeometries geometries;
+            geometries.read(reader, std::max(geometryCount, 0), false);
+            if (reader.failed()) break;
+
+            world->chunks()->queueChunkBuild(ChunkBuildTask{
+                .x = x,
+                .y = y,
+                .z = z,
+                .id = id,
+                .geometryCount = geometryCount,
+                .geometryTypes = geometries.types.data(),
+                .geometryGroupNames = geometries.groupNamePointers.data(),
+                .geometryTextures = geometries.textures.data(),
+                .vertexFormats = geometries.vertexFormats.data(),
+                .vertexCounts = geometries.vertexCounts.data(),
+                .vertices = reinterpret_cast<vk::VertexFormat::PBRVertex **>(geometries.vertexPointers.data()),
+                .isImportant = isImportant,
+            });
+            break;
+        }
+        case InputCapture::Record::ChunkInvalidate: world->chunks()->invalidateChunk(reader.get<int64_t>()); break;
+        case InputCapture::Record::EntityQueueBuild: {
+            float lineWidth = reader.get<float>();
+            auto coordinate = static_cast<World::Coordinates>(reader.get<int32_t>());
+            bool normalOffset = reader.get<uint8_t>();
+            int entityCount = std::max(reader.get<int32_t>(), 0);
+
+            std::vector<int> hashCodes, rayTracingFlags, prebuiltBLASs, posts, geometryCounts;
+            std::vector<double> xs, ys, zs;
+            int geometryCount = 0;
+            for (int e = 0; e < entityCount && !reader.failed(); e++) {
+                hashCodes.push_back(reader.get<int32_t>());
+                xs.push_back(reader.get<double>());
+                ys.push_back(reader.get<double>());
+                zs.push_back(reader.get<double>());
+                rayTracingFlags.push_back(reader.get<int32_t>());
+                prebuiltBLASs.push_back(reader.get<int32_t>());
+                posts.push_back(reader.get<int32_t>());
+                geometryCounts.push_back(reader.get<int32_t>());
+                geometryCount += geometryCounts.back();
+            }
+            ReplayGeometries geometries;
+            geometries.read(reader, std::max(geometryCount, 0), true);
+            if (reader.failed()) break;
+
+            world->entities()->queueBuild(EntitiesBuildTask{
+                .lineWidth = lineWidth,
+                .coordinate = coordinate,
+                .normalOffset = normalOffset,
+                .entityCount = entityCount,
+                .entityHashCodes = hashCodes.data(),
+                .entityXs = xs.data(),
+                .entityYs = ys.data(),
+                .entityZs = zs.data(),
+                .entityRTFlags = rayTracingFlags.data(),
+                .entityPrebuiltBLASs = prebuiltBLASs.data(),
+                .entityPosts = posts.data(),
+                .entityGeometryCounts = geometryCounts.data(),
+                .geometryTypes = geometries.types.data(),
+                .geometryGroupNames = geometries.groupNamePointers.data(),
+                .geometryTextures = geometries.textures.data(),
+                .vertexFormats = geometries.vertexFormats.data(),
+                .indexFormats = geometries.indexFormats.data(),
+                .vertexCounts = geometries.vertexCounts.data(),
+                .vertices = geometries.vertexPointers.data(),
+            });
+            break;
+        }
+        case InputCapture::Record::EntityBuild: world->entities()->build(); break;
+        default: inputCaptureCerr() << "unknown record " << static_cast<uint32_t>(record) << ", skipped" << std::endl;
+    }
+
+    if (reader.failed()) {
+        inputCaptureCerr() << "record " << static_cast<uint32_t>(record) << " is malformed, skipped" << std::endl;
+    }
+}
+
+// what the JNI setters do besides storing the value, for the options that changed since the last record
+void InputReplay::applyOptions(const std::vector<char> &payload) {
+    if (payload.size() != sizeof(Options)) return;
+
+    Options previous = Renderer::options;
+    std::memcpy(&Renderer::options, payload.data(), sizeof(Options));
+    Options &options = Renderer::options;
+    options.needRecreate = previous.needRecreate || options.vsync != previous.vsync;
+
+    auto chunks = Renderer::instance().world()->chunks();
+    if (options.chunkBuildingBatchSize != previous.chunkBuildingBatchSize ||
+        options.chunkBuildingTotalBatches != previous.chunkBuildingTotalBatches) {
+        chunks->resetScheduler();
+    }
+    if (options.chunkBuildingThreads != previous.chunkBuildingThreads) chunks->resetWorkers();
+    if (options.chunkCompactionDelay != previous.chunkCompactionDelay ||
+        options.chunkCompactionBatchSize != previous.chunkCompactionBatchSize) {
+        chunks->resetCompactor();
+    }
+}
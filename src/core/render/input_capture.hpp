@@ -0,0 +1,89 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ChunkBuildTask;
+struct EntitiesBuildTask;
+
+// Records the world inputs that arrive through JNI into a file that InputReplay feeds back without the game, so a
+// benchmark run can be repeated between builds and drivers. Chunk, entity and camera calls are recorded as they
+// arrive, the frame calls of RendererProxy mark the frame boundaries and the options are written at the start of a
+// frame whenever they changed. Textures, overlays and uniform uploads are not recorded, a replay keeps the last ones.
+class InputCapture : public SharedObject<InputCapture> {
+  public:
+    enum class Record : uint32_t {
+        Options,
+        AcquireContext,
+        FuseWorld,
+        SubmitCommand,
+        Present,
+        ShouldRenderWorld,
+        CameraPos,
+        ChunkReset,
+        ChunkBuild,
+        ChunkInvalidate,
+        EntityQueueBuild,
+        EntityBuild,
+    };
+
+    static constexpr uint32_t magic = 0x4349434d; // "MCIC"
+    // bump whenever a record layout changes, old captures are rejected
+    static constexpr uint32_t version = 1;
+
+    ~InputCapture();
+
+    bool start(const std::filesystem::path &path);
+    void stop();
+    bool active();
+
+    // any thread, calls racing each other are written in the order they take the lock. recordCall takes the records
+    // without arguments, the frame calls and EntityBuild
+    void recordCall(Record record);
+    void recordShouldRenderWorld(bool shouldRender);
+    void recordCameraPos(double x, double y, double z);
+    void recordChunkReset(int32_t chunkCount);
+    void recordChunkBuild(const ChunkBuildTask &task);
+    void recordChunkInvalidate(int64_t id);
+    void recordEntityQueueBuild(const EntitiesBuildTask &task);
+
+  private:
+    void write(Record record, const std::vector<char> &payload);
+    void writeOptionsIfChanged();
+
+  private:
+    std::atomic<bool> active_ = false;
+    std::mutex mutex_;
+    std::ofstream file_;
+    std::filesystem::path path_;
+    std::vector<char> lastOptions_;
+    uint64_t recordCount_ = 0;
+    uint64_t byteCount_ = 0;
+};
+
+// Plays a file written by InputCapture on the calling thread in recorded order. That must be the render thread between
+// two frames, the replay acquires, submits and presents its frames itself. Frame calls captured before the first
+// acquireContext are skipped, and a frame cut off by the end of the capture is completed. The frame stats are reset
+// when the replay starts.
+class InputReplay : public SharedObject<InputReplay> {
+  public:
+    InputReplay(const std::filesystem::path &path);
+
+    // false if the file could not be read to its end
+    bool run();
+
+  private:
+    void play(InputCapture::Record record, const std::vector<char> &payload);
+    void applyOptions(const std::vector<char> &payload);
+
+  private:
+    std::filesystem::path path_;
+    uint64_t frameCount_ = 0;
+    bool inFrame_ = false;
+};
@@ -0,0 +1,135 @@
+#include "core/render/job_system.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+std::ostream &jobSystemCout() {
+    return std::cout << "[Job System] ";
+}
+
+std::ostream &jobSystemCerr() {
+    return std::cerr << "[Job System] ";
+}
+
+JobSystem::JobSystem(uint32_t workerCount) {
+    if (workerCount == 0) {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        // leave one core for the game thread which also helps out while waiting
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    for (uint32_t i = 0; i < workerCount; i++) { workers_.emplace_back(&JobSystem::workerLoop, this); }
+
+#ifdef DEBUG
+    jobSystemCout() << "started " << workerCount << " worker threads" << std::endl;
+#endif
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::unique_lock<std::mutex> lck(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto &worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+uint32_t JobSystem::workerCount() {
+    return static_cast<uint32_t>(workers_.size());
+}
+
+void JobSystem::enqueue(std::function<void()> job) {
+    {
+        std::unique_lock<std::mutex> lck(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+bool JobSystem::tryRunOne() {
+    std::function<void()> job;
+    {
+        std::unique_lock<std::mutex> lck(mutex_);
+        if (jobs_.empty()) return false;
+        job = std::move(jobs_.front());
+        jobs_.pop_front();
+    }
+    job();
+    return true;
+}
+
+void JobSystem::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lck(mutex_);
+            cv_.wait(lck, [this]() { return stopping_ || !jobs_.empty(); });
+            if (stopping_ && jobs_.empty()) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+JobBatch::JobBatch(std::shared_ptr<JobSystem> jobSystem, std::string label)
+    : jobSystem_(jobSystem), label_(std::move(label)), start_(std::chrono::steady_clock::now()), end_(start_) {}
+
+JobBatch::~JobBatch() {
+    // jobs reference this batch for their timings, never let them outlive it
+    for (std::size_t i = 0;; i++) {
+        std::function<bool()> ready;
+        {
+            std::unique_lock<std::mutex> lck(mutex_);
+            if (i >= pending_.size()) break;
+            ready = pending_[i].ready;
+        }
+        while (!ready()) {
+            if (!jobSystem_->tryRunOne()) std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+void JobBatch::wait() {
+    for (std::size_t i = 0;; i++) {
+        PendingJob pending;
+        {
+            std::unique_lock<std::mutex> lck(mutex_);
+            if (i >= pending_.size()) break;
+            pending = pending_[i];
+        }
+        while (!pending.ready()) {
+            if (!jobSystem_->tryRunOne()) std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        pending.rethrow();
+    }
+    end_ = std::chrono::steady_clock::now();
+}
+
+void JobBatch::report(std::ostream &os) {
+    std::vector<Timing> sorted = timings();
+    std::sort(sorted.begin(), sorted.end(), [](const Timing &a, const Timing &b) {
+        return a.milliseconds > b.milliseconds;
+    });
+
+    double total = 0.0;
+    for (const auto &timing : sorted) { total += timing.milliseconds; }
+
+    os << std::fixed << std::setprecision(1);
+    os << label_ << ": " << sorted.size() << " jobs on " << jobSystem_->workerCount() << " workers, wall "
+       << wallMilliseconds() << " ms, cpu " << total << " ms" << std::endl;
+    for (const auto &timing : sorted) { os << "    " << timing.name << ": " << timing.milliseconds << " ms" << std::endl; }
+    os << std::defaultfloat;
+}
+
+double JobBatch::wallMilliseconds() {
+    return std::chrono::duration<double, std::milli>(end_ - start_).count();
+}
+
+std::vector<JobBatch::Timing> JobBatch::timings() {
+    std::unique_lock<std::mutex> lck(mutex_);
+    return timings_;
+}
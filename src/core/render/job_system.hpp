@@ -0,0 +1,121 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JobBatch;
+
+// Fixed size worker pool shared by everything that wants to run CPU heavy work off the JNI thread.
+class JobSystem : public SharedObject<JobSystem> {
+    friend JobBatch;
+
+  public:
+    JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    template <typename F>
+    auto submit(F &&fn) -> std::future<std::invoke_result_t<F>>;
+
+    uint32_t workerCount();
+
+  private:
+    void enqueue(std::function<void()> job);
+    bool tryRunOne();
+    void workerLoop();
+
+  private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> jobs_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+// A group of named jobs whose completion and timings are tracked together.
+class JobBatch {
+  public:
+    struct Timing {
+        std::string name;
+        double milliseconds;
+    };
+
+    JobBatch(std::shared_ptr<JobSystem> jobSystem, std::string label);
+    ~JobBatch();
+
+    template <typename F>
+    auto submit(std::string name, F &&fn) -> std::shared_future<std::invoke_result_t<F>>;
+
+    // blocks until every submitted job finished, the calling thread helps draining the queue meanwhile
+    void wait();
+    void report(std::ostream &os);
+
+    double wallMilliseconds();
+    std::vector<Timing> timings();
+
+  private:
+    std::shared_ptr<JobSystem> jobSystem_;
+    std::string label_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point end_;
+
+    std::mutex mutex_;
+    std::vector<Timing> timings_;
+    struct PendingJob {
+        std::function<bool()> ready;
+        std::function<void()> rethrow;
+    };
+    std::vector<PendingJob> pending_;
+};
+
+template <typename F>
+auto JobSystem::submit(F &&fn) -> std::future<std::invoke_result_t<F>> {
+    using R = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+    std::future<R> future = task->get_future();
+    if (workers_.empty()) {
+        (*task)();
+    } else {
+        enqueue([task]() { (*task)(); });
+    }
+    return future;
+}
+
+template <typename F>
+auto JobBatch::submit(std::string name, F &&fn) -> std::shared_future<std::invoke_result_t<F>> {
+    using R = std::invoke_result_t<F>;
+    auto future = jobSystem_
+                      ->submit([this, name = std::move(name), fn = std::forward<F>(fn)]() mutable -> R {
+                          auto begin = std::chrono::steady_clock::now();
+                          auto record = [&]() {
+                              auto duration = std::chrono::steady_clock::now() - begin;
+                              std::unique_lock<std::mutex> lck(mutex_);
+                              timings_.push_back(
+                                  {name, std::chrono::duration<double, std::milli>(duration).count()});
+                          };
+                          if constexpr (std::is_void_v<R>) {
+                              fn();
+                              record();
+                          } else {
+                              R result = fn();
+                              record();
+                              return result;
+                          }
+                      })
+                      .share();
+
+    std::unique_lock<std::mutex> lck(mutex_);
+    pending_.push_back({
+        .ready = [future]() { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; },
+        .rethrow = [future]() { future.get(); },
+    });
+    return future;
+}
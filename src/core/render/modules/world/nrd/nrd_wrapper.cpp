@@ -516,14 +516,17 @@ void NrdWrapper::createPipelines() {
                                                               .module = shaderModule,
                                                               .pName = "main"};
 
+        vk::PipelineCreationFeedback feedback;
         const VkComputePipelineCreateInfo pipelineCreateInfo{.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+                                                             .pNext = &feedback.createInfo,
                                                              .stage = stageCreateInfo,
                                                              .layout = nrdPipeline.pipelineLayout};
 
-        result = vkCreateComputePipelines(device->vkDevice(), VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr,
-                                          &nrdPipeline.pipeline);
+        result = vkCreateComputePipelines(device->vkDevice(), device->vkPipelineCache(), 1, &pipelineCreateInfo,
+                                          nullptr, &nrdPipeline.pipeline);
         vkDestroyShaderModule(device->vkDevice(), shaderModule, nullptr);
         if (result != VK_SUCCESS) { throw std::runtime_error("NRD: failed to create compute pipeline!"); }
+        if (device->pipelineCache() != nullptr) device->pipelineCache()->recordCreation(feedback);
     }
 }
 
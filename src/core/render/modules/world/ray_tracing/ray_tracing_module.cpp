@@ -1,23 +1,22 @@
 #include "core/render/modules/world/ray_tracing/ray_tracing_module.hpp"
 
 #include "core/render/buffers.hpp"
+#include "core/render/modules/world/ray_tracing/shader_pack.hpp"
 #include "core/render/modules/world/ray_tracing/submodules/atmosphere.hpp"
+#include "core/render/modules/world/ray_tracing/submodules/geometry_table.hpp"
 #include "core/render/modules/world/ray_tracing/submodules/world_prepare.hpp"
 #include "core/render/pipeline.hpp"
 #include "core/render/render_framework.hpp"
 #include "core/render/renderer.hpp"
-
-#include "mz.h"
-#include "mz_strm.h"
-#include "mz_zip.h"
-#include "mz_zip_rw.h"
+#include "core/render/world.hpp"
 
 #include <nlohmann/json.hpp>
 
 #include <algorithm>
 #include <array>
 #include <cctype>
-#include <fstream>
+#include <future>
+#include <map>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
@@ -299,6 +298,18 @@ uint32_t RayTracingModule::hitGroupIndexForName(const std::string &groupName) co
     return fallbackHitGroupIndex_;
 }
 
+void RayTracingModule::resolveGeometryGroups() {
+    uint32_t groupCount = World::geometryGroupCount();
+    for (uint32_t id = static_cast<uint32_t>(geometryGroupHitGroups_.size()); id < groupCount; id++) {
+        geometryGroupHitGroups_.push_back(hitGroupIndexForName(World::geometryGroupName(id)));
+    }
+}
+
+uint32_t RayTracingModule::hitGroupIndexForGroup(uint32_t groupId) const {
+    if (groupId < geometryGroupHitGroups_.size()) { return geometryGroupHitGroups_[groupId]; }
+    return fallbackHitGroupIndex_;
+}
+
 uint32_t RayTracingModule::shadowHitGroupIndex() const {
     return shadowHitGroupIndex_;
 }
@@ -742,47 +753,10 @@ void RayTracingModule::initImages() {
 void RayTracingModule::initPipeline() {
     auto framework = framework_.lock();
     auto device = framework->device();
+    // read once, the shaders of this build and the geometry written for them have to agree
+    bool packedMaterialVertex = Renderer::options.packedMaterialVertex;
 
     std::filesystem::path builtInShaderPackZipPath = Renderer::folderPath / "shaders/world/ray_tracing/internal.zip";
-    auto extractShaderPack = [](const std::filesystem::path &zipPath, const std::filesystem::path &destinationPath) {
-        std::error_code ec;
-        std::filesystem::remove_all(destinationPath, ec);
-        std::filesystem::create_directories(destinationPath, ec);
-        if (ec) {
-            std::cerr << "[Ray Tracing] Failed to prepare shader temp dir: " << destinationPath << std::endl;
-            return false;
-        }
-
-        void *reader = mz_zip_reader_create();
-        if (reader == nullptr) {
-            std::cerr << "[Ray Tracing] Failed to create zip reader for " << zipPath << std::endl;
-            return false;
-        }
-
-        int32_t openResult = mz_zip_reader_open_file(reader, zipPath.string().c_str());
-        if (openResult != MZ_OK) {
-            mz_zip_reader_delete(&reader);
-            std::cerr << "[Ray Tracing] Failed to open zip file: " << zipPath << ", error: " << openResult << std::endl;
-            return false;
-        }
-
-        int32_t extractResult = mz_zip_reader_save_all(reader, destinationPath.string().c_str());
-        int32_t closeResult = mz_zip_reader_close(reader);
-        mz_zip_reader_delete(&reader);
-
-        if (extractResult != MZ_OK) {
-            std::cerr << "[Ray Tracing] Failed to extract zip file: " << zipPath << ", error: " << extractResult
-                      << std::endl;
-            return false;
-        }
-        if (closeResult != MZ_OK) {
-            std::cerr << "[Ray Tracing] Failed to close zip file: " << zipPath << ", error: " << closeResult
-                      << std::endl;
-            return false;
-        }
-        return true;
-    };
-
     auto fileExtension = [](const std::filesystem::path &path) {
         std::string extension = path.extension().string();
         if (!extension.empty() && extension.front() == '.') { extension.erase(extension.begin()); }
@@ -795,40 +769,53 @@ void RayTracingModule::initPipeline() {
     std::string defaultHitGroupName;
     std::vector<ParsedHitGroupConfig> parsedHitGroups;
     std::vector<std::string> includeDirectories;
-    std::unordered_map<std::string, std::shared_ptr<vk::Shader>> shaderCache;
+    // every runtime shader is compiled on the job system, results are assigned once the whole batch finished
+    JobBatch shaderBatch(framework->jobSystem(), "[Ray Tracing] shader compilation");
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<vk::Shader>>> shaderCache;
+    std::vector<std::function<void()>> shaderAssignments;
     std::unordered_map<std::string, std::filesystem::path> rootShaderFileByName;
     std::unordered_map<std::string, HitShaderPaths> classifiedHitShaderGroups;
-    std::filesystem::path activeShaderPackExtractPath;
+    std::shared_ptr<ShaderPackArchive> activeShaderPack;
     std::string shaderPackLoadError;
     auto loadRuntimeShader = [&](const std::filesystem::path &path, VkShaderStageFlagBits stage,
                                  std::unordered_map<std::string, std::string> definitions =
                                      std::unordered_map<std::string, std::string>{}) {
+        // chunks and entities write their material stream in the layout chosen here
+        if (packedMaterialVertex) definitions["PACKED_MATERIAL_VERTEX"] = "1";
         std::string cacheKey = path.string() + "#" + std::to_string(static_cast<uint32_t>(stage));
-        if (definitions.empty()) {
-            auto cacheIter = shaderCache.find(cacheKey);
-            if (cacheIter != shaderCache.end()) { return cacheIter->second; }
-        }
-        auto shader = vk::Shader::create(device, path.string(), stage, definitions, includeDirectories);
-        if (definitions.empty()) { shaderCache[cacheKey] = shader; }
+        std::map<std::string, std::string> sortedDefinitions(definitions.begin(), definitions.end());
+        for (const auto &[name, value] : sortedDefinitions) { cacheKey += "#" + name + "=" + value; }
+
+        auto cacheIter = shaderCache.find(cacheKey);
+        if (cacheIter != shaderCache.end()) { return cacheIter->second; }
+
+        std::string jobName = path.filename().string();
+        for (const auto &[name, value] : sortedDefinitions) { jobName += " " + name; }
+        auto shader = shaderBatch.submit(
+            jobName, [device, path, stage, definitions, includes = includeDirectories, pack = activeShaderPack]() {
+                return vk::Shader::create(device, path.string(), stage, definitions, includes, pack);
+            });
+        shaderCache[cacheKey] = shader;
         return shader;
     };
 
     auto loadShaderPack = [&](const std::filesystem::path &shaderPackZipPath) {
         shaderPackLoadError.clear();
-        activeShaderPackExtractPath.clear();
+        activeShaderPack = nullptr;
 
-        const std::filesystem::path shaderExtractRoot = Renderer::folderPath / "temp/shaders/world/ray_tracing";
-        std::filesystem::path shaderExtractPath = shaderExtractRoot / shaderPackZipPath.stem();
-
-        if (!extractShaderPack(shaderPackZipPath, shaderExtractPath)) {
-            shaderPackLoadError = "failed to read or extract shader pack";
+        std::string archiveError;
+        std::shared_ptr<ShaderPackArchive> shaderPack = ShaderPackArchive::open(shaderPackZipPath, archiveError);
+        if (shaderPack == nullptr) {
+            shaderPackLoadError = "failed to read shader pack: " + archiveError;
             return false;
         }
 
-        includeDirectories = {shaderExtractPath.string()};
-        activeShaderPackExtractPath = shaderExtractPath;
+        const std::filesystem::path shaderPackRoot = shaderPack->root();
+        includeDirectories = {shaderPackRoot.string()};
+        activeShaderPack = shaderPack;
 
         shaderCache.clear();
+        shaderAssignments.clear();
         rootShaderFileByName.clear();
         classifiedHitShaderGroups.clear();
         parsedHitGroups.clear();
@@ -837,10 +824,7 @@ void RayTracingModule::initPipeline() {
         defaultHitGroupName.clear();
 
         try {
-            std::vector<std::filesystem::path> rootShaderFiles;
-            for (const auto &entry : std::filesystem::directory_iterator(shaderExtractPath)) {
-                if (entry.is_regular_file()) { rootShaderFiles.push_back(entry.path()); }
-            }
+            std::vector<std::filesystem::path> rootShaderFiles = shaderPack->rootFiles();
             std::sort(rootShaderFiles.begin(), rootShaderFiles.end(),
                       [](const std::filesystem::path &lhs, const std::filesystem::path &rhs) {
                           return lhs.filename().string() < rhs.filename().string();
@@ -885,17 +869,13 @@ void RayTracingModule::initPipeline() {
                 return nullptr;
             };
 
-            const std::filesystem::path shaderConfigPath = shaderExtractPath / "configs.json";
-            if (!std::filesystem::exists(shaderConfigPath)) {
+            const std::filesystem::path shaderConfigPath = shaderPackRoot / "configs.json";
+            std::string shaderConfigText;
+            if (!shaderPack->readFile(shaderConfigPath, shaderConfigText)) {
                 throw std::runtime_error("missing required shader config: " + shaderConfigPath.string());
             }
 
-            nlohmann::json shaderConfig;
-            std::ifstream shaderConfigStream(shaderConfigPath);
-            if (!shaderConfigStream.is_open()) {
-                throw std::runtime_error("failed to open shader config: " + shaderConfigPath.string());
-            }
-            shaderConfigStream >> shaderConfig;
+            nlohmann::json shaderConfig = nlohmann::json::parse(shaderConfigText);
             if (!shaderConfig.is_object()) { throw std::runtime_error("shader config root must be an object"); }
 
             auto requiredStringField = [&](const nlohmann::json &jsonValue, const std::string &key,
@@ -1053,10 +1033,11 @@ void RayTracingModule::initPipeline() {
                 missShaders_[i] = {
                     .name = requiredStringField(missJson, "name", "root.miss[" + std::to_string(i) + "]"),
                     .index = static_cast<uint32_t>(i),
-                    .shader = loadRuntimeShader(
-                        resolveRootShaderPath(missShaderRef, "root.miss[" + std::to_string(i) + "].shader"),
-                        VK_SHADER_STAGE_MISS_BIT_KHR),
                 };
+                auto missShader = loadRuntimeShader(
+                    resolveRootShaderPath(missShaderRef, "root.miss[" + std::to_string(i) + "].shader"),
+                    VK_SHADER_STAGE_MISS_BIT_KHR);
+                shaderAssignments.push_back([this, i, missShader]() { missShaders_[i].shader = missShader.get(); });
             }
         } catch (const std::exception &e) {
             shaderPackLoadError = e.what();
@@ -1090,6 +1071,7 @@ void RayTracingModule::initPipeline() {
 
     hitShaderGroups_.clear();
     hitGroupNameToIndex_.clear();
+    geometryGroupHitGroups_.clear();
     bool fallbackHitGroupFound = false;
     bool shadowHitGroupFound = false;
 
@@ -1097,18 +1079,24 @@ void RayTracingModule::initPipeline() {
         HitShaderGroupDefinition hitGroup;
         hitGroup.name = parsedGroup.name;
         hitGroup.type = parsedGroup.type;
+
+        uint32_t groupIndex = static_cast<uint32_t>(hitShaderGroups_.size());
         if (parsedGroup.closestHit.has_value()) {
-            hitGroup.closestHitShader = loadRuntimeShader(*parsedGroup.closestHit, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
+            auto shader = loadRuntimeShader(*parsedGroup.closestHit, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
+            shaderAssignments.push_back(
+                [this, groupIndex, shader]() { hitShaderGroups_[groupIndex].closestHitShader = shader.get(); });
         }
         if (parsedGroup.anyHit.has_value()) {
-            hitGroup.anyHitShader = loadRuntimeShader(*parsedGroup.anyHit, VK_SHADER_STAGE_ANY_HIT_BIT_KHR);
+            auto shader = loadRuntimeShader(*parsedGroup.anyHit, VK_SHADER_STAGE_ANY_HIT_BIT_KHR);
+            shaderAssignments.push_back(
+                [this, groupIndex, shader]() { hitShaderGroups_[groupIndex].anyHitShader = shader.get(); });
         }
         if (parsedGroup.intersection.has_value()) {
-            hitGroup.intersectionShader =
-                loadRuntimeShader(*parsedGroup.intersection, VK_SHADER_STAGE_INTERSECTION_BIT_KHR);
+            auto shader = loadRuntimeShader(*parsedGroup.intersection, VK_SHADER_STAGE_INTERSECTION_BIT_KHR);
+            shaderAssignments.push_back(
+                [this, groupIndex, shader]() { hitShaderGroups_[groupIndex].intersectionShader = shader.get(); });
         }
 
-        uint32_t groupIndex = static_cast<uint32_t>(hitShaderGroups_.size());
         hitShaderGroups_.push_back(hitGroup);
         addGroupMapping(parsedGroup.name, groupIndex);
 
@@ -1134,6 +1122,7 @@ void RayTracingModule::initPipeline() {
             addGroupMapping(groupName, fallbackHitGroupIndex_);
         }
     }
+    resolveGeometryGroups();
     hitGroupCount_ = static_cast<uint32_t>(hitShaderGroups_.size());
 
     missGroupCount_ = static_cast<uint32_t>(missShaders_.size());
@@ -1145,10 +1134,22 @@ void RayTracingModule::initPipeline() {
         updateDefinitions = {{"SHARC_UPDATE", "1"}, {"USE_SHARC", "1"}};
     }
 
-    worldRayGenQueryShader_ = loadRuntimeShader(rayGenShaderPath, VK_SHADER_STAGE_RAYGEN_BIT_KHR, queryDefinitions);
-    worldRayGenUpdateShader_ =
+    auto rayGenQueryShader = loadRuntimeShader(rayGenShaderPath, VK_SHADER_STAGE_RAYGEN_BIT_KHR, queryDefinitions);
+    auto rayGenUpdateShader =
         useSharcRuntime_ ? loadRuntimeShader(rayGenShaderPath, VK_SHADER_STAGE_RAYGEN_BIT_KHR, updateDefinitions) :
-                           worldRayGenQueryShader_;
+                           rayGenQueryShader;
+    std::shared_future<std::shared_ptr<vk::Shader>> sharcResolveShader;
+    if (useSharcRuntime_) {
+        sharcResolveShader = loadRuntimeShader(activeShaderPack->root() / "sharc_resolve.comp",
+                                               VK_SHADER_STAGE_COMPUTE_BIT, {{"USE_SHARC", "1"}});
+    }
+
+    shaderBatch.wait();
+    for (auto &assignment : shaderAssignments) { assignment(); }
+    worldRayGenQueryShader_ = rayGenQueryShader.get();
+    worldRayGenUpdateShader_ = rayGenUpdateShader.get();
+    sharcResolveCompShader_ = useSharcRuntime_ ? sharcResolveShader.get() : nullptr;
+    shaderBatch.report(std::cout);
 
     auto buildPipeline = [&](const std::shared_ptr<vk::Shader> &rayGenShader) {
         vk::RayTracingPipelineBuilder builder;
@@ -1213,20 +1214,32 @@ void RayTracingModule::initPipeline() {
         return builder.definePipelineLayout(rayTracingDescriptorTables_[0]).build(device);
     };
 
-    rayTracingUpdatePipeline_ = buildPipeline(worldRayGenUpdateShader_);
-    rayTracingQueryPipeline_ = buildPipeline(worldRayGenQueryShader_);
-
+    // the pipelines only read the shader definitions above, so they can be created concurrently
+    JobBatch pipelineBatch(framework->jobSystem(), "[Ray Tracing] pipeline creation");
+    auto queryPipeline =
+        pipelineBatch.submit("ray tracing query", [&]() { return buildPipeline(worldRayGenQueryShader_); });
+    std::shared_future<std::shared_ptr<vk::RayTracingPipeline>> updatePipeline = queryPipeline;
+    if (worldRayGenUpdateShader_ != worldRayGenQueryShader_) {
+        updatePipeline =
+            pipelineBatch.submit("ray tracing update", [&]() { return buildPipeline(worldRayGenUpdateShader_); });
+    }
+    std::shared_future<std::shared_ptr<vk::ComputePipeline>> resolvePipeline;
     if (useSharcRuntime_) {
-        sharcResolveCompShader_ = loadRuntimeShader(activeShaderPackExtractPath / "sharc_resolve.comp",
-                                                    VK_SHADER_STAGE_COMPUTE_BIT, {{"USE_SHARC", "1"}});
-        sharcResolvePipeline_ = vk::ComputePipelineBuilder{}
-                                    .defineShader(sharcResolveCompShader_)
-                                    .definePipelineLayout(rayTracingDescriptorTables_[0])
-                                    .build(device);
-    } else {
-        sharcResolveCompShader_ = nullptr;
-        sharcResolvePipeline_ = nullptr;
+        resolvePipeline = pipelineBatch.submit("sharc resolve", [&]() {
+            return vk::ComputePipelineBuilder{}
+                .defineShader(sharcResolveCompShader_)
+                .definePipelineLayout(rayTracingDescriptorTables_[0])
+                .build(device);
+        });
     }
+
+    pipelineBatch.wait();
+    rayTracingQueryPipeline_ = queryPipeline.get();
+    rayTracingUpdatePipeline_ = updatePipeline.get();
+    sharcResolvePipeline_ = useSharcRuntime_ ? resolvePipeline.get() : nullptr;
+    pipelineBatch.report(std::cout);
+
+    if (auto world = Renderer::instance().world()) world->setPackedMaterialVertex(packedMaterialVertex);
 }
 
 void RayTracingModule::initSBT() {
@@ -1289,20 +1302,20 @@ void RayTracingModuleContext::render() {
     auto module = rayTracingModule.lock();
 
     rayTracingDescriptorTable->bindAS(worldPrepareContext->tlas, 1, 0);
-    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->blasOffsetsBuffer, 1, 1);
-    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->vertexBufferAddr, 1, 2);
-    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->indexBufferAddr, 1, 3);
-    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->lastVertexBufferAddr, 1, 4);
-    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->lastIndexBufferAddr, 1, 5);
-    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->positionBufferAddr, 1, 6);
-    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->materialBufferAddr, 1, 7);
-    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->lastPositionBufferAddr, 1, 8);
+    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->geometryTable->blasOffsetsBuffer(), 1, 1);
+    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->geometryTable->vertexBufferAddr(), 1, 2);
+    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->geometryTable->indexBufferAddr(), 1, 3);
+    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->geometryTable->lastVertexBufferAddr(), 1, 4);
+    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->geometryTable->lastIndexBufferAddr(), 1, 5);
+    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->geometryTable->positionBufferAddr(), 1, 6);
+    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->geometryTable->materialBufferAddr(), 1, 7);
+    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->geometryTable->lastPositionBufferAddr(), 1, 8);
 
     auto buffers = Renderer::instance().buffers();
     auto worldBuffer = buffers->worldUniformBuffer();
 
     rayTracingDescriptorTable->bindBuffer(buffers->textureMappingBuffer(), 1, 9);
-    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->lastObjToWorldMat, 1, 10);
+    rayTracingDescriptorTable->bindBuffer(worldPrepareContext->geometryTable->lastObjToWorldMat(), 1, 10);
     rayTracingDescriptorTable->bindBuffer(worldBuffer, 2, 0);
     rayTracingDescriptorTable->bindBuffer(buffers->lastWorldUniformBuffer(), 2, 1);
     rayTracingDescriptorTable->bindBuffer(buffers->skyUniformBuffer(), 2, 2);
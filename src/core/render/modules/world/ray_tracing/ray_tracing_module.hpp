@@ -70,6 +70,9 @@ class RayTracingModule : public WorldModule, public SharedObject<RayTracingModul
     void preClose() override;
 
     uint32_t hitGroupIndexForName(const std::string &groupName) const;
+    // resolves the geometry group ids interned since the last call, once per frame before hitGroupIndexForGroup
+    void resolveGeometryGroups();
+    uint32_t hitGroupIndexForGroup(uint32_t groupId) const;
     uint32_t shadowHitGroupIndex() const;
     uint32_t fallbackHitGroupIndex() const;
 
@@ -144,6 +147,8 @@ class RayTracingModule : public WorldModule, public SharedObject<RayTracingModul
     std::vector<MissShaderDefinition> missShaders_;
     std::vector<HitShaderGroupDefinition> hitShaderGroups_;
     std::unordered_map<std::string, uint32_t> hitGroupNameToIndex_;
+    // by World::internGeometryGroup id, rebuilt with the pipeline
+    std::vector<uint32_t> geometryGroupHitGroups_;
     uint32_t shadowHitGroupIndex_ = 0;
     uint32_t fallbackHitGroupIndex_ = 0;
     uint32_t missGroupCount_ = 0;
@@ -0,0 +1,195 @@
+#include "core/render/modules/world/ray_tracing/shader_pack.hpp"
+
+#include "mz.h"
+#include "mz_strm.h"
+#include "mz_zip.h"
+#include "mz_zip_rw.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+std::ostream &shaderPackCout() {
+    return std::cout << "[Shader Pack] ";
+}
+
+std::ostream &shaderPackCerr() {
+    return std::cerr << "[Shader Pack] ";
+}
+
+namespace {
+struct CachedShaderPack {
+    std::filesystem::file_time_type mtime;
+    uintmax_t size = 0;
+    std::shared_ptr<ShaderPackArchive> archive;
+};
+
+std::mutex &shaderPackCacheMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::unordered_map<std::string, CachedShaderPack> &shaderPackCache() {
+    static std::unordered_map<std::string, CachedShaderPack> cache;
+    return cache;
+}
+
+uint64_t hashBytes(const std::vector<uint8_t> &bytes) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint8_t byte : bytes) {
+        hash ^= byte;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool indexArchive(std::vector<uint8_t> &bytes,
+                  std::unordered_map<std::string, std::string> &files,
+                  std::string &error) {
+    void *reader = mz_zip_reader_create();
+    if (reader == nullptr) {
+        error = "failed to create zip reader";
+        return false;
+    }
+
+    int32_t result = mz_zip_reader_open_buffer(reader, bytes.data(), static_cast<int32_t>(bytes.size()), 0);
+    if (result != MZ_OK) {
+        mz_zip_reader_delete(&reader);
+        error = "failed to open zip archive, error: " + std::to_string(result);
+        return false;
+    }
+
+    for (result = mz_zip_reader_goto_first_entry(reader); result == MZ_OK;
+         result = mz_zip_reader_goto_next_entry(reader)) {
+        if (mz_zip_reader_entry_is_dir(reader) == MZ_OK) continue;
+
+        mz_zip_file *fileInfo = nullptr;
+        if (mz_zip_reader_entry_get_info(reader, &fileInfo) != MZ_OK || fileInfo == nullptr) continue;
+
+        // archives created with `cmake -E tar` prefix every entry with "./"
+        std::string name = std::filesystem::path(fileInfo->filename).lexically_normal().generic_string();
+        if (name.empty() || name == ".") continue;
+
+        int32_t length = mz_zip_reader_entry_save_buffer_length(reader);
+        if (length < 0) {
+            error = "failed to query size of " + name;
+            break;
+        }
+        std::string content(static_cast<size_t>(length), '\0');
+        if (length > 0 && mz_zip_reader_entry_save_buffer(reader, content.data(), length) != MZ_OK) {
+            error = "failed to decompress " + name;
+            break;
+        }
+        files[name] = std::move(content);
+    }
+
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+
+    if (!error.empty()) return false;
+    if (result != MZ_END_OF_LIST) {
+        error = "failed to iterate zip archive, error: " + std::to_string(result);
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+ShaderPackArchive::ShaderPackArchive(std::filesystem::path zipPath,
+                                     uint64_t contentHash,
+                                     std::unordered_map<std::string, std::string> &&files)
+    : root_(zipPath.lexically_normal()), contentHash_(contentHash), files_(std::move(files)) {}
+
+std::shared_ptr<ShaderPackArchive> ShaderPackArchive::open(const std::filesystem::path &zipPath, std::string &error) {
+    std::error_code ec;
+    std::filesystem::file_time_type mtime = std::filesystem::last_write_time(zipPath, ec);
+    if (ec) {
+        error = "cannot stat shader pack: " + ec.message();
+        return nullptr;
+    }
+    uintmax_t size = std::filesystem::file_size(zipPath, ec);
+    if (ec) {
+        error = "cannot stat shader pack: " + ec.message();
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lck(shaderPackCacheMutex());
+    const std::string cacheKey = zipPath.lexically_normal().string();
+    auto &cache = shaderPackCache();
+
+    auto iter = cache.find(cacheKey);
+    if (iter != cache.end() && iter->second.mtime == mtime && iter->second.size == size) {
+        return iter->second.archive;
+    }
+
+    std::vector<uint8_t> bytes(size);
+    {
+        std::ifstream file(zipPath, std::ios::binary);
+        if (!file.is_open() || !file.read(reinterpret_cast<char *>(bytes.data()), bytes.size())) {
+            error = "cannot read shader pack";
+            return nullptr;
+        }
+    }
+    uint64_t contentHash = hashBytes(bytes);
+
+    // touched but unchanged, keep the existing index
+    if (iter != cache.end() && iter->second.archive->contentHash() == contentHash) {
+        iter->second.mtime = mtime;
+        iter->second.size = size;
+        return iter->second.archive;
+    }
+
+    std::unordered_map<std::string, std::string> files;
+    if (!indexArchive(bytes, files, error)) { return nullptr; }
+
+    auto archive = ShaderPackArchive::create(zipPath, contentHash, std::move(files));
+    cache[cacheKey] = {mtime, size, archive};
+
+#ifdef DEBUG
+    shaderPackCout() << "indexed " << archive->files_.size() << " files from " << zipPath.string() << std::endl;
+#endif
+
+    return archive;
+}
+
+bool ShaderPackArchive::relativeKey(const std::filesystem::path &path, std::string &key) {
+    std::filesystem::path relative = path.lexically_normal().lexically_relative(root_);
+    if (relative.empty()) return false;
+
+    key = relative.generic_string();
+    if (key == "." || key.starts_with("..")) return false;
+    return true;
+}
+
+bool ShaderPackArchive::readFile(const std::filesystem::path &path, std::string &content) {
+    std::string key;
+    if (!relativeKey(path, key)) return false;
+
+    auto iter = files_.find(key);
+    if (iter == files_.end()) return false;
+    content = iter->second;
+    return true;
+}
+
+bool ShaderPackArchive::contains(const std::filesystem::path &path) {
+    std::string key;
+    if (!relativeKey(path, key)) return false;
+    return files_.find(key) != files_.end();
+}
+
+std::vector<std::filesystem::path> ShaderPackArchive::rootFiles() {
+    std::vector<std::filesystem::path> result;
+    for (const auto &[name, _] : files_) {
+        if (name.find('/') == std::string::npos) { result.push_back(root_ / name); }
+    }
+    return result;
+}
+
+std::filesystem::path &ShaderPackArchive::root() {
+    return root_;
+}
+
+uint64_t ShaderPackArchive::contentHash() {
+    return contentHash_;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+#include "core/vulkan/shader.hpp"
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// In-memory view of a ray tracing shader pack zip. Files are addressed as <zip path>/<entry name> so that
+// relative includes resolve the same way they did for the extracted pack.
+class ShaderPackArchive : public vk::ShaderFileSystem, public SharedObject<ShaderPackArchive> {
+  public:
+    ShaderPackArchive(std::filesystem::path zipPath,
+                      uint64_t contentHash,
+                      std::unordered_map<std::string, std::string> &&files);
+
+    // returns the cached index while the archive's mtime, size or content hash are unchanged
+    static std::shared_ptr<ShaderPackArchive> open(const std::filesystem::path &zipPath, std::string &error);
+
+    bool readFile(const std::filesystem::path &path, std::string &content) override;
+    bool contains(const std::filesystem::path &path);
+
+    std::vector<std::filesystem::path> rootFiles();
+    std::filesystem::path &root();
+    uint64_t contentHash();
+
+  private:
+    bool relativeKey(const std::filesystem::path &path, std::string &key);
+
+  private:
+    std::filesystem::path root_;
+    uint64_t contentHash_;
+    std::unordered_map<std::string, std::string> files_;
+};
@@ -0,0 +1,240 @@
+#include "core/render/modules/world/ray_tracing/submodules/geometry_table.hpp"
+
+#include "core/render/render_framework.hpp"
+#include "core/render/renderer.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+// sorted runs of consecutive indices
+std::vector<std::pair<uint32_t, uint32_t>> collectSpans(std::vector<uint32_t> &indices, std::vector<bool> &flags) {
+    std::sort(indices.begin(), indices.end());
+    std::vector<std::pair<uint32_t, uint32_t>> spans;
+    for (uint32_t index : indices) {
+        flags[index] = false;
+        if (!spans.empty() && spans.back().second == index) {
+            spans.back().second++;
+        } else {
+            spans.emplace_back(index, index + 1);
+        }
+    }
+    indices.clear();
+    return spans;
+}
+} // namespace
+
+GeometryTable::GeometryTable(std::shared_ptr<vk::VMA> vma, std::shared_ptr<vk::Device> device)
+    : vma_(vma), device_(device) {}
+
+void GeometryTable::resize(uint32_t slotCount) {
+    uint32_t oldCount = static_cast<uint32_t>(ranges_.size());
+    if (slotCount == oldCount) return;
+
+    for (uint32_t i = slotCount; i < oldCount; i++) release(ranges_[i]);
+    ranges_.resize(slotCount, Range{0, 0});
+    blasOffsets_.resize(slotCount, 0);
+    lastObjToWorldMats_.resize(slotCount, glm::mat4(1.0f));
+    dirtySlotFlags_.resize(slotCount, false);
+    std::erase_if(dirtySlots_, [slotCount](uint32_t slot) { return slot >= slotCount; });
+}
+
+void GeometryTable::setSlot(uint32_t slot,
+                            const std::vector<GeometryTableEntry> &entries,
+                            const glm::mat4 &lastObjToWorld) {
+    // the first record of a range is the shadow hit record, its entry stays unused
+    auto &range = ranges_[slot];
+    uint32_t count = static_cast<uint32_t>(entries.size()) + 1;
+    if (count > range.capacity || (range.capacity > 1 && count <= range.capacity / 4)) {
+        release(range);
+        range = acquire(count);
+    }
+
+    if (blasOffsets_[slot] != range.base + 1) {
+        blasOffsets_[slot] = range.base + 1;
+        markSlot(slot);
+    }
+    if (lastObjToWorldMats_[slot] != lastObjToWorld) {
+        lastObjToWorldMats_[slot] = lastObjToWorld;
+        markSlot(slot);
+    }
+
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        uint32_t entry = range.base + 1 + i;
+        GeometryTableEntry current = {
+            .vertex = vertexAddrs_[entry],
+            .index = indexAddrs_[entry],
+            .position = positionAddrs_[entry],
+            .material = materialAddrs_[entry],
+            .lastVertex = lastVertexAddrs_[entry],
+            .lastIndex = lastIndexAddrs_[entry],
+            .lastPosition = lastPositionAddrs_[entry],
+        };
+        if (current == entries[i]) continue;
+
+        vertexAddrs_[entry] = entries[i].vertex;
+        indexAddrs_[entry] = entries[i].index;
+        positionAddrs_[entry] = entries[i].position;
+        materialAddrs_[entry] = entries[i].material;
+        lastVertexAddrs_[entry] = entries[i].lastVertex;
+        lastIndexAddrs_[entry] = entries[i].lastIndex;
+        lastPositionAddrs_[entry] = entries[i].lastPosition;
+        markEntry(entry);
+    }
+}
+
+void GeometryTable::clearSlot(uint32_t slot) {
+    // nothing reads the entries of an inactive slot, they are only handed back
+    release(ranges_[slot]);
+}
+
+uint32_t GeometryTable::sbtOffset(uint32_t slot) {
+    return ranges_[slot].base;
+}
+
+uint32_t GeometryTable::recordCount() {
+    return entryCount_;
+}
+
+GeometryTable::Range GeometryTable::acquire(uint32_t count) {
+    uint32_t capacity = std::bit_ceil(std::max(count, 1u));
+    uint32_t sizeClass = std::countr_zero(capacity);
+    if (freeBases_.size() <= sizeClass) freeBases_.resize(sizeClass + 1);
+
+    auto &freeBases = freeBases_[sizeClass];
+    if (!freeBases.empty()) {
+        uint32_t base = freeBases.back();
+        freeBases.pop_back();
+        return {base, capacity};
+    }
+
+    uint32_t base = entryCount_;
+    entryCount_ += capacity;
+    for (auto *addrs : {&vertexAddrs_, &indexAddrs_, &positionAddrs_, &materialAddrs_, &lastVertexAddrs_,
+                        &lastIndexAddrs_, &lastPositionAddrs_}) {
+        addrs->resize(entryCount_, 0);
+    }
+    dirtyEntryFlags_.resize(entryCount_, false);
+    return {base, capacity};
+}
+
+void GeometryTable::release(Range &range) {
+    if (range.capacity == 0) return;
+    freeBases_[std::countr_zero(range.capacity)].push_back(range.base);
+    range = Range{0, 0};
+}
+
+void GeometryTable::markSlot(uint32_t slot) {
+    if (dirtySlotFlags_[slot]) return;
+    dirtySlotFlags_[slot] = true;
+    dirtySlots_.push_back(slot);
+}
+
+void GeometryTable::markEntry(uint32_t entry) {
+    if (dirtyEntryFlags_[entry]) return;
+    dirtyEntryFlags_[entry] = true;
+    dirtyEntries_.push_back(entry);
+}
+
+void GeometryTable::allocate() {
+    auto createBuffer = [&](VkDeviceSize size) {
+        return vk::DeviceLocalBuffer::create(
+            vma_, device_, false, size,
+            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    };
+
+    // grow geometrically so that slowly growing tables do not reallocate every frame
+    if (blasOffsetsBuffer_ == nullptr || slotCapacity_ < ranges_.size()) {
+        slotCapacity_ = std::max(std::bit_ceil(static_cast<uint32_t>(ranges_.size())), 64u);
+        blasOffsetsBuffer_ = createBuffer(slotCapacity_ * sizeof(uint32_t));
+        lastObjToWorldMatBuffer_ = createBuffer(slotCapacity_ * sizeof(glm::mat4));
+
+        // fresh buffers, every slot has to be written
+        for (uint32_t slot = 0; slot < ranges_.size(); slot++) markSlot(slot);
+    }
+
+    if (vertexAddrBuffer_ == nullptr || entryCapacity_ < entryCount_) {
+        entryCapacity_ = std::max(std::bit_ceil(entryCount_), 256u);
+        for (auto *buffer : {&vertexAddrBuffer_, &indexAddrBuffer_, &positionAddrBuffer_, &materialAddrBuffer_,
+                             &lastVertexAddrBuffer_, &lastIndexAddrBuffer_, &lastPositionAddrBuffer_}) {
+            *buffer = createBuffer(entryCapacity_ * sizeof(uint64_t));
+        }
+
+        for (uint32_t entry = 0; entry < entryCount_; entry++) markEntry(entry);
+    }
+}
+
+template <typename T>
+void GeometryTable::uploadSpans(std::shared_ptr<vk::CommandBuffer> cmdBuffer,
+                                const std::vector<std::pair<uint32_t, uint32_t>> &spans,
+                                const std::vector<T> &src,
+                                std::shared_ptr<vk::DeviceLocalBuffer> dst) {
+    auto stagingRing = Renderer::instance().framework()->stagingRing();
+    for (auto [begin, end] : spans) {
+        stagingRing->upload(cmdBuffer, src.data() + begin, (end - begin) * sizeof(T), dst->vkBuffer(),
+                            begin * sizeof(T));
+    }
+}
+
+void GeometryTable::upload(std::shared_ptr<vk::CommandBuffer> cmdBuffer) {
+    allocate();
+    if (dirtySlots_.empty() && dirtyEntries_.empty()) return;
+
+    auto slotSpans = collectSpans(dirtySlots_, dirtySlotFlags_);
+    uploadSpans(cmdBuffer, slotSpans, blasOffsets_, blasOffsetsBuffer_);
+    uploadSpans(cmdBuffer, slotSpans, lastObjToWorldMats_, lastObjToWorldMatBuffer_);
+
+    auto entrySpans = collectSpans(dirtyEntries_, dirtyEntryFlags_);
+    uploadSpans(cmdBuffer, entrySpans, vertexAddrs_, vertexAddrBuffer_);
+    uploadSpans(cmdBuffer, entrySpans, indexAddrs_, indexAddrBuffer_);
+    uploadSpans(cmdBuffer, entrySpans, positionAddrs_, positionAddrBuffer_);
+    uploadSpans(cmdBuffer, entrySpans, materialAddrs_, materialAddrBuffer_);
+    uploadSpans(cmdBuffer, entrySpans, lastVertexAddrs_, lastVertexAddrBuffer_);
+    uploadSpans(cmdBuffer, entrySpans, lastIndexAddrs_, lastIndexAddrBuffer_);
+    uploadSpans(cmdBuffer, entrySpans, lastPositionAddrs_, lastPositionAddrBuffer_);
+
+    cmdBuffer->barriersMemory({vk::CommandBuffer::MemoryBarrier{
+        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+        .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+    }});
+}
+
+std::shared_ptr<vk::DeviceLocalBuffer> GeometryTable::blasOffsetsBuffer() {
+    return blasOffsetsBuffer_;
+}
+
+std::shared_ptr<vk::DeviceLocalBuffer> GeometryTable::vertexBufferAddr() {
+    return vertexAddrBuffer_;
+}
+
+std::shared_ptr<vk::DeviceLocalBuffer> GeometryTable::indexBufferAddr() {
+    return indexAddrBuffer_;
+}
+
+std::shared_ptr<vk::DeviceLocalBuffer> GeometryTable::positionBufferAddr() {
+    return positionAddrBuffer_;
+}
+
+std::shared_ptr<vk::DeviceLocalBuffer> GeometryTable::materialBufferAddr() {
+    return materialAddrBuffer_;
+}
+
+std::shared_ptr<vk::DeviceLocalBuffer> GeometryTable::lastVertexBufferAddr() {
+    return lastVertexAddrBuffer_;
+}
+
+std::shared_ptr<vk::DeviceLocalBuffer> GeometryTable::lastIndexBufferAddr() {
+    return lastIndexAddrBuffer_;
+}
+
+std::shared_ptr<vk::DeviceLocalBuffer> GeometryTable::lastPositionBufferAddr() {
+    return lastPositionAddrBuffer_;
+}
+
+std::shared_ptr<vk::DeviceLocalBuffer> GeometryTable::lastObjToWorldMat() {
+    return lastObjToWorldMatBuffer_;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+#include "core/vulkan/all_core_vulkan.hpp"
+
+#include <vector>
+
+// buffer addresses of one geometry as the hit shaders look them up, last* are 0 without matching previous frame data
+struct GeometryTableEntry {
+    uint64_t vertex;
+    uint64_t index;
+    uint64_t position;
+    uint64_t material;
+    uint64_t lastVertex;
+    uint64_t lastIndex;
+    uint64_t lastPosition;
+
+    bool operator==(const GeometryTableEntry &) const = default;
+};
+
+// Geometry address tables of one frame context, indexed by TLAS slot and kept across frames. Each slot owns a range of
+// geometry entries that stays put while its geometry count fits, so only the entries and slots that changed since the
+// last frame on this context are uploaded. The instance custom index of a slot is the slot itself. The ranges double as
+// the hit record ranges of the slots in the SBT, a shadow record followed by one record per geometry, so that culling
+// or rebuilding one instance leaves the SBT offsets of all others alone.
+class GeometryTable : public SharedObject<GeometryTable> {
+  public:
+    GeometryTable(std::shared_ptr<vk::VMA> vma, std::shared_ptr<vk::Device> device);
+
+    // slots past the new count release their entries
+    void resize(uint32_t slotCount);
+    void setSlot(uint32_t slot, const std::vector<GeometryTableEntry> &entries, const glm::mat4 &lastObjToWorld);
+    void clearSlot(uint32_t slot);
+
+    // SBT record offset of an instance in a slot, valid after setSlot
+    uint32_t sbtOffset(uint32_t slot);
+    // hit records spanned by all ranges, including the unused ones
+    uint32_t recordCount();
+
+    // records the copies of everything that changed, the previous frame on this context has to have finished
+    void upload(std::shared_ptr<vk::CommandBuffer> cmdBuffer);
+
+    std::shared_ptr<vk::DeviceLocalBuffer> blasOffsetsBuffer();
+    std::shared_ptr<vk::DeviceLocalBuffer> vertexBufferAddr();
+    std::shared_ptr<vk::DeviceLocalBuffer> indexBufferAddr();
+    std::shared_ptr<vk::DeviceLocalBuffer> positionBufferAddr();
+    std::shared_ptr<vk::DeviceLocalBuffer> materialBufferAddr();
+    std::shared_ptr<vk::DeviceLocalBuffer> lastVertexBufferAddr();
+    std::shared_ptr<vk::DeviceLocalBuffer> lastIndexBufferAddr();
+    std::shared_ptr<vk::DeviceLocalBuffer> lastPositionBufferAddr();
+    std::shared_ptr<vk::DeviceLocalBuffer> lastObjToWorldMat();
+
+  private:
+    struct Range {
+        uint32_t base;
+        uint32_t capacity; // power of two, 0 for slots without entries
+    };
+
+    Range acquire(uint32_t count);
+    void release(Range &range);
+    void markSlot(uint32_t slot);
+    void markEntry(uint32_t entry);
+    void allocate();
+
+    template <typename T>
+    void uploadSpans(std::shared_ptr<vk::CommandBuffer> cmdBuffer,
+                     const std::vector<std::pair<uint32_t, uint32_t>> &spans,
+                     const std::vector<T> &src,
+                     std::shared_ptr<vk::DeviceLocalBuffer> dst);
+
+  private:
+    std::shared_ptr<vk::VMA> vma_;
+    std::shared_ptr<vk::Device> device_;
+
+    std::vector<Range> ranges_;
+    std::vector<std::vector<uint32_t>> freeBases_; // by log2 of the range capacity
+    uint32_t entryCount_ = 0;                      // high water mark of the ranges handed out
+
+    // host copies of what the device buffers hold once the pending spans are uploaded
+    std::vector<uint32_t> blasOffsets_;
+    std::vector<glm::mat4> lastObjToWorldMats_;
+    std::vector<uint64_t> vertexAddrs_, indexAddrs_, positionAddrs_, materialAddrs_;
+    std::vector<uint64_t> lastVertexAddrs_, lastIndexAddrs_, lastPositionAddrs_;
+
+    std::vector<bool> dirtySlotFlags_, dirtyEntryFlags_;
+    std::vector<uint32_t> dirtySlots_, dirtyEntries_;
+
+    uint32_t slotCapacity_ = 0;
+    uint32_t entryCapacity_ = 0;
+    std::shared_ptr<vk::DeviceLocalBuffer> blasOffsetsBuffer_;
+    std::shared_ptr<vk::DeviceLocalBuffer> lastObjToWorldMatBuffer_;
+    std::shared_ptr<vk::DeviceLocalBuffer> vertexAddrBuffer_, indexAddrBuffer_, positionAddrBuffer_,
+        materialAddrBuffer_;
+    std::shared_ptr<vk::DeviceLocalBuffer> lastVertexAddrBuffer_, lastIndexAddrBuffer_, lastPositionAddrBuffer_;
+};
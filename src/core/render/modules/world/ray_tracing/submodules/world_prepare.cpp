@@ -4,12 +4,16 @@
 #include "core/render/chunks.hpp"
 #include "core/render/entities.hpp"
 #include "core/render/modules/world/ray_tracing/ray_tracing_module.hpp"
+#include "core/render/modules/world/ray_tracing/submodules/geometry_table.hpp"
 #include "core/render/render_framework.hpp"
 #include "core/render/renderer.hpp"
 #include "core/render/world.hpp"
 
+#include <bit>
+#include <cmath>
 #include <filesystem>
 #include <glm/gtc/type_ptr.hpp>
+#include <limits>
 
 WorldPrepare::WorldPrepare() {}
 
@@ -34,123 +38,6 @@ WorldPrepareContext::WorldPrepareContext(std::shared_ptr<FrameworkContext> frame
                                          std::shared_ptr<WorldPrepare> worldPrepare)
     : frameworkContext(frameworkContext), worldPrepare(worldPrepare) {}
 
-void WorldPrepareContext::uploadBuffer(std::vector<uint32_t> &blasOffsets,
-                                       std::vector<uint64_t> &vertexBufferAddrs,
-                                       std::vector<uint64_t> &indexBufferAddrs,
-                                       std::vector<uint64_t> &positionBufferAddrs,
-                                       std::vector<uint64_t> &materialBufferAddrs,
-                                       std::vector<uint64_t> &lastVertexBufferAddrs,
-                                       std::vector<uint64_t> &lastIndexBufferAddrs,
-                                       std::vector<uint64_t> &lastPositionBufferAddrs,
-                                       std::vector<glm::mat4> &lastObjToWorldMats) {
-    auto context = frameworkContext.lock();
-    auto framework = context->framework.lock();
-    auto vma = framework->vma();
-    auto device = framework->device();
-    auto physicalDevice = framework->physicalDevice();
-    auto mainQueueIndex = physicalDevice->mainQueueIndex();
-    auto cmdBuffer = context->worldCommandBuffer;
-
-    blasOffsetsBuffer = vk::DeviceLocalBuffer::create(
-        vma, device, blasOffsets.size() * sizeof(uint32_t),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-    blasOffsetsBuffer->uploadToStagingBuffer(blasOffsets.data());
-
-    vertexBufferAddr = vk::DeviceLocalBuffer::create(
-        vma, device, vertexBufferAddrs.size() * sizeof(uint64_t),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-    vertexBufferAddr->uploadToStagingBuffer(vertexBufferAddrs.data());
-
-    indexBufferAddr = vk::DeviceLocalBuffer::create(
-        vma, device, indexBufferAddrs.size() * sizeof(uint64_t),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-    indexBufferAddr->uploadToStagingBuffer(indexBufferAddrs.data());
-
-    positionBufferAddr = vk::DeviceLocalBuffer::create(
-        vma, device, positionBufferAddrs.size() * sizeof(uint64_t),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-    positionBufferAddr->uploadToStagingBuffer(positionBufferAddrs.data());
-
-    materialBufferAddr = vk::DeviceLocalBuffer::create(
-        vma, device, materialBufferAddrs.size() * sizeof(uint64_t),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-    materialBufferAddr->uploadToStagingBuffer(materialBufferAddrs.data());
-
-    lastVertexBufferAddr = vk::DeviceLocalBuffer::create(
-        vma, device, lastVertexBufferAddrs.size() * sizeof(uint64_t),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-    lastVertexBufferAddr->uploadToStagingBuffer(lastVertexBufferAddrs.data());
-
-    lastIndexBufferAddr = vk::DeviceLocalBuffer::create(
-        vma, device, lastIndexBufferAddrs.size() * sizeof(uint64_t),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-    lastIndexBufferAddr->uploadToStagingBuffer(lastIndexBufferAddrs.data());
-
-    lastPositionBufferAddr = vk::DeviceLocalBuffer::create(
-        vma, device, lastPositionBufferAddrs.size() * sizeof(uint64_t),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-    lastPositionBufferAddr->uploadToStagingBuffer(lastPositionBufferAddrs.data());
-
-    lastObjToWorldMat = vk::DeviceLocalBuffer::create(
-        vma, device, lastObjToWorldMats.size() * sizeof(glm::mat4),
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-    lastObjToWorldMat->uploadToStagingBuffer(lastObjToWorldMats.data());
-
-    std::vector<std::shared_ptr<vk::DeviceLocalBuffer>> rayTracingMetaData{{
-        blasOffsetsBuffer,
-        vertexBufferAddr,
-        indexBufferAddr,
-        positionBufferAddr,
-        materialBufferAddr,
-        lastVertexBufferAddr,
-        lastIndexBufferAddr,
-        lastPositionBufferAddr,
-        lastObjToWorldMat,
-    }};
-
-    std::vector<vk::CommandBuffer::BufferMemoryBarrier> uploadPreBufferBarriers, uploadPostBufferBarriers;
-
-    for (auto buffer : rayTracingMetaData) {
-        if (buffer == nullptr) continue;
-        uploadPreBufferBarriers.push_back({
-            .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-            .srcAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-            .dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
-            .srcQueueFamilyIndex = mainQueueIndex,
-            .dstQueueFamilyIndex = mainQueueIndex,
-            .buffer = buffer,
-        });
-        uploadPostBufferBarriers.push_back({
-            .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-            .srcAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
-                            VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR |
-                            VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
-            .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-            .srcQueueFamilyIndex = mainQueueIndex,
-            .dstQueueFamilyIndex = mainQueueIndex,
-            .buffer = buffer,
-        });
-    }
-
-    cmdBuffer->barriersBufferImage(uploadPreBufferBarriers, {});
-    for (auto buffer : rayTracingMetaData) {
-        if (buffer == nullptr) continue;
-        buffer->uploadToBuffer(cmdBuffer);
-    }
-    cmdBuffer->barriersBufferImage(uploadPostBufferBarriers, {});
-}
-
 void WorldPrepareContext::render() {
     auto rayTracingContext = rayTracingModuleContext.lock();
     auto rayTracingModule = rayTracingContext != nullptr ? rayTracingContext->rayTracingModule.lock() : nullptr;
@@ -158,6 +45,7 @@ void WorldPrepareContext::render() {
     if (rayTracingModule == nullptr) { return; }
     if (worldPrepare1 == nullptr) { return; }
     const uint32_t shadowHitGroupIndex = rayTracingModule->shadowHitGroupIndex();
+    rayTracingModule->resolveGeometryGroups();
 
     std::shared_ptr<Framework> framework = Renderer::instance().framework();
     std::shared_ptr<FrameworkContext> context = frameworkContext.lock();
@@ -178,10 +66,15 @@ void WorldPrepareContext::render() {
             Renderer::instance().world()->chunks()->chunkBuildScheduler()->chunkBuildingBatchSize());
     }
 
+    if (chunks->chunkCompactor() != nullptr) { chunks->chunkCompactor()->tryCompact(); }
+
+    chunks->defragmentGeometry(worldCommandBuffer, Renderer::options.chunkDefragmentationBudget);
+
     if (chunks->importantBLASBuilders().size() > 0) {
         vk::BLASBuilder::batchSubmit(chunks->importantBLASBuilders(), worldCommandBuffer);
     }
 
+    entities->expandVertices(worldCommandBuffer);
     if (entities->blasBatchBuilder() != nullptr) { entities->blasBatchBuilder()->submit(worldCommandBuffer); }
 
     worldCommandBuffer->barriersMemory({vk::CommandBuffer::MemoryBarrier{
@@ -192,23 +85,118 @@ void WorldPrepareContext::render() {
         .dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR,
     }});
 
-    uint32_t blasAccu = 0, blasGroupAccu = 0;
-    std::vector<uint32_t> blasOffset;
+    // indexed by SBT record, records between the slot ranges are never hit and keep the shadow group
     std::vector<uint32_t> hitGroupIndices;
-    std::vector<uint64_t> vertexBufferAddrs, indexBufferAddrs;
-    std::vector<uint64_t> positionBufferAddrs, materialBufferAddrs;
-    std::vector<uint64_t> lastVertexBufferAddrs, lastIndexBufferAddrs;
-    std::vector<uint64_t> lastPositionBufferAddrs;
-    std::vector<glm::mat4> lastObjToWorldMats;
+    std::vector<GeometryTableEntry> geometryEntries;
+    auto hitGroupRecords = [&](uint32_t sbtOffset, uint32_t geometryCount) {
+        if (hitGroupIndices.size() < sbtOffset + geometryCount + 1) {
+            hitGroupIndices.resize(sbtOffset + geometryCount + 1, shadowHitGroupIndex);
+        }
+        return hitGroupIndices.data() + sbtOffset + 1;
+    };
+
+    if (persistentTLAS == nullptr) { persistentTLAS = vk::PersistentTLAS::create(device, vma); }
+    if (geometryTable == nullptr) { geometryTable = GeometryTable::create(vma, device); }
+
+    // chunks own the first slots, indexed by chunk id, so their instances stay put while entities come and go
+    auto &chunk1s = chunks->chunks();
+    auto entityBatch = entities->entityBatch();
+    uint32_t entityCount = entityBatch != nullptr ? static_cast<uint32_t>(entityBatch->entities.size()) : 0;
+    if (entityCount > entitySlotCapacity || entityCount * 4 < entitySlotCapacity) {
+        entitySlotCapacity = std::max(std::bit_ceil(entityCount), 64u);
+    }
+    uint32_t entitySlotBase = static_cast<uint32_t>(chunk1s.size());
+    persistentTLAS->resize(entitySlotBase + entitySlotCapacity);
+    geometryTable->resize(entitySlotBase + entitySlotCapacity);
+
+    // Chunk
+    {
+        // Rays leave the reach of the camera through bounces, chunks stay in within a margin beyond it. The view
+        // direction is no criterion, chunks behind the camera still show up in reflections and cast shadows.
+        uint32_t reach = Renderer::options.tlasCullDistance + Renderer::options.tlasCullMargin;
+        float cullDistance = Renderer::options.tlasCullDistance > 0 ? static_cast<float>(reach) :
+                                                                      std::numeric_limits<float>::infinity();
+        // chunks with merged faces are traced with them beyond the LOD distance, switched per frame
+        float lodDistance = Renderer::options.chunkLodDistance > 0 ?
+                                static_cast<float>(Renderer::options.chunkLodDistance) :
+                                std::numeric_limits<float>::infinity();
+        uint32_t instancedChunks = 0, lodChunks = 0, culledDistanceChunks = 0, culledEmptyChunks = 0;
+
+        for (int i = 0; i < chunk1s.size(); i++) {
+            auto &chunk1 = chunk1s[i];
+            bool empty = chunk1->blas != nullptr && (chunk1->geometryCount == 0 || chunk1->allVertexCount == 0);
+            bool distant = false;
+            bool useLod = false;
+            if (chunk1->blas != nullptr && !empty) {
+                glm::vec3 origin = glm::vec3(glm::dvec3(chunk1->x, chunk1->y, chunk1->z) - cameraPos);
+                glm::vec3 nearest = glm::clamp(glm::vec3(0.0f), origin + chunk1->boundsMin, origin + chunk1->boundsMax);
+                float distance2 = glm::dot(nearest, nearest);
+                distant = distance2 > cullDistance * cullDistance;
+                useLod = chunk1->lod != nullptr && distance2 > lodDistance * lodDistance;
+            }
+            culledEmptyChunks += empty;
+            culledDistanceChunks += distant;
+
+            if (chunk1->blas == nullptr || empty || distant) {
+                persistentTLAS->clearInstance(i);
+                geometryTable->clearSlot(i);
+                continue;
+            }
+            instancedChunks++;
+            lodChunks += useLod;
+
+            VkTransformMatrixKHR transform = {
+                1, 0, 0, static_cast<float>(static_cast<double>(chunk1->x) - cameraPos.x), //
+                0, 1, 0, static_cast<float>(static_cast<double>(chunk1->y) - cameraPos.y), //
+                0, 0, 1, static_cast<float>(static_cast<double>(chunk1->z) - cameraPos.z), //
+            };
+
+            // LOD geometries are a subset of the full detail ones, they share the groups and the quad indices
+            auto &blas = useLod ? chunk1->lod->blas : chunk1->blas;
+            uint32_t geometryCount = useLod ? chunk1->lod->geometries.size() : chunk1->geometryCount;
+            auto &vertexBuffers = useLod ? *chunk1->lod->vertexBuffers : *chunk1->vertexBuffers;
+            auto &positionBuffers = useLod ? *chunk1->lod->positionBuffers : *chunk1->positionBuffers;
+            auto &materialBuffers = useLod ? *chunk1->lod->materialBuffers : *chunk1->materialBuffers;
+
+            geometryEntries.clear();
+            for (int j = 0; j < geometryCount; j++) {
+                geometryEntries.push_back({
+                    .vertex = vertexBuffers[j]->bufferAddress(),
+                    .index = chunk1->quadIndices->bufferAddress(),
+                    .position = positionBuffers[j]->bufferAddress(),
+                    .material = materialBuffers[j]->bufferAddress(),
+                    .lastVertex = 0,
+                    .lastIndex = 0,
+                    .lastPosition = 0,
+                });
+            }
+
+            // read (fake, since chunk is not moving) previous render data
+            {
+                glm::mat4 lastObjToWorldMat = glm::transpose(glm::mat4(
+                    glm::vec4(1.0f, 0.0f, 0.0f, static_cast<float>(static_cast<double>(chunk1->x) - cameraPos.x)), //
+                    glm::vec4(0.0f, 1.0f, 0.0f, static_cast<float>(static_cast<double>(chunk1->y) - cameraPos.y)), //
+                    glm::vec4(0.0f, 0.0f, 1.0f, static_cast<float>(static_cast<double>(chunk1->z) - cameraPos.z)), //
+                    glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+                geometryTable->setSlot(i, geometryEntries, lastObjToWorldMat);
+            }
 
-    tlasBuilder = vk::TLASBuilder::create();
-    auto &instanceBuilder = tlasBuilder->beginInstanceBuilder();
-    int blasIndex = 0;
+            // the slot is the custom index, the geometry table is indexed by it
+            uint32_t sbtOffset = geometryTable->sbtOffset(i);
+            persistentTLAS->setInstance(i, transform, i, 0x01, sbtOffset, 0, blas);
+
+            uint32_t *hitGroups = hitGroupRecords(sbtOffset, geometryCount);
+            for (int j = 0; j < geometryCount; j++) {
+                uint32_t geometry = useLod ? chunk1->lod->geometries[j] : j;
+                hitGroups[j] = rayTracingModule->hitGroupIndexForGroup((*chunk1->geometryGroups)[geometry]);
+            }
+        }
+
+        chunks->recordCulling(instancedChunks, lodChunks, culledDistanceChunks, culledEmptyChunks);
+    }
 
     // Entity
     {
-        auto entityBatch = entities->entityBatch();
-
         if (entityBatch != nullptr) {
             std::unique_lock<std::recursive_mutex> entityHistoryLock(worldPrepare1->entityRenderDataBatchesMtx_);
             auto &previousEntityRenderDataBatches = worldPrepare1->previousEntityRenderDataBatches_;
@@ -252,35 +240,28 @@ void WorldPrepareContext::render() {
                             0, 0, 1, shift.z, //
                         };
                     }
-
-                    instanceBuilder.defineInstance(transform, blasIndex, entities1[i]->rayTracingFlag, blasGroupAccu, flags,
-                                                   entities1[i]->blas);
                 } else {
                     // auto &prebuiltBLAS =
                     //     Renderer::instance().framework()->prebuiltBLASs()[entityRenderData->prebuiltBLAS];
                     // transform = prebuiltBLAS.align(*entityRenderData->vertices, *entityRenderData->indices);
 
-                    // instanceBuilder.defineInstance(transform, blasIndex, entityRenderData->rayTracingFlag, blasGroupAccu,
+                    // instanceBuilder.defineInstance(transform, blasIndex, entityRenderData->rayTracingFlag, sbtOffset,
                     // flags,
                     //                                prebuiltBLAS.blas);
                     throw std::runtime_error("prebuilt blas not implemented yet!");
                 }
 
-                hitGroupIndices.push_back(shadowHitGroupIndex);
-                for (int j = 0; j < entities1[i]->geometryCount; j++) {
-                    const std::string &groupName =
-                        entities1[i]->geometryGroupNames != nullptr &&
-                                j < static_cast<int>(entities1[i]->geometryGroupNames->size())
-                            ? (*entities1[i]->geometryGroupNames)[j]
-                            : "default";
-                    hitGroupIndices.push_back(rayTracingModule->hitGroupIndexForName(groupName));
-                }
-
+                geometryEntries.clear();
                 for (int j = 0; j < entities1[i]->geometryCount; j++) {
-                    vertexBufferAddrs.push_back((*entities1[i]->vertexBufferAddresses)[j]);
-                    indexBufferAddrs.push_back((*entities1[i]->indexBufferAddresses)[j]);
-                    positionBufferAddrs.push_back((*entities1[i]->positionBufferAddresses)[j]);
-                    materialBufferAddrs.push_back((*entities1[i]->materialBufferAddresses)[j]);
+                    geometryEntries.push_back({
+                        .vertex = (*entities1[i]->vertexBufferAddresses)[j],
+                        .index = (*entities1[i]->indexBufferAddresses)[j],
+                        .position = (*entities1[i]->positionBufferAddresses)[j],
+                        .material = (*entities1[i]->materialBufferAddresses)[j],
+                        .lastVertex = 0,
+                        .lastIndex = 0,
+                        .lastPosition = 0,
+                    });
                 }
 
                 // store current render data
@@ -299,28 +280,15 @@ void WorldPrepareContext::render() {
                         auto &previousEntityRenderData = (*iter).second.first;
                         if (previousEntityRenderData->geometryCount == entities1[i]->geometryCount) {
                             for (int j = 0; j < entities1[i]->geometryCount; j++) {
-                                if ((*previousEntityRenderData->vertices)[j].size() ==
-                                        (*entities1[i]->vertices)[j].size() &&
+                                if (previousEntityRenderData->vertexCounts[j] == entities1[i]->vertexCounts[j] &&
                                     (*previousEntityRenderData->indices)[j].size() ==
                                         (*entities1[i]->indices)[j].size()) {
-                                    lastVertexBufferAddrs.push_back(
-                                        (*previousEntityRenderData->vertexBufferAddresses)[j]);
-                                    lastIndexBufferAddrs.push_back(
-                                        (*previousEntityRenderData->indexBufferAddresses)[j]);
-                                    lastPositionBufferAddrs.push_back(
-                                        (*previousEntityRenderData->positionBufferAddresses)[j]);
-                                } else {
-                                    lastVertexBufferAddrs.push_back(0);
-                                    lastIndexBufferAddrs.push_back(0);
-                                    lastPositionBufferAddrs.push_back(0);
+                                    auto &entry = geometryEntries[j];
+                                    entry.lastVertex = (*previousEntityRenderData->vertexBufferAddresses)[j];
+                                    entry.lastIndex = (*previousEntityRenderData->indexBufferAddresses)[j];
+                                    entry.lastPosition = (*previousEntityRenderData->positionBufferAddresses)[j];
                                 }
                             }
-                        } else {
-                            for (int j = 0; j < entities1[i]->geometryCount; j++) {
-                                lastVertexBufferAddrs.push_back(0);
-                                lastIndexBufferAddrs.push_back(0);
-                                lastPositionBufferAddrs.push_back(0);
-                            }
                         }
 
                         VkTransformMatrixKHR lastObjToWorldVkMat = iter->second.second;
@@ -328,87 +296,29 @@ void WorldPrepareContext::render() {
                                                                      glm::make_vec4(lastObjToWorldVkMat.matrix[1]), //
                                                                      glm::make_vec4(lastObjToWorldVkMat.matrix[2]), //
                                                                      glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
-                    } else {
-                        for (int j = 0; j < entities1[i]->geometryCount; j++) {
-                            lastVertexBufferAddrs.push_back(0);
-                            lastIndexBufferAddrs.push_back(0);
-                            lastPositionBufferAddrs.push_back(0);
-                        }
                     }
-                    lastObjToWorldMats.push_back(lastObjToWorldMat);
+                    geometryTable->setSlot(entitySlotBase + i, geometryEntries, lastObjToWorldMat);
                 }
 
-                blasOffset.push_back(blasAccu);
-                blasAccu += entities1[i]->geometryCount;
-                blasGroupAccu += entities1[i]->geometryCount + 1; // shadow
+                uint32_t sbtOffset = geometryTable->sbtOffset(entitySlotBase + i);
+                persistentTLAS->setInstance(entitySlotBase + i, transform, entitySlotBase + i,
+                                            entities1[i]->rayTracingFlag, sbtOffset, flags, entities1[i]->blas);
 
-                blasIndex++;
+                uint32_t *hitGroups = hitGroupRecords(sbtOffset, entities1[i]->geometryCount);
+                for (int j = 0; j < entities1[i]->geometryCount; j++) {
+                    hitGroups[j] = rayTracingModule->hitGroupIndexForGroup((*entities1[i]->geometryGroups)[j]);
+                }
             }
         }
-    }
-
-    // Chunk
-    {
-        auto &chunk1s = chunks->chunks();
-        for (int i = 0; i < chunk1s.size(); i++) {
-            auto &chunk1 = chunk1s[i];
-            if (chunk1->blas == nullptr) continue;
 
-            VkTransformMatrixKHR transform = {
-                1, 0, 0, static_cast<float>(static_cast<double>(chunk1->x) - cameraPos.x), //
-                0, 1, 0, static_cast<float>(static_cast<double>(chunk1->y) - cameraPos.y), //
-                0, 0, 1, static_cast<float>(static_cast<double>(chunk1->z) - cameraPos.z), //
-            };
-
-            instanceBuilder.defineInstance(transform, blasIndex, 0x01, blasGroupAccu, 0, chunk1->blas);
-
-            hitGroupIndices.push_back(shadowHitGroupIndex);
-            for (int j = 0; j < chunk1->geometryCount; j++) {
-                const std::string &groupName =
-                    chunk1->geometryGroupNames != nullptr && j < static_cast<int>(chunk1->geometryGroupNames->size())
-                        ? (*chunk1->geometryGroupNames)[j]
-                        : "default";
-                hitGroupIndices.push_back(rayTracingModule->hitGroupIndexForName(groupName));
-            }
-
-            for (int j = 0; j < chunk1->geometryCount; j++) {
-                vertexBufferAddrs.push_back((*chunk1->vertexBuffers)[j]->bufferAddress());
-                indexBufferAddrs.push_back((*chunk1->indexBuffers)[j]->bufferAddress());
-                positionBufferAddrs.push_back((*chunk1->positionBuffers)[j]->bufferAddress());
-                materialBufferAddrs.push_back((*chunk1->materialBuffers)[j]->bufferAddress());
-                lastVertexBufferAddrs.push_back(0);
-                lastIndexBufferAddrs.push_back(0);
-                lastPositionBufferAddrs.push_back(0);
-            }
-
-            // read (fake, since chunk is not moving) previous render data
-            {
-                glm::mat4 lastObjToWorldMat = glm::transpose(glm::mat4(
-                    glm::vec4(1.0f, 0.0f, 0.0f, static_cast<float>(static_cast<double>(chunk1->x) - cameraPos.x)), //
-                    glm::vec4(0.0f, 1.0f, 0.0f, static_cast<float>(static_cast<double>(chunk1->y) - cameraPos.y)), //
-                    glm::vec4(0.0f, 0.0f, 1.0f, static_cast<float>(static_cast<double>(chunk1->z) - cameraPos.z)), //
-                    glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
-                lastObjToWorldMats.push_back(lastObjToWorldMat);
-            }
-
-            blasOffset.push_back(blasAccu);
-            blasAccu += chunk1->geometryCount;
-            blasGroupAccu += chunk1->geometryCount + 1; // shadow
-
-            blasIndex++;
+        for (uint32_t i = entityCount; i < entitySlotCapacity; i++) {
+            persistentTLAS->clearInstance(entitySlotBase + i);
+            geometryTable->clearSlot(entitySlotBase + i);
         }
     }
 
-    if (instanceBuilder.instances.empty()) {
-        tlas = nullptr;
-        return;
-    }
-
-    tlas = instanceBuilder.endInstanceBuilder(device, vma)
-               ->defineBuildProperty(VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR)
-               ->querySizeInfo(device)
-               ->allocateBuffers(physicalDevice, device, vma)
-               ->buildAndSubmit(device, worldCommandBuffer);
+    tlas = persistentTLAS->buildAndSubmit(physicalDevice, worldCommandBuffer, Renderer::options.tlasMaxRefits);
+    if (tlas == nullptr) { return; }
 
     worldCommandBuffer->barriersMemory({vk::CommandBuffer::MemoryBarrier{
         .srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
@@ -417,9 +327,9 @@ void WorldPrepareContext::render() {
         .dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR,
     }});
 
-    rayTracingContext->sharcUpdateSbt->setupHitSBT(hitGroupIndices);
-    rayTracingContext->sharcQuerySbt->setupHitSBT(hitGroupIndices);
+    hitGroupIndices.resize(geometryTable->recordCount(), shadowHitGroupIndex);
+    rayTracingContext->sharcUpdateSbt->setupHitSBT(worldCommandBuffer, hitGroupIndices);
+    rayTracingContext->sharcQuerySbt->setupHitSBT(worldCommandBuffer, hitGroupIndices);
 
-    uploadBuffer(blasOffset, vertexBufferAddrs, indexBufferAddrs, positionBufferAddrs, materialBufferAddrs,
-                 lastVertexBufferAddrs, lastIndexBufferAddrs, lastPositionBufferAddrs, lastObjToWorldMats);
+    geometryTable->upload(worldCommandBuffer);
 }
@@ -14,6 +14,7 @@ class FrameworkContext;
 class RayTracingModule;
 struct RayTracingModuleContext;
 struct Entity;
+class GeometryTable;
 
 struct WorldPrepareContext;
 
@@ -48,28 +49,12 @@ struct WorldPrepareContext : public SharedObject<WorldPrepareContext> {
     std::weak_ptr<WorldPrepare> worldPrepare;
 
     std::shared_ptr<vk::TLAS> tlas;
-    std::shared_ptr<vk::TLASBuilder> tlasBuilder;
-
-    std::shared_ptr<vk::DeviceLocalBuffer> blasOffsetsBuffer;
-    std::shared_ptr<vk::DeviceLocalBuffer> vertexBufferAddr;
-    std::shared_ptr<vk::DeviceLocalBuffer> indexBufferAddr;
-    std::shared_ptr<vk::DeviceLocalBuffer> positionBufferAddr;
-    std::shared_ptr<vk::DeviceLocalBuffer> materialBufferAddr;
-    std::shared_ptr<vk::DeviceLocalBuffer> lastVertexBufferAddr;
-    std::shared_ptr<vk::DeviceLocalBuffer> lastIndexBufferAddr;
-    std::shared_ptr<vk::DeviceLocalBuffer> lastPositionBufferAddr;
-    std::shared_ptr<vk::DeviceLocalBuffer> lastObjToWorldMat;
+    std::shared_ptr<vk::PersistentTLAS> persistentTLAS;
+    uint32_t entitySlotCapacity = 0;
+
+    std::shared_ptr<GeometryTable> geometryTable;
 
     WorldPrepareContext(std::shared_ptr<FrameworkContext> frameworkContext, std::shared_ptr<WorldPrepare> worldprepare);
 
-    void uploadBuffer(std::vector<uint32_t> &blasOffsets,
-                      std::vector<uint64_t> &vertexBufferAddrs,
-                      std::vector<uint64_t> &indexBufferAddrs,
-                      std::vector<uint64_t> &positionBufferAddrs,
-                      std::vector<uint64_t> &materialBufferAddrs,
-                      std::vector<uint64_t> &lastVertexBufferAddrs,
-                      std::vector<uint64_t> &lastIndexBufferAddrs,
-                      std::vector<uint64_t> &lastPositionBufferAddrs,
-                      std::vector<glm::mat4> &lastObjToWorldMats);
     void render();
 };
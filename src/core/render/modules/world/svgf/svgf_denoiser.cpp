@@ -204,7 +204,10 @@ void SvgfDenoiser::createPipelines() {
         pipelineInfo.stage.module = shader->vkShaderModule();
         pipelineInfo.stage.pName = "main";
         pipelineInfo.layout = p.pipelineLayout;
-        vkCreateComputePipelines(dev, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &p.pipeline);
+        vk::PipelineCreationFeedback feedback;
+        pipelineInfo.pNext = &feedback.createInfo;
+        vkCreateComputePipelines(dev, m_device->vkPipelineCache(), 1, &pipelineInfo, nullptr, &p.pipeline);
+        if (m_device->pipelineCache() != nullptr) m_device->pipelineCache()->recordCreation(feedback);
 
         p.descriptorPool = m_descriptorPool;
         std::vector<VkDescriptorSetLayout> layouts(m_contextCount, p.descriptorSetLayout);
@@ -75,6 +75,7 @@ void WorldPipeline::init(std::shared_ptr<Framework> framework, std::shared_ptr<P
     uint32_t frameNum = framework->swapchain()->imageCount();
 
     worldModules_.resize(blueprint->moduleNames_.size());
+    worldModuleNames_ = blueprint->moduleNames_;
     sharedImages_.resize(frameNum,
                          std::vector<std::shared_ptr<vk::DeviceLocalImage>>(blueprint->imageFormats_.size(), nullptr));
     contexts_.resize(frameNum);
@@ -168,6 +169,7 @@ WorldPipelineContext::WorldPipelineContext(std::shared_ptr<FrameworkContext> fra
     for (int i = 0; i < worldModules.size(); i++) {
         worldModuleContexts.push_back(worldModules[i]->contexts()[frameworkContext->frameIndex]);
     }
+    worldModuleNames = worldPipeline->worldModuleNames_;
 }
 
 void WorldPipelineContext::render() {
@@ -211,7 +213,12 @@ void WorldPipelineContext::render() {
         outputImage->imageLayout() = targetLayout;
     }
 
-    for (int i = 0; i < worldModuleContexts.size(); i++) { worldModuleContexts[i]->render(); }
+    auto gpuProfiler = framework->gpuProfiler();
+    for (int i = 0; i < worldModuleContexts.size(); i++) {
+        uint32_t scope = gpuProfiler->beginScope(worldCommandBuffer, worldModuleNames[i]);
+        worldModuleContexts[i]->render();
+        gpuProfiler->endScope(worldCommandBuffer, scope);
+    }
 
     worldCommandBuffer->barriersBufferImage(
         {}, {{
@@ -65,6 +65,7 @@ class WorldPipeline : public SharedObject<WorldPipeline> {
     void dumpSharedImages(const char *label) const;
 
     std::vector<std::shared_ptr<WorldModule>> worldModules_;
+    std::vector<std::string> worldModuleNames_;
     std::vector<std::vector<std::shared_ptr<vk::DeviceLocalImage>>> sharedImages_;
 
     std::vector<std::shared_ptr<WorldPipelineContext>> contexts_;
@@ -76,6 +77,7 @@ struct WorldPipelineContext : public SharedObject<WorldPipelineContext> {
 
     std::shared_ptr<vk::DeviceLocalImage> outputImage;
     std::vector<std::shared_ptr<WorldModuleContext>> worldModuleContexts;
+    std::vector<std::string> worldModuleNames;
 
     WorldPipelineContext(std::shared_ptr<FrameworkContext> frameworkContext,
                          std::shared_ptr<WorldPipeline> worldPipeline);
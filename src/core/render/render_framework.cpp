@@ -151,13 +151,21 @@ void Framework::init(GLFWwindow *window) {
     window_ = vk::Window::create(instance_, window);
     physicalDevice_ = vk::PhysicalDevice::create(instance_, window_);
     device_ = vk::Device::create(instance_, window_, physicalDevice_);
+    device_->pipelineCache() =
+        vk::PipelineCache::create(device_->vkDevice(), physicalDevice_, Renderer::folderPath / "cache/pipeline_cache.bin");
+    vk::SpirvCache::configure(Renderer::folderPath / "cache/spirv", 256ull * 1024 * 1024);
     vma_ = vk::VMA::create(instance_, physicalDevice_, device_);
     swapchain_ = vk::Swapchain::create(physicalDevice_, device_, window_);
     mainCommandPool_ = vk::CommandPool::create(physicalDevice_, device_);
     asyncCommandPool_ = vk::CommandPool::create(physicalDevice_, device_, physicalDevice_->secondaryQueueIndex());
     gc_ = GarbageCollector::create(shared_from_this());
+    jobSystem_ = JobSystem::create();
+    gpuProfiler_ = GpuProfiler::create(physicalDevice_, device_);
+    frameStats_ = FrameStats::create(vma_);
+    inputCapture_ = InputCapture::create();
 
     uint32_t imageCount = swapchain_->imageCount();
+    stagingRing_ = StagingRing::create(vma_, device_, StagingRing::defaultSize, imageCount);
 
     // create command buffer for each context
     for (int i = 0; i < imageCount; i++) {
@@ -217,6 +225,7 @@ void Framework::acquireContext() {
     indexHistory_.push(imageIndex);
     if (indexHistory_.size() > swapchain_->imageCount()) indexHistory_.pop();
     gc_->clear(imageIndex);
+    stagingRing_->beginFrame(imageIndex);
 
     if (currentContext_->imageAcquiredSemaphore != VK_NULL_HANDLE) {
         recycleSemaphore(currentContext_->imageAcquiredSemaphore);
@@ -229,6 +238,12 @@ void Framework::acquireContext() {
     currentContext_->overlayCommandBuffer->begin();
     currentContext_->fuseCommandBuffer->begin();
 
+    // the upload command buffer is submitted first, so it carries the query reset
+    gpuProfiler_->beginFrame(imageIndex, currentContext_->uploadCommandBuffer);
+    currentContext_->uploadProfileScope = gpuProfiler_->beginScope(currentContext_->uploadCommandBuffer, "upload");
+    currentContext_->overlayProfileScope = gpuProfiler_->beginScope(currentContext_->overlayCommandBuffer, "overlay");
+    currentContext_->fuseProfileScope = gpuProfiler_->beginScope(currentContext_->fuseCommandBuffer, "fuse");
+
     auto pipelineContext = pipeline_->acquirePipelineContext(currentContext_);
     std::shared_ptr<UIModuleContext> lastUIContext =
         lastContext == nullptr ? nullptr : pipeline_->acquirePipelineContext(lastContext)->uiModuleContext;
@@ -240,22 +255,7 @@ void Framework::acquireContext() {
     Renderer::instance().world()->chunks()->resetFrame();
     Renderer::instance().world()->entities()->resetFrame();
 
-    static int frames = 0;
-    static auto lastTime = std::chrono::high_resolution_clock::now();
-
-    frames++;
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = currentTime - lastTime;
-
-    if (elapsed.count() >= 1.0) {
-        std::stringstream ss;
-        ss << "FPS: " << frames;
-
-        // GLFW_SetWindowTitle(window_->window(), ss.str().c_str());
-
-        frames = 0;
-        lastTime = currentTime;
-    }
+    frameStats_->frameBegin();
 }
 
 void Framework::submitCommand() {
@@ -273,6 +273,12 @@ void Framework::submitCommand() {
 
     currentContext_->fuseFinal();
 
+    gpuProfiler_->endScope(currentContext_->uploadCommandBuffer, currentContext_->uploadProfileScope);
+    gpuProfiler_->endScope(currentContext_->overlayCommandBuffer, currentContext_->overlayProfileScope);
+    gpuProfiler_->endScope(currentContext_->fuseCommandBuffer, currentContext_->fuseProfileScope);
+
+    stagingRing_->endFrame(currentContextIndex_);
+
     currentContext_->uploadCommandBuffer->end();
     currentContext_->worldCommandBuffer->end();
     currentContext_->overlayCommandBuffer->end();
@@ -360,6 +366,7 @@ void Framework::recreate() {
     swapchain_->reconstruct();
 
     uint32_t size = swapchain_->imageCount();
+    stagingRing_->reset(size);
 
     // create command buffer for each context
     for (int i = 0; i < size; i++) {
@@ -395,7 +402,17 @@ void Framework::waitBackendQueueIdle() {
 }
 
 void Framework::close() {
-    if (running_) { pipeline_->close(); }
+    if (running_) {
+        inputCapture_->stop();
+        pipeline_->close();
+
+        if (device_->pipelineCache() != nullptr) {
+            device_->pipelineCache()->printStats();
+            device_->pipelineCache()->save();
+        }
+        vk::SpirvCache::printStats();
+        vk::SpirvCache::evict();
+    }
     running_ = false;
 }
 
@@ -575,6 +592,26 @@ std::shared_ptr<Pipeline> Framework::pipeline() {
     return pipeline_;
 }
 
+std::shared_ptr<JobSystem> Framework::jobSystem() {
+    return jobSystem_;
+}
+
+std::shared_ptr<GpuProfiler> Framework::gpuProfiler() {
+    return gpuProfiler_;
+}
+
+std::shared_ptr<FrameStats> Framework::frameStats() {
+    return frameStats_;
+}
+
+std::shared_ptr<InputCapture> Framework::inputCapture() {
+    return inputCapture_;
+}
+
+std::shared_ptr<StagingRing> Framework::stagingRing() {
+    return stagingRing_;
+}
+
 GarbageCollector &Framework::gc() {
     return *gc_;
 }
@@ -3,8 +3,13 @@
 #include "common/shared.hpp"
 #include "common/singleton.hpp"
 #include "core/all_extern.hpp"
+#include "core/render/frame_stats.hpp"
+#include "core/render/gpu_profiler.hpp"
+#include "core/render/input_capture.hpp"
+#include "core/render/job_system.hpp"
 #include "core/render/modules/world/dlss/dlss_wrapper.hpp"
 #include "core/render/pipeline.hpp"
+#include "core/render/staging_ring.hpp"
 #include "core/vulkan/all_core_vulkan.hpp"
 
 #include <map>
@@ -52,6 +57,10 @@ struct FrameworkContext : public SharedObject<FrameworkContext> {
     std::shared_ptr<vk::CommandBuffer> worldCommandBuffer;
     std::shared_ptr<vk::CommandBuffer> fuseCommandBuffer;
 
+    uint32_t uploadProfileScope = GpuProfiler::invalidScope;
+    uint32_t overlayProfileScope = GpuProfiler::invalidScope;
+    uint32_t fuseProfileScope = GpuProfiler::invalidScope;
+
     FrameworkContext(std::shared_ptr<Framework> framework, uint32_t frame_index);
     ~FrameworkContext();
 
@@ -98,6 +107,11 @@ class Framework : public SharedObject<Framework> {
     std::shared_ptr<FrameworkContext> safeAcquireCurrentContext();
 
     std::shared_ptr<Pipeline> pipeline();
+    std::shared_ptr<JobSystem> jobSystem();
+    std::shared_ptr<GpuProfiler> gpuProfiler();
+    std::shared_ptr<FrameStats> frameStats();
+    std::shared_ptr<InputCapture> inputCapture();
+    std::shared_ptr<StagingRing> stagingRing();
 
     GarbageCollector &gc();
 
@@ -138,6 +152,11 @@ class Framework : public SharedObject<Framework> {
     bool running_ = true;
 
     std::shared_ptr<GarbageCollector> gc_;
+    std::shared_ptr<JobSystem> jobSystem_;
+    std::shared_ptr<GpuProfiler> gpuProfiler_;
+    std::shared_ptr<FrameStats> frameStats_;
+    std::shared_ptr<InputCapture> inputCapture_;
+    std::shared_ptr<StagingRing> stagingRing_;
 };
 
 template <typename T>
@@ -25,6 +25,24 @@ struct Options {
 
     uint32_t chunkBuildingBatchSize = 2;
     uint32_t chunkBuildingTotalBatches = 4;
+    uint32_t chunkBuildingThreads = 0; // 0 picks a quarter of the hardware threads
+    uint32_t chunkCompactionDelay = 5000; // ms, 0 disables compaction
+    uint32_t chunkCompactionBatchSize = 32;
+    bool chunkHalfPositionBLAS = false;
+    // keep host copies of built chunks. Otherwise Chunk1::vertices is nullptr once built, and a consumer that needs
+    // the vertices again has Java queue the chunk again, there is no read back from the GPU
+    bool chunkRetainCpuGeometry = false;
+    uint32_t chunkDefragmentationBudget = 4 * 1024 * 1024; // bytes of chunk geometry moved per frame, 0 disables
+    bool packedMaterialVertex = false; // 32 byte material stream, applied by the next world pipeline build
+    uint32_t tlasMaxRefits = 60; // refits of the world TLAS before it is rebuilt, 0 rebuilds every frame
+    uint32_t tlasCullDistance = 0; // blocks, chunks farther from the camera stay out of the TLAS, 0 keeps all of them
+    uint32_t tlasCullMargin = 32; // blocks added to tlasCullDistance so that bounces leaving the reach still hit
+    uint32_t chunkLodDistance = 0; // blocks, farther chunks are traced with their merged faces if built, 0 disables
+    uint32_t chunkLodMemoryBudget = 256 * 1024 * 1024; // bytes of LOD geometry and BLASes, no new LODs beyond it
+    uint32_t chunkLodBuildBudget = 2000; // us of LOD face merging per frame across the build workers
+    uint32_t entityBLASMaxRefits = 30; // refits of an entity BLAS before it is rebuilt, 0 rebuilds every frame
+    bool gpuEntityVertexExpansion = false; // upload entity quads in their game vertex format, expand them on the gpu
+    bool gpuProfiler = false;
 };
 
 class Renderer : public Singleton<Renderer> {
@@ -0,0 +1,107 @@
+#include "core/render/staging_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+StagingRing::StagingRing(std::shared_ptr<vk::VMA> vma,
+                         std::shared_ptr<vk::Device> device,
+                         VkDeviceSize size,
+                         uint32_t frameCount)
+    : vma_(vma),
+      device_(device),
+      buffer_(vk::HostVisibleBuffer::create(vma, device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT)),
+      size_(size) {
+    reset(frameCount);
+}
+
+void StagingRing::beginFrame(uint32_t frameIndex) {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    currentFrame_ = frameIndex;
+    // frames complete in submission order, everything up to the end of this one is free again
+    tail_ = std::max(tail_, frameEnds_[frameIndex]);
+    dedicatedBuffers_[frameIndex].clear();
+    frameBytes_ = 0;
+}
+
+void StagingRing::endFrame(uint32_t frameIndex) {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    frameEnds_[frameIndex] = head_;
+    maxFrameBytes_ = std::max(maxFrameBytes_, frameBytes_);
+}
+
+void StagingRing::reset(uint32_t frameCount) {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    head_ = 0;
+    tail_ = 0;
+    currentFrame_ = 0;
+    frameEnds_.assign(frameCount, 0);
+    dedicatedBuffers_.clear();
+    dedicatedBuffers_.resize(frameCount);
+}
+
+StagingRange StagingRing::stage(const void *src, VkDeviceSize size) {
+    std::unique_lock<std::mutex> lck(mutex_);
+    uploadedBytes_ += size;
+    frameBytes_ += size;
+
+    uint64_t position = (head_ + alignment - 1) / alignment * alignment;
+    // a range never wraps around the end of the buffer
+    if (position % size_ + size > size_) position += size_ - position % size_;
+
+    if (size <= size_ && position + size - tail_ <= size_) {
+        head_ = position + size;
+        VkDeviceSize offset = position % size_;
+        if (size > 0) buffer_->uploadToBuffer(const_cast<void *>(src), size, offset);
+        return {buffer_->vkBuffer(), offset, size};
+    }
+
+    if (size <= size_) stalls_++;
+    dedicatedUploads_++;
+
+    auto dedicated = vk::HostVisibleBuffer::create(vma_, device_, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    dedicated->uploadToBuffer(const_cast<void *>(src), size, 0);
+    dedicatedBuffers_[currentFrame_].push_back(dedicated);
+    return {dedicated->vkBuffer(), 0, size};
+}
+
+void StagingRing::copy(std::shared_ptr<vk::CommandBuffer> cmdBuffer,
+                       StagingRange range,
+                       VkBuffer dst,
+                       VkDeviceSize dstOffset) {
+    if (range.size == 0) return;
+
+    VkBufferCopy region{
+        .srcOffset = range.offset,
+        .dstOffset = dstOffset,
+        .size = range.size,
+    };
+    vkCmdCopyBuffer(cmdBuffer->vkCommandBuffer(), range.buffer, dst, 1, &region);
+}
+
+void StagingRing::upload(std::shared_ptr<vk::CommandBuffer> cmdBuffer,
+                         const void *src,
+                         VkDeviceSize size,
+                         VkBuffer dst,
+                         VkDeviceSize dstOffset) {
+    if (size == 0) return;
+    copy(cmdBuffer, stage(src, size), dst, dstOffset);
+}
+
+StagingRingStats StagingRing::stats() {
+    std::unique_lock<std::mutex> lck(mutex_);
+    return {
+        .uploadedBytes = uploadedBytes_,
+        .maxFrameBytes = std::max(maxFrameBytes_, frameBytes_),
+        .stalls = stalls_,
+        .dedicatedUploads = dedicatedUploads_,
+        .size = size_,
+    };
+}
+
+void StagingRing::resetPeak() {
+    std::unique_lock<std::mutex> lck(mutex_);
+    maxFrameBytes_ = 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+#include "core/vulkan/all_core_vulkan.hpp"
+
+#include <mutex>
+#include <vector>
+
+struct StagingRingStats {
+    uint64_t uploadedBytes;      // since creation, ring and dedicated
+    uint64_t maxFrameBytes;      // since the last resetPeak
+    uint64_t stalls;             // uploads that did not fit next to the frames still in flight
+    uint64_t dedicatedUploads;   // stalls and uploads larger than the whole ring
+    VkDeviceSize size;
+};
+
+struct StagingRange {
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+};
+
+// One persistently mapped staging buffer shared by the per frame uploads of the main queue. Uploads are suballocated
+// linearly, the space of a frame is reclaimed once its frame context is acquired again, i.e. after its fence was
+// waited on. Uploads that do not fit get a dedicated staging buffer that lives until the same point.
+class StagingRing : public SharedObject<StagingRing> {
+  public:
+    static constexpr VkDeviceSize defaultSize = 32 * 1024 * 1024;
+    // covers optimalBufferCopyOffsetAlignment and nonCoherentAtomSize on every known device
+    static constexpr VkDeviceSize alignment = 256;
+
+    StagingRing(std::shared_ptr<vk::VMA> vma, std::shared_ptr<vk::Device> device, VkDeviceSize size,
+                uint32_t frameCount);
+
+    // the fence of frameIndex was waited on
+    void beginFrame(uint32_t frameIndex);
+    // before the command buffers of frameIndex are submitted
+    void endFrame(uint32_t frameIndex);
+    // the device is idle, e.g. after the frame contexts were recreated
+    void reset(uint32_t frameCount);
+
+    // copies size bytes from src into staging memory that stays valid until the frame is reused, the copy out of it has
+    // to be recorded into one of the command buffers of the current frame
+    StagingRange stage(const void *src, VkDeviceSize size);
+    void copy(std::shared_ptr<vk::CommandBuffer> cmdBuffer,
+              StagingRange range,
+              VkBuffer dst,
+              VkDeviceSize dstOffset = 0);
+    // stage and copy at once
+    void upload(std::shared_ptr<vk::CommandBuffer> cmdBuffer,
+                const void *src,
+                VkDeviceSize size,
+                VkBuffer dst,
+                VkDeviceSize dstOffset = 0);
+
+    StagingRingStats stats();
+    void resetPeak();
+
+  private:
+    std::shared_ptr<vk::VMA> vma_;
+    std::shared_ptr<vk::Device> device_;
+    std::shared_ptr<vk::HostVisibleBuffer> buffer_;
+    VkDeviceSize size_;
+
+    // monotonic byte positions, the ring offset is position % size_
+    uint64_t head_ = 0;
+    uint64_t tail_ = 0;
+    std::vector<uint64_t> frameEnds_;
+    std::vector<std::vector<std::shared_ptr<vk::HostVisibleBuffer>>> dedicatedBuffers_;
+    uint32_t currentFrame_ = 0;
+
+    uint64_t uploadedBytes_ = 0;
+    uint64_t frameBytes_ = 0;
+    uint64_t maxFrameBytes_ = 0;
+    uint64_t stalls_ = 0;
+    uint64_t dedicatedUploads_ = 0;
+    std::mutex mutex_;
+};
@@ -8,6 +8,22 @@
 #include "core/render/render_framework.hpp"
 #include "core/render/renderer.hpp"
 
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+struct GeometryGroupRegistry {
+    std::mutex mutex;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> names;
+};
+
+GeometryGroupRegistry &geometryGroupRegistry() {
+    static GeometryGroupRegistry registry;
+    return registry;
+}
+} // namespace
+
 World::World(std::shared_ptr<Framework> framework)
     : chunks_(Chunks::create(framework)), entities_(Entities::create(framework)) {}
 
@@ -33,8 +49,61 @@ glm::dvec3 World::getCameraPos() {
     return cameraPos_;
 }
 
+size_t World::vertexSize(VertexFormats format) {
+    switch (format) {
+        case POSITION_COLOR_TEXTURE_LIGHT_NORMAL: return sizeof(vk::VertexFormat::PositionColorTexLightNormal);
+        case POSITION_COLOR_TEXTURE_OVERLAY_LIGHT_NORMAL:
+            return sizeof(vk::VertexFormat::PositionColorTexOverlayLightNormal);
+        case POSITION_TEXTURE_COLOR_LIGHT: return sizeof(vk::VertexFormat::PositionTexColorLight);
+        case POSITION: return sizeof(vk::VertexFormat::PositionOnly);
+        case POSITION_COLOR: return sizeof(vk::VertexFormat::PositionColor);
+        case LINES: return sizeof(vk::VertexFormat::PositionColorNormal);
+        case POSITION_COLOR_LIGHT: return sizeof(vk::VertexFormat::PositionColorLight);
+        case POSITION_TEXTURE: return sizeof(vk::VertexFormat::PositionTex);
+        case POSITION_TEXTURE_COLOR: return sizeof(vk::VertexFormat::PositionTexColor);
+        case POSITION_COLOR_TEXTURE_LIGHT: return sizeof(vk::VertexFormat::PositionColorTexLight);
+        case POSITION_TEXTURE_LIGHT_COLOR: return sizeof(vk::VertexFormat::PositionTexLightColor);
+        case POSITION_TEXTURE_COLOR_NORMAL: return sizeof(vk::VertexFormat::PositionTexColorNormal);
+        case PBR_TRIANGLE: return sizeof(vk::VertexFormat::PBRVertex);
+        default: return 0;
+    }
+}
+
+bool World::packedMaterialVertex() {
+    return packedMaterialVertex_;
+}
+
+void World::setPackedMaterialVertex(bool packed) {
+    if (packedMaterialVertex_.exchange(packed) == packed) return;
+
+    // builds in flight belong to the old generation and are discarded, the chunks report not ready until Java
+    // queues them again
+    uint32_t numChunks = static_cast<uint32_t>(chunks_->chunks().size());
+    if (numChunks > 0) chunks_->reset(numChunks);
+}
+
 void World::close() {
     shouldRenderWorld_ = false;
     chunks_->close();
     entities_->close();
 }
+
+uint32_t World::internGeometryGroup(const char *name) {
+    auto &registry = geometryGroupRegistry();
+    std::unique_lock<std::mutex> lock(registry.mutex);
+    auto [iter, inserted] = registry.ids.try_emplace(name, static_cast<uint32_t>(registry.names.size()));
+    if (inserted) { registry.names.push_back(iter->first); }
+    return iter->second;
+}
+
+uint32_t World::geometryGroupCount() {
+    auto &registry = geometryGroupRegistry();
+    std::unique_lock<std::mutex> lock(registry.mutex);
+    return static_cast<uint32_t>(registry.names.size());
+}
+
+std::string World::geometryGroupName(uint32_t id) {
+    auto &registry = geometryGroupRegistry();
+    std::unique_lock<std::mutex> lock(registry.mutex);
+    return registry.names[id];
+}
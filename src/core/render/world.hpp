@@ -5,6 +5,7 @@
 #include "core/all_extern.hpp"
 #include "core/vulkan/all_core_vulkan.hpp"
 
+#include <atomic>
 #include <condition_variable>
 #include <future>
 #include <thread>
@@ -72,6 +73,19 @@ class World : public SharedObject<World> {
     void setCameraPos(glm::dvec3 cameraPos);
     glm::dvec3 getCameraPos();
 
+    // bytes of one vertex as Java hands it over, 0 for unknown formats
+    static size_t vertexSize(VertexFormats format);
+
+    // material stream layout the world pipeline was built with, chunks and entities write theirs in it. A change
+    // drops every built chunk, since their streams are in the old layout.
+    bool packedMaterialVertex();
+    void setPackedMaterialVertex(bool packed);
+
+    // geometry group names are interned once when geometry is queued, ids are dense and never reused
+    static uint32_t internGeometryGroup(const char *name);
+    static uint32_t geometryGroupCount();
+    static std::string geometryGroupName(uint32_t id);
+
     void close();
 
   private:
@@ -79,6 +93,7 @@ class World : public SharedObject<World> {
     std::shared_ptr<Entities> entities_;
 
     glm::dvec3 cameraPos_ = {0, 0, 0};
+    std::atomic<bool> packedMaterialVertex_ = false;
 
     bool shouldRenderWorld_;
 };
\ No newline at end of file
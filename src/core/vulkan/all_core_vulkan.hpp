@@ -5,10 +5,14 @@
 #include "core/vulkan/descriptor.hpp"
 #include "core/vulkan/device.hpp"
 #include "core/vulkan/framework.hpp"
+#include "core/vulkan/geometry_arena.hpp"
 #include "core/vulkan/image.hpp"
 #include "core/vulkan/instance.hpp"
 #include "core/vulkan/physical_device.hpp"
 #include "core/vulkan/pipeline.hpp"
+#include "core/vulkan/pipeline_cache.hpp"
+#include "core/vulkan/quad_index_buffer.hpp"
+#include "core/vulkan/query.hpp"
 #include "core/vulkan/dynamic_pipeline.hpp"
 #include "core/vulkan/render_pass.hpp"
 #include "core/vulkan/swapchain.hpp"
@@ -3,14 +3,19 @@
 #include "core/vulkan/command.hpp"
 #include "core/vulkan/device.hpp"
 #include "core/vulkan/physical_device.hpp"
+#include "core/vulkan/query.hpp"
 #include "core/vulkan/vma.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <iostream>
 
 vk::BLAS::BLAS(std::shared_ptr<Device> device,
                VkAccelerationStructureKHR blas,
-               std::shared_ptr<DeviceLocalBuffer> blasBuffer)
-    : device_(device), blas_(blas), blasBuffer_(blasBuffer) {
+               std::shared_ptr<DeviceLocalBuffer> blasBuffer,
+               VkDeviceSize blasSize)
+    : device_(device), blas_(blas), blasBuffer_(blasBuffer), blasSize_(blasSize) {
     VkAccelerationStructureDeviceAddressInfoKHR deviceAddressInfo{};
     deviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
     deviceAddressInfo.accelerationStructure = blas_;
@@ -33,6 +38,18 @@ VkDeviceAddress &vk::BLAS::blasDeviceAddress() {
     return blasDeviceAddress_;
 }
 
+VkDeviceSize vk::BLAS::blasSize() {
+    return blasSize_;
+}
+
+uint64_t vk::BLAS::generation() {
+    return generation_;
+}
+
+void vk::BLAS::markRefit() {
+    generation_++;
+}
+
 vk::TLAS::TLAS(std::shared_ptr<Device> device,
                VkAccelerationStructureKHR tlas,
                std::shared_ptr<DeviceLocalBuffer> tlasBuffer)
@@ -61,6 +78,35 @@ VkDeviceAddress &vk::TLAS::tlasDeviceAddress() {
 
 vk::BLASBuilder::BLASGeometryBuilder::BLASGeometryBuilder(vk::BLASBuilder &parent) : parent(parent) {}
 
+vk::BLASBuilder::BLASGeometryBuilder &
+vk::BLASBuilder::BLASGeometryBuilder::defineTriangleGeomrtry(VkDeviceAddress vertexBufferAddress,
+                                                             VkFormat vertexFormat,
+                                                             VkDeviceSize vertexStride,
+                                                             uint32_t numVertices,
+                                                             VkDeviceAddress indexBufferAddress,
+                                                             uint32_t numIndices,
+                                                             bool isOpaque) {
+    VkAccelerationStructureGeometryKHR geom{};
+    geom.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    geom.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+    geom.flags = isOpaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR;
+
+    // 三角形数据设置
+    auto &triangles = geom.geometry.triangles;
+    triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+    triangles.vertexFormat = vertexFormat;
+    triangles.vertexData.deviceAddress = vertexBufferAddress;
+    triangles.vertexStride = vertexStride;
+    triangles.maxVertex = numVertices - 1;
+    triangles.indexType = VK_INDEX_TYPE_UINT32;
+    triangles.indexData.deviceAddress = indexBufferAddress;
+
+    geometries.push_back(geom);
+    primitiveCounts.push_back(numIndices / 3);
+
+    return *this;
+}
+
 vk::BLASBuilder::BLASGeometryBuilder &vk::BLASBuilder::BLASGeometryBuilder::definePlaceholderGeometry() {
     VkAccelerationStructureGeometryTrianglesDataKHR trianglesData{};
     trianglesData.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
@@ -179,7 +225,7 @@ std::shared_ptr<vk::BLAS> vk::BLASBuilder::buildAndSubmit(std::shared_ptr<Device
     const VkAccelerationStructureBuildRangeInfoKHR *pBuildRanges = buildRanges.data();
     vkCmdBuildAccelerationStructuresKHR(commandBuffer->vkCommandBuffer(), 1, &buildInfo, &pBuildRanges);
 
-    return BLAS::create(device, dstBLAS_, blasBuffer_);
+    return BLAS::create(device, dstBLAS_, blasBuffer_, sizeInfo_.accelerationStructureSize);
 }
 
 std::shared_ptr<vk::BLAS> vk::BLASBuilder::build(std::shared_ptr<Device> device) {
@@ -194,7 +240,7 @@ std::shared_ptr<vk::BLAS> vk::BLASBuilder::build(std::shared_ptr<Device> device)
         exit(EXIT_FAILURE);
     }
 
-    return BLAS::create(device, dstBLAS_, blasBuffer_);
+    return BLAS::create(device, dstBLAS_, blasBuffer_, sizeInfo_.accelerationStructureSize);
 }
 
 std::shared_ptr<vk::BLAS> vk::BLASBuilder::buildExternal(std::shared_ptr<Device> device,
@@ -212,7 +258,7 @@ std::shared_ptr<vk::BLAS> vk::BLASBuilder::buildExternal(std::shared_ptr<Device>
         exit(EXIT_FAILURE);
     }
 
-    return BLAS::create(device, dstBLAS_, buffer);
+    return BLAS::create(device, dstBLAS_, buffer, sizeInfo_.accelerationStructureSize);
 }
 
 void vk::BLASBuilder::submit(std::shared_ptr<vk::CommandBuffer> commandBuffer) {
@@ -338,9 +384,74 @@ void vk::BLASBuilder::batchSubmitExternal(std::vector<std::shared_ptr<BLASBuilde
                                         pbuildRanges.data());
 }
 
+void vk::BLASBuilder::writeCompactedSizes(std::vector<std::shared_ptr<BLAS>> &blass,
+                                          std::shared_ptr<QueryPool> queryPool,
+                                          uint32_t firstQuery,
+                                          std::shared_ptr<CommandBuffer> commandBuffer) {
+    std::vector<VkAccelerationStructureKHR> accelerationStructures;
+    for (auto &blas : blass) { accelerationStructures.push_back(blas->blas()); }
+
+    vkCmdResetQueryPool(commandBuffer->vkCommandBuffer(), queryPool->vkQueryPool(), firstQuery,
+                        static_cast<uint32_t>(accelerationStructures.size()));
+    vkCmdWriteAccelerationStructuresPropertiesKHR(
+        commandBuffer->vkCommandBuffer(), static_cast<uint32_t>(accelerationStructures.size()),
+        accelerationStructures.data(), VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+        queryPool->vkQueryPool(), firstQuery);
+}
+
+std::shared_ptr<vk::BLAS> vk::BLASBuilder::compact(std::shared_ptr<Device> device,
+                                                   std::shared_ptr<VMA> vma,
+                                                   std::shared_ptr<BLAS> srcBLAS,
+                                                   VkDeviceSize compactedSize,
+                                                   std::shared_ptr<CommandBuffer> commandBuffer) {
+    auto blasBuffer = DeviceLocalBuffer::create(vma, device, false, compactedSize,
+                                                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
+                                                    VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                0, VMA_MEMORY_USAGE_GPU_ONLY, 256);
+
+    VkAccelerationStructureCreateInfoKHR createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+    createInfo.buffer = blasBuffer->vkBuffer();
+    createInfo.size = compactedSize;
+    createInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+
+    VkAccelerationStructureKHR dstBLAS = VK_NULL_HANDLE;
+    if (vkCreateAccelerationStructureKHR(device->vkDevice(), &createInfo, nullptr, &dstBLAS) != VK_SUCCESS) {
+        std::cout << "Cannot create compacted BLAS" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    VkCopyAccelerationStructureInfoKHR copyInfo{};
+    copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+    copyInfo.src = srcBLAS->blas();
+    copyInfo.dst = dstBLAS;
+    copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+    vkCmdCopyAccelerationStructureKHR(commandBuffer->vkCommandBuffer(), &copyInfo);
+
+    return BLAS::create(device, dstBLAS, blasBuffer, compactedSize);
+}
+
 std::shared_ptr<vk::BLASBuilder> vk::BLASBatchBuilder::defineBLASBuilder() {
     auto blasBuilder = BLASBuilder::create();
     builders_.push_back(blasBuilder);
+    dedicatedStorage_.push_back(false);
+    refitTargets_.push_back(nullptr);
+    return blasBuilder;
+}
+
+std::shared_ptr<vk::BLASBuilder> vk::BLASBatchBuilder::defineDedicatedBLASBuilder() {
+    auto blasBuilder = BLASBuilder::create();
+    builders_.push_back(blasBuilder);
+    dedicatedStorage_.push_back(true);
+    refitTargets_.push_back(nullptr);
+    return blasBuilder;
+}
+
+std::shared_ptr<vk::BLASBuilder> vk::BLASBatchBuilder::defineRefitBLASBuilder(std::shared_ptr<BLAS> blas) {
+    auto blasBuilder = BLASBuilder::create();
+    builders_.push_back(blasBuilder);
+    dedicatedStorage_.push_back(false);
+    refitTargets_.push_back(blas);
     return blasBuilder;
 }
 
@@ -357,10 +468,23 @@ std::shared_ptr<vk::BLASBatchBuilder> vk::BLASBatchBuilder::allocateBuffers(
     VkDeviceSize totalBlasSize = 0;
     VkDeviceSize totalScratchSize = 0;
 
-    for (auto builder : builders_) {
-        blasOffsets_.push_back(totalBlasSize);
-        totalBlasSize += builder->sizeInfo_.accelerationStructureSize;
-        totalBlasSize = alignUp(totalBlasSize, blasAlignment);
+    for (int i = 0; auto builder : builders_) {
+        if (refitTargets_[i] != nullptr) {
+            // updated in place, only scratch memory is needed
+            blasOffsets_.push_back(0);
+        } else if (dedicatedStorage_[i]) {
+            blasOffsets_.push_back(0);
+            builder->blasBuffer_ = DeviceLocalBuffer::create(vma, device, false,
+                                                             builder->sizeInfo_.accelerationStructureSize,
+                                                             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
+                                                                 VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                             0, VMA_MEMORY_USAGE_GPU_ONLY, 256);
+        } else {
+            blasOffsets_.push_back(totalBlasSize);
+            totalBlasSize += builder->sizeInfo_.accelerationStructureSize;
+            totalBlasSize = alignUp(totalBlasSize, blasAlignment);
+        }
+        i++;
 
         scratchOffsets_.push_back(totalScratchSize);
         totalScratchSize += builder->mode_ == VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR ?
@@ -369,10 +493,12 @@ std::shared_ptr<vk::BLASBatchBuilder> vk::BLASBatchBuilder::allocateBuffers(
         totalScratchSize = alignUp(totalScratchSize, scratchAlignment);
     }
 
-    blasBuffer_ = DeviceLocalBuffer::create(vma, device, false, totalBlasSize,
-                                            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
-                                                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-                                            0, VMA_MEMORY_USAGE_GPU_ONLY, 256);
+    if (totalBlasSize > 0) {
+        blasBuffer_ = DeviceLocalBuffer::create(vma, device, false, totalBlasSize,
+                                                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
+                                                    VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                0, VMA_MEMORY_USAGE_GPU_ONLY, 256);
+    }
 
     scratchBuffer_ = DeviceLocalBuffer::create(
         vma, device, false, totalScratchSize,
@@ -390,8 +516,16 @@ std::vector<std::shared_ptr<vk::BLAS>> vk::BLASBatchBuilder::build(std::shared_p
     std::vector<std::shared_ptr<vk::BLAS>> results;
 
     for (int i = 0; auto builder : builders_) {
-        auto result = builder->buildExternal(device, blasBuffer_, blasOffsets_[i++]);
-        results.push_back(result);
+        if (refitTargets_[i] != nullptr) {
+            builder->dstBLAS_ = refitTargets_[i]->blas();
+            refitTargets_[i]->markRefit();
+            results.push_back(refitTargets_[i]);
+        } else if (dedicatedStorage_[i]) {
+            results.push_back(builder->build(device));
+        } else {
+            results.push_back(builder->buildExternal(device, blasBuffer_, blasOffsets_[i]));
+        }
+        i++;
     }
 
     return results;
@@ -531,3 +665,194 @@ std::shared_ptr<vk::TLAS> vk::TLASBuilder::buildAndSubmit(std::shared_ptr<Device
 
     return TLAS::create(device, dstTLAS_, tlasBuffer_);
 }
+
+vk::PersistentTLAS::PersistentTLAS(std::shared_ptr<Device> device, std::shared_ptr<VMA> vma)
+    : device_(device), vma_(vma) {}
+
+void vk::PersistentTLAS::resize(uint32_t slotCount) {
+    uint32_t oldCount = static_cast<uint32_t>(instances_.size());
+    if (slotCount == oldCount) return;
+
+    for (uint32_t i = slotCount; i < oldCount; i++) {
+        if (instances_[i].accelerationStructureReference != 0) activeCount_--;
+    }
+    instances_.resize(slotCount, VkAccelerationStructureInstanceKHR{});
+    blass_.resize(slotCount);
+    blasGenerations_.resize(slotCount, 0);
+
+    // the primitive count changed, a refit is not allowed anymore
+    needsRebuild_ = true;
+    if (dirtyEnd_ > slotCount) dirtyEnd_ = slotCount;
+    if (dirtyBegin_ > dirtyEnd_) dirtyBegin_ = dirtyEnd_;
+    for (uint32_t i = oldCount; i < slotCount; i++) markDirty(i);
+}
+
+void vk::PersistentTLAS::setInstance(uint32_t slot,
+                                     VkTransformMatrixKHR transform,
+                                     uint32_t customIndex,
+                                     uint32_t mask,
+                                     uint32_t offset,
+                                     VkGeometryInstanceFlagsKHR flag,
+                                     std::shared_ptr<BLAS> blas) {
+    VkAccelerationStructureInstanceKHR instance{};
+    instance.transform = transform;
+    instance.instanceCustomIndex = customIndex;
+    instance.mask = mask;
+    instance.instanceShaderBindingTableRecordOffset = offset;
+    instance.flags = flag;
+    instance.accelerationStructureReference = blas->blasDeviceAddress();
+
+    auto &current = instances_[slot];
+    // toggling the active state of an instance is not allowed in an update
+    if (current.accelerationStructureReference == 0) {
+        activeCount_++;
+        needsRebuild_ = true;
+    }
+    // a rebuilt BLAS may reuse the device address of the one it replaces and a refit one keeps it, the record
+    // alone does not tell
+    bool sameBlas = blass_[slot] == blas && blasGenerations_[slot] == blas->generation();
+    blass_[slot] = blas;
+    blasGenerations_[slot] = blas->generation();
+
+    if (sameBlas && std::memcmp(&current, &instance, sizeof(VkAccelerationStructureInstanceKHR)) == 0) return;
+    current = instance;
+    markDirty(slot);
+}
+
+void vk::PersistentTLAS::clearInstance(uint32_t slot) {
+    auto &current = instances_[slot];
+    if (current.accelerationStructureReference == 0) return;
+
+    activeCount_--;
+    needsRebuild_ = true;
+    current = VkAccelerationStructureInstanceKHR{};
+    blass_[slot] = nullptr;
+    markDirty(slot);
+}
+
+void vk::PersistentTLAS::markDirty(uint32_t slot) {
+    if (dirtyBegin_ >= dirtyEnd_) {
+        dirtyBegin_ = slot;
+        dirtyEnd_ = slot + 1;
+        return;
+    }
+    dirtyBegin_ = std::min(dirtyBegin_, slot);
+    dirtyEnd_ = std::max(dirtyEnd_, slot + 1);
+}
+
+void vk::PersistentTLAS::allocate(std::shared_ptr<PhysicalDevice> physicalDevice) {
+    // grow geometrically so that slowly growing slot counts do not reallocate every frame
+    capacity_ = std::max(std::bit_ceil(static_cast<uint32_t>(instances_.size())), 64u);
+
+    instanceBuffer_ =
+        HostVisibleBuffer::create(vma_, device_, sizeof(VkAccelerationStructureInstanceKHR) * capacity_,
+                                  VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+                                      VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR);
+
+    VkAccelerationStructureGeometryKHR geometry{};
+    geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    geometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+    geometry.geometry.instances.arrayOfPointers = VK_FALSE;
+
+    VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+    buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+    buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+                      VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    buildInfo.geometryCount = 1;
+    buildInfo.pGeometries = &geometry;
+
+    VkAccelerationStructureBuildSizesInfoKHR sizeInfo{};
+    sizeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+    vkGetAccelerationStructureBuildSizesKHR(device_->vkDevice(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+                                            &buildInfo, &capacity_, &sizeInfo);
+
+    auto tlasBuffer = DeviceLocalBuffer::create(vma_, device_, false, sizeInfo.accelerationStructureSize,
+                                                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
+                                                    VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                0, VMA_MEMORY_USAGE_GPU_ONLY, 256);
+
+    scratchBuffer_ = DeviceLocalBuffer::create(
+        vma_, device_, false, std::max(sizeInfo.buildScratchSize, sizeInfo.updateScratchSize),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0, VMA_MEMORY_USAGE_GPU_ONLY,
+        physicalDevice->accelerationStructProperties().minAccelerationStructureScratchOffsetAlignment);
+
+    VkAccelerationStructureCreateInfoKHR tlasCreateInfo{};
+    tlasCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+    tlasCreateInfo.buffer = tlasBuffer->vkBuffer();
+    tlasCreateInfo.size = sizeInfo.accelerationStructureSize;
+    tlasCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+
+    VkAccelerationStructureKHR tlas;
+    if (vkCreateAccelerationStructureKHR(device_->vkDevice(), &tlasCreateInfo, nullptr, &tlas) != VK_SUCCESS) {
+        std::cout << "Cannot create TLAS" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    tlas_ = TLAS::create(device_, tlas, tlasBuffer);
+
+    // fresh buffer, every slot has to be written
+    needsRebuild_ = true;
+    dirtyBegin_ = 0;
+    dirtyEnd_ = static_cast<uint32_t>(instances_.size());
+}
+
+std::shared_ptr<vk::TLAS> vk::PersistentTLAS::buildAndSubmit(std::shared_ptr<PhysicalDevice> physicalDevice,
+                                                             std::shared_ptr<CommandBuffer> commandBuffer,
+                                                             uint32_t maxRefits) {
+    if (activeCount_ == 0) return nullptr;
+
+    // the previous users of this TLAS have finished, the caller only reuses it once the frame fence was waited on
+    if (tlas_ == nullptr || capacity_ < instances_.size()) allocate(physicalDevice);
+
+    if (dirtyBegin_ >= dirtyEnd_ && !needsRebuild_) return tlas_;
+
+    if (dirtyBegin_ < dirtyEnd_) {
+        instanceBuffer_->uploadToBuffer(instances_.data() + dirtyBegin_,
+                                        sizeof(VkAccelerationStructureInstanceKHR) * (dirtyEnd_ - dirtyBegin_),
+                                        sizeof(VkAccelerationStructureInstanceKHR) * dirtyBegin_);
+        dirtyBegin_ = dirtyEnd_ = 0;
+    }
+
+    bool refit = !needsRebuild_ && refitsSinceRebuild_ < maxRefits;
+
+    VkAccelerationStructureGeometryKHR geometry{};
+    geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    geometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+    geometry.geometry.instances.arrayOfPointers = VK_FALSE;
+    geometry.geometry.instances.data.deviceAddress = instanceBuffer_->bufferAddress();
+
+    VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+    buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+    buildInfo.mode =
+        refit ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+                      VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    buildInfo.geometryCount = 1;
+    buildInfo.pGeometries = &geometry;
+    buildInfo.srcAccelerationStructure = refit ? tlas_->tlas() : VK_NULL_HANDLE;
+    buildInfo.dstAccelerationStructure = tlas_->tlas();
+    buildInfo.scratchData.deviceAddress = scratchBuffer_->bufferAddress();
+
+    VkAccelerationStructureBuildRangeInfoKHR buildRanges{};
+    buildRanges.primitiveCount = static_cast<uint32_t>(instances_.size());
+    buildRanges.primitiveOffset = 0;
+
+    const VkAccelerationStructureBuildRangeInfoKHR *pBuildRanges = &buildRanges;
+    vkCmdBuildAccelerationStructuresKHR(commandBuffer->vkCommandBuffer(), 1, &buildInfo, &pBuildRanges);
+
+    refitsSinceRebuild_ = refit ? refitsSinceRebuild_ + 1 : 0;
+    needsRebuild_ = false;
+    return tlas_;
+}
+
+uint32_t vk::PersistentTLAS::slotCount() {
+    return static_cast<uint32_t>(instances_.size());
+}
+
+uint32_t vk::PersistentTLAS::activeCount() {
+    return activeCount_;
+}
@@ -14,17 +14,24 @@ class CommandBuffer;
 class PhysicalDevice;
 class Device;
 class VMA;
+class QueryPool;
 
 class BLAS : public SharedObject<BLAS> {
   public:
     BLAS(std::shared_ptr<Device> device,
          VkAccelerationStructureKHR blas,
-         std::shared_ptr<DeviceLocalBuffer> blasBuffer);
+         std::shared_ptr<DeviceLocalBuffer> blasBuffer,
+         VkDeviceSize blasSize);
     ~BLAS();
 
     std::shared_ptr<DeviceLocalBuffer> blasBuffer();
     VkAccelerationStructureKHR &blas();
     VkDeviceAddress &blasDeviceAddress();
+    VkDeviceSize blasSize();
+
+    // bumped by every refit in place, TLASes referencing the BLAS have to be updated when it changes
+    uint64_t generation();
+    void markRefit();
 
   private:
     std::shared_ptr<Device> device_;
@@ -32,6 +39,8 @@ class BLAS : public SharedObject<BLAS> {
 
     VkAccelerationStructureKHR blas_;
     VkDeviceAddress blasDeviceAddress_;
+    VkDeviceSize blasSize_;
+    uint64_t generation_ = 0;
 };
 
 class TLAS : public SharedObject<TLAS> {
@@ -79,6 +88,13 @@ class BLASBuilder : public SharedObject<BLASBuilder> {
                                                     VkDeviceAddress indexBufferAddress,
                                                     uint32_t numIndices,
                                                     bool isOpaque);
+        BLASGeometryBuilder &defineTriangleGeomrtry(VkDeviceAddress vertexBufferAddress,
+                                                    VkFormat vertexFormat,
+                                                    VkDeviceSize vertexStride,
+                                                    uint32_t numVertices,
+                                                    VkDeviceAddress indexBufferAddress,
+                                                    uint32_t numIndices,
+                                                    bool isOpaque);
 
         BLASGeometryBuilder &definePlaceholderGeometry();
 
@@ -108,6 +124,18 @@ class BLASBuilder : public SharedObject<BLASBuilder> {
                                     std::vector<VkDeviceAddress> scratchBufferAddress,
                                     std::shared_ptr<CommandBuffer> commandBuffer);
 
+    // Compaction, only valid for BLAS built with VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR. The
+    // compacted sizes land in queries [firstQuery, firstQuery + blass.size()) once the command buffer finished.
+    static void writeCompactedSizes(std::vector<std::shared_ptr<BLAS>> &blass,
+                                    std::shared_ptr<QueryPool> queryPool,
+                                    uint32_t firstQuery,
+                                    std::shared_ptr<CommandBuffer> commandBuffer);
+    static std::shared_ptr<BLAS> compact(std::shared_ptr<Device> device,
+                                         std::shared_ptr<VMA> vma,
+                                         std::shared_ptr<BLAS> srcBLAS,
+                                         VkDeviceSize compactedSize,
+                                         std::shared_ptr<CommandBuffer> commandBuffer);
+
   private:
     BLASGeometryBuilder geometryBuilder_;
 
@@ -125,7 +153,13 @@ class BLASBuilder : public SharedObject<BLASBuilder> {
 
 class BLASBatchBuilder : public SharedObject<BLASBatchBuilder> {
   public:
+    // placed in the storage shared by the batch, lives as long as any BLAS of the batch
     std::shared_ptr<BLASBuilder> defineBLASBuilder();
+    // placed in its own storage, so it can be kept after the rest of the batch is released
+    std::shared_ptr<BLASBuilder> defineDedicatedBLASBuilder();
+    // refits blas in place, it has to be built with VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR and the
+    // builder given the same geometry layout through defineUpdateProperty
+    std::shared_ptr<BLASBuilder> defineRefitBLASBuilder(std::shared_ptr<BLAS> blas);
     std::shared_ptr<BLASBatchBuilder> allocateBuffers(std::shared_ptr<PhysicalDevice> physicalDevice,
                                                       std::shared_ptr<Device> device,
                                                       std::shared_ptr<VMA> vma);
@@ -134,6 +168,8 @@ class BLASBatchBuilder : public SharedObject<BLASBatchBuilder> {
 
   private:
     std::vector<std::shared_ptr<BLASBuilder>> builders_;
+    std::vector<bool> dedicatedStorage_;
+    std::vector<std::shared_ptr<BLAS>> refitTargets_;
 
     std::shared_ptr<DeviceLocalBuffer> blasBuffer_;
     std::shared_ptr<DeviceLocalBuffer> scratchBuffer_;
@@ -205,6 +241,56 @@ class TLASBuilder : public SharedObject<TLASBuilder> {
     VkAccelerationStructureKHR srcTLAS_ = VK_NULL_HANDLE;
     VkAccelerationStructureKHR dstTLAS_ = VK_NULL_HANDLE;
 };
+
+// TLAS whose instance buffer and storage outlive a single frame. Instances sit in stable slots and only slots whose
+// content changed are rewritten into the mapped instance buffer. The structure is refit in place unless the slot count
+// or the set of active slots changed, or too many refits piled up since the last full build.
+class PersistentTLAS : public SharedObject<PersistentTLAS> {
+  public:
+    PersistentTLAS(std::shared_ptr<Device> device, std::shared_ptr<VMA> vma);
+
+    // new slots start inactive, slots past the new count are dropped
+    void resize(uint32_t slotCount);
+    void setInstance(uint32_t slot,
+                     VkTransformMatrixKHR transform,
+                     uint32_t customIndex,
+                     uint32_t mask,
+                     uint32_t offset,
+                     VkGeometryInstanceFlagsKHR flag,
+                     std::shared_ptr<BLAS> blas);
+    void clearInstance(uint32_t slot);
+
+    // returns nullptr when no slot is active, the previous TLAS when nothing changed
+    std::shared_ptr<TLAS> buildAndSubmit(std::shared_ptr<PhysicalDevice> physicalDevice,
+                                         std::shared_ptr<CommandBuffer> commandBuffer,
+                                         uint32_t maxRefits);
+
+    uint32_t slotCount();
+    uint32_t activeCount();
+
+  private:
+    void markDirty(uint32_t slot);
+    void allocate(std::shared_ptr<PhysicalDevice> physicalDevice);
+
+  private:
+    std::shared_ptr<Device> device_;
+    std::shared_ptr<VMA> vma_;
+
+    std::vector<VkAccelerationStructureInstanceKHR> instances_;
+    std::vector<std::shared_ptr<BLAS>> blass_;
+    std::vector<uint64_t> blasGenerations_; // generation of blass_ when the slot was last written
+    uint32_t activeCount_ = 0;
+
+    uint32_t dirtyBegin_ = 0;
+    uint32_t dirtyEnd_ = 0;
+    bool needsRebuild_ = true;
+    uint32_t refitsSinceRebuild_ = 0;
+
+    uint32_t capacity_ = 0;
+    std::shared_ptr<HostVisibleBuffer> instanceBuffer_;
+    std::shared_ptr<DeviceLocalBuffer> scratchBuffer_;
+    std::shared_ptr<TLAS> tlas_;
+};
 }; // namespace vk
 
 template <typename T>
@@ -225,23 +311,7 @@ vk::BLASBuilder::BLASGeometryBuilder::defineTriangleGeomrtry(VkDeviceAddress ver
                                                              VkDeviceAddress indexBufferAddress,
                                                              uint32_t numIndices,
                                                              bool isOpaque) {
-    VkAccelerationStructureGeometryKHR geom{};
-    geom.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-    geom.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
-    geom.flags = isOpaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR;
-
-    // 三角形数据设置
-    auto &triangles = geom.geometry.triangles;
-    triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-    triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT; // 顶点pos格式，强制在第一位
-    triangles.vertexData.deviceAddress = vertexBufferAddress;
-    triangles.vertexStride = sizeof(T);
-    triangles.maxVertex = numVertices - 1;
-    triangles.indexType = VK_INDEX_TYPE_UINT32;
-    triangles.indexData.deviceAddress = indexBufferAddress;
-
-    geometries.push_back(geom);
-    primitiveCounts.push_back(numIndices / 3);
-
-    return *this;
+    // position is forced to be the first member of T
+    return defineTriangleGeomrtry(vertexBufferAddress, VK_FORMAT_R32G32B32_SFLOAT, sizeof(T), numVertices,
+                                  indexBufferAddress, numIndices, isOpaque);
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "core/render/modules/world/xess_upscaler/xess_wrapper.hpp"
 #include "core/vulkan/instance.hpp"
 #include "core/vulkan/physical_device.hpp"
+#include "core/vulkan/pipeline_cache.hpp"
 
 #include <cstring>
 #include <iostream>
@@ -408,6 +409,7 @@ vk::Device::Device(std::shared_ptr<Instance> instance,
 vk::Device::~Device() {
     if (device_ != VK_NULL_HANDLE) {
         vkDeviceWaitIdle(device_);
+        pipelineCache_ = nullptr;
         vkDestroyDevice(device_, nullptr);
         device_ = VK_NULL_HANDLE;
     }
@@ -429,6 +431,14 @@ VkQueue &vk::Device::secondaryQueue() {
     return secondaryQueue_;
 }
 
+std::shared_ptr<vk::PipelineCache> &vk::Device::pipelineCache() {
+    return pipelineCache_;
+}
+
+VkPipelineCache vk::Device::vkPipelineCache() {
+    return pipelineCache_ != nullptr ? pipelineCache_->vkPipelineCache() : VK_NULL_HANDLE;
+}
+
 bool vk::Device::hasExtendedDynamicState2LogicOp() const {
     return extendedDynamicState2LogicOp_;
 }
@@ -6,6 +6,7 @@ namespace vk {
 class Instance;
 class Window;
 class PhysicalDevice;
+class PipelineCache;
 
 class Device : public SharedObject<Device> {
   public:
@@ -18,6 +19,9 @@ class Device : public SharedObject<Device> {
     VkQueue &mainVkQueue();
     VkQueue &secondaryQueue();
 
+    std::shared_ptr<PipelineCache> &pipelineCache();
+    VkPipelineCache vkPipelineCache();
+
     bool hasExtendedDynamicState2LogicOp() const;
     bool isDlssDeviceExtensionsCompatible() const;
     bool isXessDeviceExtensionsCompatible() const;
@@ -31,6 +35,8 @@ class Device : public SharedObject<Device> {
     VkQueue mainQueue_ = VK_NULL_HANDLE;
     VkQueue secondaryQueue_ = VK_NULL_HANDLE;
 
+    std::shared_ptr<PipelineCache> pipelineCache_;
+
     bool extendedDynamicState2LogicOp_ = false;
     bool dlssDeviceExtensionsCompatible_ = false;
     bool xessDeviceExtensionsCompatible_ = false;
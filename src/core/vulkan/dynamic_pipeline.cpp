@@ -2,6 +2,7 @@
 
 #include "core/vulkan/descriptor.hpp"
 #include "core/vulkan/device.hpp"
+#include "core/vulkan/pipeline_cache.hpp"
 #include "core/vulkan/render_pass.hpp"
 #include "core/vulkan/shader.hpp"
 
@@ -141,9 +142,12 @@ std::shared_ptr<vk::DynamicGraphicsPipeline> vk::DynamicGraphicsPipelineBuilder:
     pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineCreateInfo.basePipelineIndex = -1;
 
+    PipelineCreationFeedback feedback(pipelineCreateInfo.pNext);
+    pipelineCreateInfo.pNext = &feedback.createInfo;
+
     VkPipeline pipeline;
-    if (vkCreateGraphicsPipelines(device->vkDevice(), VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline) !=
-        VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(device->vkDevice(), device->vkPipelineCache(), 1, &pipelineCreateInfo, nullptr,
+                                  &pipeline) != VK_SUCCESS) {
         dynamicGraphicsPipelineCerr() << "failed to create graphics pipeline" << std::endl;
         exit(EXIT_FAILURE);
     } else {
@@ -151,6 +155,7 @@ std::shared_ptr<vk::DynamicGraphicsPipeline> vk::DynamicGraphicsPipelineBuilder:
         dynamicGraphicsPipelineCout() << "created dynamic graphics pipeline" << std::endl;
 #endif
     }
+    if (device->pipelineCache() != nullptr) device->pipelineCache()->recordCreation(feedback);
 
     return std::make_shared<DynamicGraphicsPipeline>(device, pipeline);
 }
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "core/vulkan/geometry_arena.hpp"
+
+#include "core/vulkan/buffer.hpp"
+#include "core/vulkan/command.hpp"
+#include "core/vulkan/device.hpp"
+#include "core/vulkan/vma.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+std::ostream &geometryArenaCout() {
+    return std::cout << "[GeometryArena] ";
+}
+
+std::ostream &geometryArenaCerr() {
+    return std::cerr << "[GeometryArena] ";
+}
+
+vk::GeometryAllocation::GeometryAllocation(std::shared_ptr<GeometryArena> arena,
+                                           std::shared_ptr<DeviceLocalBuffer> blockBuffer,
+                                           uint32_t block,
+                                           VkDeviceSize offset,
+                                           VkDeviceSize size)
+    : arena_(arena),
+      blockBuffer_(blockBuffer),
+      block_(block),
+      offset_(offset),
+      size_(size),
+      bufferAddress_(blockBuffer->bufferAddress() + offset) {}
+
+vk::GeometryAllocation::~GeometryAllocation() {
+    arena_->free(block_, offset_, size_);
+}
+
+uint32_t vk::GeometryAllocation::block() {
+    return block_;
+}
+
+VkDeviceSize vk::GeometryAllocation::offset() {
+    return offset_;
+}
+
+VkDeviceSize vk::GeometryAllocation::size() {
+    return size_;
+}
+
+VkBuffer &vk::GeometryAllocation::vkBuffer() {
+    return blockBuffer_->vkBuffer();
+}
+
+VkDeviceAddress vk::GeometryAllocation::bufferAddress() {
+    return bufferAddress_;
+}
+
+vk::GeometryArena::GeometryArena(std::shared_ptr<VMA> vma, std::shared_ptr<Device> device)
+    : vma_(vma), device_(device) {}
+
+VkDeviceSize vk::GeometryArena::alignUp(VkDeviceSize size) {
+    return (std::max<VkDeviceSize>(size, 1) + alignment - 1) / alignment * alignment;
+}
+
+std::shared_ptr<vk::GeometryAllocation> vk::GeometryArena::allocate(VkDeviceSize size) {
+    std::unique_lock<std::mutex> lck(mutex_);
+    return allocateLocked(size, true);
+}
+
+std::shared_ptr<vk::GeometryAllocation> vk::GeometryArena::allocateLocked(VkDeviceSize size, bool allowNewBlock) {
+    VkDeviceSize alignedSize = alignUp(size);
+    VkDeviceSize offset = 0;
+
+    if (alignedSize > blockSize) {
+        if (!allowNewBlock) return nullptr;
+        uint32_t index = createBlock(alignedSize);
+        tryAllocate(blocks_[index], alignedSize, offset);
+        return GeometryAllocation::create(shared_from_this(), blocks_[index].buffer, index, offset, size);
+    }
+
+    for (uint32_t i = 0; i < blocks_.size(); i++) {
+        if (blocks_[i].buffer == nullptr || i == drainingBlock_) continue;
+        if (tryAllocate(blocks_[i], alignedSize, offset)) {
+            return GeometryAllocation::create(shared_from_this(), blocks_[i].buffer, i, offset, size);
+        }
+    }
+
+    if (!allowNewBlock) return nullptr;
+    uint32_t index = createBlock(blockSize);
+    tryAllocate(blocks_[index], alignedSize, offset);
+    return GeometryAllocation::create(shared_from_this(), blocks_[index].buffer, index, offset, size);
+}
+
+bool vk::GeometryArena::tryAllocate(Block &block, VkDeviceSize alignedSize, VkDeviceSize &offset) {
+    // every offset and size is a multiple of the alignment, so are the free ranges
+    for (auto iter = block.freeRanges.begin(); iter != block.freeRanges.end(); iter++) {
+        if (iter->second < alignedSize) continue;
+
+        offset = iter->first;
+        VkDeviceSize remaining = iter->second - alignedSize;
+        block.freeRanges.erase(iter);
+        if (remaining > 0) block.freeRanges.emplace(offset + alignedSize, remaining);
+
+        block.usedBytes += alignedSize;
+        block.allocationCount++;
+        return true;
+    }
+    return false;
+}
+
+uint32_t vk::GeometryArena::createBlock(VkDeviceSize size) {
+    auto iter =
+        std::find_if(blocks_.begin(), blocks_.end(), [](const Block &block) { return block.buffer == nullptr; });
+    if (iter == blocks_.end()) iter = blocks_.emplace(blocks_.end());
+
+    iter->buffer = DeviceLocalBuffer::create(vma_, device_, false, size,
+                                             VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+                                                 VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    iter->freeRanges.clear();
+    iter->freeRanges.emplace(0, size);
+    iter->size = size;
+    iter->usedBytes = 0;
+    iter->allocationCount = 0;
+
+    VkDeviceSize reserved = 0;
+    for (const auto &block : blocks_) { reserved += block.size; }
+    reservedHighWater_ = std::max(reservedHighWater_, reserved);
+
+    return static_cast<uint32_t>(iter - blocks_.begin());
+}
+
+void vk::GeometryArena::free(uint32_t index, VkDeviceSize offset, VkDeviceSize size) {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    auto &block = blocks_[index];
+    VkDeviceSize alignedSize = alignUp(size);
+    block.usedBytes -= alignedSize;
+    block.allocationCount--;
+
+    auto iter = block.freeRanges.emplace(offset, alignedSize).first;
+    auto next = std::next(iter);
+    if (next != block.freeRanges.end() && iter->first + iter->second == next->first) {
+        iter->second += next->second;
+        block.freeRanges.erase(next);
+    }
+    if (iter != block.freeRanges.begin()) {
+        auto prev = std::prev(iter);
+        if (prev->first + prev->second == iter->first) {
+            prev->second += iter->second;
+            block.freeRanges.erase(iter);
+        }
+    }
+
+    // keep one regular block around so that a reloading world does not recreate it right away
+    if (block.allocationCount > 0) return;
+    if (index != drainingBlock_ && block.size == blockSize && liveBlockCount() <= 1) return;
+
+    // the allocation being destroyed still holds the buffer, it is destroyed after the lock is released
+    block.buffer = nullptr;
+    block.freeRanges.clear();
+    block.size = 0;
+    if (index == drainingBlock_) drainingBlock_ = invalidBlock;
+    releasedBlocks_++;
+}
+
+uint32_t vk::GeometryArena::liveBlockCount() {
+    return static_cast<uint32_t>(
+        std::count_if(blocks_.begin(), blocks_.end(), [](const Block &block) { return block.buffer != nullptr; }));
+}
+
+uint32_t vk::GeometryArena::beginDrain() {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    if (drainingBlock_ != invalidBlock) return drainingBlock_;
+    if (liveBlockCount() < 2) return invalidBlock;
+
+    uint32_t candidate = invalidBlock;
+    double candidateOccupancy = drainOccupancy;
+    VkDeviceSize freeBytes = 0;
+    for (uint32_t i = 0; i < blocks_.size(); i++) {
+        if (blocks_[i].buffer == nullptr) continue;
+        freeBytes += blocks_[i].size - blocks_[i].usedBytes;
+
+        // dedicated blocks hold a single range that fits nowhere else
+        if (blocks_[i].size != blockSize) continue;
+        double occupancy = static_cast<double>(blocks_[i].usedBytes) / blocks_[i].size;
+        if (occupancy < candidateOccupancy) {
+            candidate = i;
+            candidateOccupancy = occupancy;
+        }
+    }
+    if (candidate == invalidBlock) return invalidBlock;
+
+    // the free space of the candidate itself does not count
+    freeBytes -= blocks_[candidate].size - blocks_[candidate].usedBytes;
+    if (freeBytes < blocks_[candidate].usedBytes) return invalidBlock;
+
+    drainingBlock_ = candidate;
+    return drainingBlock_;
+}
+
+void vk::GeometryArena::cancelDrain() {
+    std::unique_lock<std::mutex> lck(mutex_);
+    drainingBlock_ = invalidBlock;
+}
+
+std::shared_ptr<vk::GeometryAllocation> vk::GeometryArena::relocate(std::shared_ptr<CommandBuffer> commandBuffer,
+                                                                    std::shared_ptr<GeometryAllocation> src) {
+    std::shared_ptr<GeometryAllocation> dst;
+    {
+        std::unique_lock<std::mutex> lck(mutex_);
+        dst = allocateLocked(src->size(), false);
+        if (dst == nullptr) return nullptr;
+        relocatedBytes_ += src->size();
+    }
+
+    if (src->size() > 0) {
+        VkBufferCopy region{
+            .srcOffset = src->offset(),
+            .dstOffset = dst->offset(),
+            .size = src->size(),
+        };
+        vkCmdCopyBuffer(commandBuffer->vkCommandBuffer(), src->vkBuffer(), dst->vkBuffer(), 1, &region);
+    }
+    return dst;
+}
+
+vk::GeometryArenaStats vk::GeometryArena::stats() {
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    GeometryArenaStats stats{};
+    VkDeviceSize freeBytes = 0;
+    for (const auto &block : blocks_) {
+        if (block.buffer == nullptr) continue;
+        stats.blockCount++;
+        stats.allocationCount += block.allocationCount;
+        stats.freeRangeCount += static_cast<uint32_t>(block.freeRanges.size());
+        stats.reservedBytes += block.size;
+        stats.usedBytes += block.usedBytes;
+        for (const auto &[offset, size] : block.freeRanges) {
+            stats.largestFreeRange = std::max(stats.largestFreeRange, size);
+        }
+    }
+    freeBytes = stats.reservedBytes - stats.usedBytes;
+
+    stats.occupancy = stats.reservedBytes > 0 ? static_cast<double>(stats.usedBytes) / stats.reservedBytes : 0.0;
+    stats.fragmentation = freeBytes > 0 ? 1.0 - static_cast<double>(stats.largestFreeRange) / freeBytes : 0.0;
+    return stats;
+}
+
+void vk::GeometryArena::printStats() {
+    auto current = stats();
+
+    std::unique_lock<std::mutex> lck(mutex_);
+    if (reservedHighWater_ == 0) return;
+
+    geometryArenaCout() << current.allocationCount << " allocations in " << current.blockCount << " blocks, "
+                        << current.usedBytes / 1024 / 1024 << " / " << current.reservedBytes / 1024 / 1024
+                        << " MiB used, peak " << reservedHighWater_ / 1024 / 1024 << " MiB, fragmentation "
+                        << current.fragmentation << std::endl;
+    geometryArenaCout() << "relocated " << relocatedBytes_ / 1024 << " KiB, released " << releasedBlocks_
+                        << " blocks" << std::endl;
+}
+
+vk::GeometryStaging::GeometryStaging(std::shared_ptr<VMA> vma, std::shared_ptr<Device> device, VkDeviceSize size)
+    : buffer_(HostVisibleBuffer::create(vma, device, std::max<VkDeviceSize>(size, 1),
+                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT)) {}
+
+void vk::GeometryStaging::write(std::shared_ptr<GeometryAllocation> dst, void *src) {
+    if (used_ + dst->size() > buffer_->size()) {
+        geometryArenaCerr() << "staging buffer overflow" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (dst->size() > 0) buffer_->uploadToBuffer(src, dst->size(), used_);
+    writes_.emplace_back(dst, used_);
+    used_ += dst->size();
+}
+
+void vk::GeometryStaging::uploadToBuffer(std::shared_ptr<CommandBuffer> cmdBuffer) {
+    // one copy command per destination block
+    std::map<VkBuffer, std::vector<VkBufferCopy>> regions;
+    for (auto &[dst, srcOffset] : writes_) {
+        if (dst->size() == 0) continue;
+        regions[dst->vkBuffer()].push_back(VkBufferCopy{
+            .srcOffset = srcOffset,
+            .dstOffset = dst->offset(),
+            .size = dst->size(),
+        });
+    }
+
+    for (auto &[dstBuffer, bufferRegions] : regions) {
+        vkCmdCopyBuffer(cmdBuffer->vkCommandBuffer(), buffer_->vkBuffer(), dstBuffer,
+                        static_cast<uint32_t>(bufferRegions.size()), bufferRegions.data());
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace vk {
+class VMA;
+class Device;
+class CommandBuffer;
+class DeviceLocalBuffer;
+class HostVisibleBuffer;
+class GeometryArena;
+
+// A range of one arena block. It goes back to the free list when the last reference is dropped, so it has to be kept
+// alive (e.g. through the gc) until the GPU no longer reads it.
+class GeometryAllocation : public SharedObject<GeometryAllocation> {
+  public:
+    GeometryAllocation(std::shared_ptr<GeometryArena> arena,
+                       std::shared_ptr<DeviceLocalBuffer> blockBuffer,
+                       uint32_t block,
+                       VkDeviceSize offset,
+                       VkDeviceSize size);
+    ~GeometryAllocation();
+
+    uint32_t block();
+    VkDeviceSize offset();
+    VkDeviceSize size();
+    VkBuffer &vkBuffer();
+    VkDeviceAddress bufferAddress();
+
+  private:
+    std::shared_ptr<GeometryArena> arena_;
+    std::shared_ptr<DeviceLocalBuffer> blockBuffer_;
+
+    uint32_t block_;
+    VkDeviceSize offset_;
+    VkDeviceSize size_;
+    VkDeviceAddress bufferAddress_;
+};
+
+struct GeometryArenaStats {
+    uint32_t blockCount;
+    uint32_t allocationCount;
+    uint32_t freeRangeCount;
+    VkDeviceSize reservedBytes;
+    VkDeviceSize usedBytes;
+    VkDeviceSize largestFreeRange;
+    double occupancy;     // used / reserved
+    double fragmentation; // 1 - largest free range / free bytes
+};
+
+// Suballocates vertex, index and acceleration structure input ranges from a few large device local blocks with a first
+// fit free list, so the number of VMA allocations stays flat no matter how many chunks are loaded. Sparse blocks can be
+// drained by relocating their ranges into the others, after which the block is released.
+class GeometryArena : public SharedObject<GeometryArena> {
+  public:
+    static constexpr uint32_t invalidBlock = UINT32_MAX;
+    static constexpr VkDeviceSize blockSize = 64 * 1024 * 1024;
+    // covers storage buffer offsets and acceleration structure inputs on every known device
+    static constexpr VkDeviceSize alignment = 256;
+
+    GeometryArena(std::shared_ptr<VMA> vma, std::shared_ptr<Device> device);
+
+    // thread safe, sizes above blockSize get a dedicated block
+    std::shared_ptr<GeometryAllocation> allocate(VkDeviceSize size);
+
+    // picks the emptiest block once its live bytes fit into the free space of the others, nothing new is placed into
+    // it afterwards, returns invalidBlock when no block is worth draining
+    uint32_t beginDrain();
+    void cancelDrain();
+    // records a copy of src into a block other than the drained one, nullptr when they are full
+    std::shared_ptr<GeometryAllocation> relocate(std::shared_ptr<CommandBuffer> commandBuffer,
+                                                 std::shared_ptr<GeometryAllocation> src);
+
+    GeometryArenaStats stats();
+    void printStats();
+
+  private:
+    friend class GeometryAllocation;
+
+    // a block is drained once less than this share of it is in use
+    static constexpr double drainOccupancy = 0.5;
+
+    struct Block {
+        std::shared_ptr<DeviceLocalBuffer> buffer; // nullptr once released, the slot is reused
+        std::map<VkDeviceSize, VkDeviceSize> freeRanges; // offset -> size
+        VkDeviceSize size = 0;
+        VkDeviceSize usedBytes = 0;
+        uint32_t allocationCount = 0;
+    };
+
+    static VkDeviceSize alignUp(VkDeviceSize size);
+
+    std::shared_ptr<GeometryAllocation> allocateLocked(VkDeviceSize size, bool allowNewBlock);
+    bool tryAllocate(Block &block, VkDeviceSize alignedSize, VkDeviceSize &offset);
+    uint32_t createBlock(VkDeviceSize size);
+    void free(uint32_t block, VkDeviceSize offset, VkDeviceSize size);
+    uint32_t liveBlockCount();
+
+  private:
+    std::shared_ptr<VMA> vma_;
+    std::shared_ptr<Device> device_;
+
+    std::vector<Block> blocks_;
+    uint32_t drainingBlock_ = invalidBlock;
+
+    uint64_t relocatedBytes_ = 0;
+    uint32_t releasedBlocks_ = 0;
+    VkDeviceSize reservedHighWater_ = 0;
+    std::mutex mutex_;
+};
+
+// One host visible buffer holding the initial contents of several allocations, so a chunk build needs a single staging
+// allocation instead of one per stream.
+class GeometryStaging : public SharedObject<GeometryStaging> {
+  public:
+    GeometryStaging(std::shared_ptr<VMA> vma, std::shared_ptr<Device> device, VkDeviceSize size);
+
+    // copies dst->size() bytes from src
+    void write(std::shared_ptr<GeometryAllocation> dst, void *src);
+    void uploadToBuffer(std::shared_ptr<CommandBuffer> cmdBuffer);
+
+  private:
+    std::shared_ptr<HostVisibleBuffer> buffer_;
+    VkDeviceSize used_ = 0;
+    std::vector<std::pair<std::shared_ptr<GeometryAllocation>, VkDeviceSize>> writes_;
+};
+}; // namespace vk
@@ -118,12 +118,18 @@ vk::PhysicalDevice::PhysicalDevice(std::shared_ptr<Instance> instance, std::shar
     rayTracingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR;
     rayTracingProperties.pNext = &accelStructProperties;
 
+    VkPhysicalDeviceIDProperties idProperties{};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    idProperties.pNext = &rayTracingProperties;
+
     VkPhysicalDeviceProperties2 deviceProps2{};
     deviceProps2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
-    deviceProps2.pNext = &rayTracingProperties;
+    deviceProps2.pNext = &idProperties;
     vkGetPhysicalDeviceProperties2(physicalDevice_, &deviceProps2);
 
     properties_ = deviceProps2.properties;
+    idProperties_ = idProperties;
+    idProperties_.pNext = nullptr;
     rayTracingProperties_ = rayTracingProperties;
     accelerationStructProperties_ = accelStructProperties;
 }
@@ -231,6 +237,10 @@ VkPhysicalDeviceProperties vk::PhysicalDevice::properties() {
     return properties_;
 }
 
+VkPhysicalDeviceIDProperties vk::PhysicalDevice::idProperties() {
+    return idProperties_;
+}
+
 VkPhysicalDeviceRayTracingPipelinePropertiesKHR vk::PhysicalDevice::rayTracingProperties() {
     return rayTracingProperties_;
 }
@@ -238,3 +248,19 @@ VkPhysicalDeviceRayTracingPipelinePropertiesKHR vk::PhysicalDevice::rayTracingPr
 VkPhysicalDeviceAccelerationStructurePropertiesKHR vk::PhysicalDevice::accelerationStructProperties() {
     return accelerationStructProperties_;
 }
+
+bool vk::PhysicalDevice::supportsAccelerationStructureVertexFormat(VkFormat format) {
+    VkFormatProperties formatProperties{};
+    vkGetPhysicalDeviceFormatProperties(physicalDevice_, format, &formatProperties);
+    return (formatProperties.bufferFeatures & VK_FORMAT_FEATURE_ACCELERATION_STRUCTURE_VERTEX_BUFFER_BIT_KHR) != 0;
+}
+
+uint32_t vk::PhysicalDevice::timestampValidBits(uint32_t queueFamilyIndex) {
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice_, &queueFamilyCount, nullptr);
+    if (queueFamilyIndex >= queueFamilyCount) return 0;
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice_, &queueFamilyCount, queueFamilies.data());
+    return queueFamilies[queueFamilyIndex].timestampValidBits;
+}
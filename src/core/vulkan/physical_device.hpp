@@ -19,8 +19,11 @@ class PhysicalDevice : public SharedObject<PhysicalDevice> {
     void findQueueFamilies();
 
     VkPhysicalDeviceProperties properties();
+    VkPhysicalDeviceIDProperties idProperties();
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR rayTracingProperties();
     VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructProperties();
+    bool supportsAccelerationStructureVertexFormat(VkFormat format);
+    uint32_t timestampValidBits(uint32_t queueFamilyIndex);
 
   private:
     std::shared_ptr<Instance> instance_;
@@ -31,6 +34,7 @@ class PhysicalDevice : public SharedObject<PhysicalDevice> {
     uint32_t secondaryQueueIndex_ = -1;
 
     VkPhysicalDeviceProperties properties_;
+    VkPhysicalDeviceIDProperties idProperties_;
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR rayTracingProperties_;
     VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructProperties_;
 };
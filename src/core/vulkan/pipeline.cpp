@@ -2,6 +2,7 @@
 
 #include "core/vulkan/descriptor.hpp"
 #include "core/vulkan/device.hpp"
+#include "core/vulkan/pipeline_cache.hpp"
 #include "core/vulkan/render_pass.hpp"
 #include "core/vulkan/shader.hpp"
 
@@ -259,9 +260,12 @@ std::shared_ptr<vk::GraphicsPipeline> vk::GraphicsPipelineBuilder::build(std::sh
     pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineCreateInfo.basePipelineIndex = -1;
 
+    PipelineCreationFeedback feedback(pipelineCreateInfo.pNext);
+    pipelineCreateInfo.pNext = &feedback.createInfo;
+
     VkPipeline pipeline;
-    if (vkCreateGraphicsPipelines(device->vkDevice(), VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline) !=
-        VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(device->vkDevice(), device->vkPipelineCache(), 1, &pipelineCreateInfo, nullptr,
+                                  &pipeline) != VK_SUCCESS) {
         graphicsPipelineCerr() << "failed to create graphics pipeline" << std::endl;
         exit(EXIT_FAILURE);
     } else {
@@ -269,6 +273,7 @@ std::shared_ptr<vk::GraphicsPipeline> vk::GraphicsPipelineBuilder::build(std::sh
         graphicsPipelineCout() << "created graphics pipeline" << std::endl;
 #endif
     }
+    if (device->pipelineCache() != nullptr) device->pipelineCache()->recordCreation(feedback);
 
     return std::make_shared<GraphicsPipeline>(device, pipeline);
 }
@@ -344,12 +349,16 @@ std::shared_ptr<vk::RayTracingPipeline> vk::RayTracingPipelineBuilder::build(std
     pipelineInfo.layout = pipelineLayout_;
     pipelineInfo.maxPipelineRayRecursionDepth = 3;
 
+    PipelineCreationFeedback feedback(pipelineInfo.pNext);
+    pipelineInfo.pNext = &feedback.createInfo;
+
     VkPipeline rayTracingPipeline;
-    if (vkCreateRayTracingPipelinesKHR(device->vkDevice(), VK_NULL_HANDLE, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                                       &rayTracingPipeline) != VK_SUCCESS) {
+    if (vkCreateRayTracingPipelinesKHR(device->vkDevice(), VK_NULL_HANDLE, device->vkPipelineCache(), 1, &pipelineInfo,
+                                       nullptr, &rayTracingPipeline) != VK_SUCCESS) {
         std::cerr << "Cannot build ray tracing pipeline" << std::endl;
         exit(EXIT_FAILURE);
     }
+    if (device->pipelineCache() != nullptr) device->pipelineCache()->recordCreation(feedback);
 
     return RayTracingPipeline::create(device, rayTracingPipeline);
 }
@@ -374,12 +383,16 @@ std::shared_ptr<vk::ComputePipeline> vk::ComputePipelineBuilder::build(std::shar
     computePipelineCreateInfo.stage.pName = "main";
     computePipelineCreateInfo.layout = pipelineLayout_;
 
+    PipelineCreationFeedback feedback(computePipelineCreateInfo.pNext);
+    computePipelineCreateInfo.pNext = &feedback.createInfo;
+
     VkPipeline compPipeline;
-    if (vkCreateComputePipelines(device->vkDevice(), VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr,
+    if (vkCreateComputePipelines(device->vkDevice(), device->vkPipelineCache(), 1, &computePipelineCreateInfo, nullptr,
                                  &compPipeline) != VK_SUCCESS) {
         std::cerr << "Cannot build compute pipeline" << std::endl;
         exit(EXIT_FAILURE);
     }
+    if (device->pipelineCache() != nullptr) device->pipelineCache()->recordCreation(feedback);
 
     return ComputePipeline::create(device, compPipeline);
 }
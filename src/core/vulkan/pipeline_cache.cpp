@@ -0,0 +1,252 @@
+#include "core/vulkan/pipeline_cache.hpp"
+
+#include "core/vulkan/physical_device.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+std::ostream &pipelineCacheCout() {
+    return std::cout << "[PipelineCache] ";
+}
+
+std::ostream &pipelineCacheCerr() {
+    return std::cerr << "[PipelineCache] ";
+}
+
+namespace {
+// prefix written in front of the driver blob, catches truncated files and driver updates. driverVersion alone does
+// not change with every driver build, driverUUID does
+struct PipelineCacheFilePrefix {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t driverVersion;
+    uint32_t reserved;
+    uint8_t driverUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t dataHash;
+};
+
+constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x4350434d; // "MCPC"
+constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+uint64_t fnv1a(const char *data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+} // namespace
+
+vk::PipelineCreationFeedback::PipelineCreationFeedback(const void *pNext) {
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+    createInfo.pNext = pNext;
+    createInfo.pPipelineCreationFeedback = &pipelineFeedback;
+    createInfo.pipelineStageCreationFeedbackCount = 0;
+    createInfo.pPipelineStageCreationFeedbacks = nullptr;
+}
+
+vk::PipelineCache::PipelineCache(VkDevice device,
+                                 std::shared_ptr<PhysicalDevice> physicalDevice,
+                                 std::filesystem::path cacheFile)
+    : device_(device),
+      properties_(physicalDevice->properties()),
+      idProperties_(physicalDevice->idProperties()),
+      cacheFile_(cacheFile) {
+    std::vector<char> initialData;
+
+    std::error_code ec;
+    if (!cacheFile_.empty() && std::filesystem::exists(cacheFile_, ec)) {
+        std::ifstream file(cacheFile_, std::ios::binary | std::ios::ate);
+        if (file.is_open()) {
+            std::streamsize size = file.tellg();
+            file.seekg(0, std::ios::beg);
+
+            std::vector<char> fileData(size > 0 ? static_cast<size_t>(size) : 0);
+            if (size > 0 && file.read(fileData.data(), size)) {
+                if (validateHeader(fileData)) {
+                    initialData.assign(fileData.begin() + sizeof(PipelineCacheFilePrefix), fileData.end());
+                }
+            }
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    VkResult result = vkCreatePipelineCache(device_, &createInfo, nullptr, &pipelineCache_);
+    if (result != VK_SUCCESS && !initialData.empty()) {
+        pipelineCacheCerr() << "driver rejected cached data, starting with an empty cache" << std::endl;
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(device_, &createInfo, nullptr, &pipelineCache_);
+    }
+    if (result != VK_SUCCESS) {
+        pipelineCacheCerr() << "failed to create pipeline cache" << std::endl;
+        pipelineCache_ = VK_NULL_HANDLE;
+        return;
+    }
+
+#ifdef DEBUG
+    pipelineCacheCout() << "created pipeline cache with " << initialData.size() << " bytes of initial data from "
+                        << cacheFile_.string() << std::endl;
+#endif
+}
+
+vk::PipelineCache::~PipelineCache() {
+    if (pipelineCache_ != VK_NULL_HANDLE) {
+        vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
+        pipelineCache_ = VK_NULL_HANDLE;
+    }
+
+#ifdef DEBUG
+    pipelineCacheCout() << "pipeline cache deconstructed" << std::endl;
+#endif
+}
+
+VkPipelineCache &vk::PipelineCache::vkPipelineCache() {
+    return pipelineCache_;
+}
+
+bool vk::PipelineCache::validateHeader(const std::vector<char> &data) {
+    if (data.size() < sizeof(PipelineCacheFilePrefix) + sizeof(VkPipelineCacheHeaderVersionOne)) {
+        pipelineCacheCerr() << "cache file too small, ignoring" << std::endl;
+        return false;
+    }
+
+    PipelineCacheFilePrefix prefix;
+    std::memcpy(&prefix, data.data(), sizeof(prefix));
+    if (prefix.magic != PIPELINE_CACHE_MAGIC || prefix.version != PIPELINE_CACHE_VERSION) {
+        pipelineCacheCerr() << "unknown cache file format, ignoring" << std::endl;
+        return false;
+    }
+    if (prefix.dataSize != data.size() - sizeof(PipelineCacheFilePrefix)) {
+        pipelineCacheCerr() << "cache file truncated, ignoring" << std::endl;
+        return false;
+    }
+    if (prefix.driverVersion != properties_.driverVersion ||
+        std::memcmp(prefix.driverUUID, idProperties_.driverUUID, VK_UUID_SIZE) != 0) {
+        pipelineCacheCout() << "driver version changed, discarding cache" << std::endl;
+        return false;
+    }
+
+    const char *blob = data.data() + sizeof(PipelineCacheFilePrefix);
+    if (prefix.dataHash != fnv1a(blob, prefix.dataSize)) {
+        pipelineCacheCerr() << "cache file checksum mismatch, ignoring" << std::endl;
+        return false;
+    }
+
+    VkPipelineCacheHeaderVersionOne header;
+    std::memcpy(&header, blob, sizeof(header));
+    if (header.headerSize < sizeof(VkPipelineCacheHeaderVersionOne) ||
+        header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+        pipelineCacheCerr() << "unsupported pipeline cache header, ignoring" << std::endl;
+        return false;
+    }
+    if (header.vendorID != properties_.vendorID || header.deviceID != properties_.deviceID ||
+        std::memcmp(header.pipelineCacheUUID, properties_.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        pipelineCacheCout() << "cache was created on a different device, discarding" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void vk::PipelineCache::recordCreation(const PipelineCreationFeedback &feedback) {
+    const VkPipelineCreationFeedback &pipelineFeedback = feedback.pipelineFeedback;
+    if (!(pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT)) {
+        unknownCount_++;
+        return;
+    }
+
+    if (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) {
+        hitCount_++;
+    } else {
+        missCount_++;
+    }
+    totalCreationNs_ += pipelineFeedback.duration;
+}
+
+void vk::PipelineCache::save() {
+    if (pipelineCache_ == VK_NULL_HANDLE || cacheFile_.empty()) return;
+
+    std::unique_lock<std::mutex> lck(saveMutex_);
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        pipelineCacheCerr() << "failed to query pipeline cache size" << std::endl;
+        return;
+    }
+
+    std::vector<char> data(sizeof(PipelineCacheFilePrefix) + dataSize);
+    char *blob = data.data() + sizeof(PipelineCacheFilePrefix);
+    if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, blob) != VK_SUCCESS) {
+        pipelineCacheCerr() << "failed to read pipeline cache data" << std::endl;
+        return;
+    }
+    data.resize(sizeof(PipelineCacheFilePrefix) + dataSize);
+
+    PipelineCacheFilePrefix prefix{};
+    prefix.magic = PIPELINE_CACHE_MAGIC;
+    prefix.version = PIPELINE_CACHE_VERSION;
+    prefix.driverVersion = properties_.driverVersion;
+    std::memcpy(prefix.driverUUID, idProperties_.driverUUID, VK_UUID_SIZE);
+    prefix.dataSize = dataSize;
+    prefix.dataHash = fnv1a(blob, dataSize);
+    std::memcpy(data.data(), &prefix, sizeof(prefix));
+
+    std::error_code ec;
+    std::filesystem::create_directories(cacheFile_.parent_path(), ec);
+    if (ec) {
+        pipelineCacheCerr() << "failed to create cache directory: " << ec.message() << std::endl;
+        return;
+    }
+
+    // write to a temporary file first so that a crash never leaves a half written cache behind
+    std::filesystem::path tempFile = cacheFile_;
+    tempFile += ".tmp";
+    {
+        std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(data.data(), data.size())) {
+            pipelineCacheCerr() << "failed to write " << tempFile.string() << std::endl;
+            return;
+        }
+    }
+    std::filesystem::rename(tempFile, cacheFile_, ec);
+    if (ec) {
+        pipelineCacheCerr() << "failed to replace " << cacheFile_.string() << ": " << ec.message() << std::endl;
+        std::filesystem::remove(tempFile, ec);
+        return;
+    }
+
+#ifdef DEBUG
+    pipelineCacheCout() << "saved " << dataSize << " bytes to " << cacheFile_.string() << std::endl;
+#endif
+}
+
+void vk::PipelineCache::printStats() {
+    pipelineCacheCout() << "pipelines created: " << hitCount_ + missCount_ + unknownCount_ << " (hit: " << hitCount_
+                        << ", miss: " << missCount_ << ", unknown: " << unknownCount_
+                        << "), creation time: " << totalCreationNs_ / 1000000.0 << " ms" << std::endl;
+}
+
+uint32_t vk::PipelineCache::hitCount() const {
+    return hitCount_;
+}
+
+uint32_t vk::PipelineCache::missCount() const {
+    return missCount_;
+}
+
+uint32_t vk::PipelineCache::unknownCount() const {
+    return unknownCount_;
+}
+
+uint64_t vk::PipelineCache::totalCreationNs() const {
+    return totalCreationNs_;
+}
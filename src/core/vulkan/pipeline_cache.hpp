@@ -0,0 +1,55 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+
+namespace vk {
+class PhysicalDevice;
+
+// Creation feedback chained into a pipeline create info so that the cache can tell hits from misses.
+struct PipelineCreationFeedback {
+    VkPipelineCreationFeedback pipelineFeedback{};
+    VkPipelineCreationFeedbackCreateInfo createInfo{};
+
+    PipelineCreationFeedback(const void *pNext = nullptr);
+    PipelineCreationFeedback(const PipelineCreationFeedback &) = delete;
+    PipelineCreationFeedback &operator=(const PipelineCreationFeedback &) = delete;
+};
+
+class PipelineCache : public SharedObject<PipelineCache> {
+  public:
+    PipelineCache(VkDevice device, std::shared_ptr<PhysicalDevice> physicalDevice, std::filesystem::path cacheFile);
+    ~PipelineCache();
+
+    VkPipelineCache &vkPipelineCache();
+
+    void recordCreation(const PipelineCreationFeedback &feedback);
+    void save();
+    void printStats();
+
+    uint32_t hitCount() const;
+    uint32_t missCount() const;
+    uint32_t unknownCount() const;
+    uint64_t totalCreationNs() const;
+
+  private:
+    bool validateHeader(const std::vector<char> &data);
+
+  private:
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties_{};
+    VkPhysicalDeviceIDProperties idProperties_{};
+    std::filesystem::path cacheFile_;
+
+    VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+    std::mutex saveMutex_;
+
+    std::atomic<uint32_t> hitCount_ = 0;
+    std::atomic<uint32_t> missCount_ = 0;
+    std::atomic<uint32_t> unknownCount_ = 0;
+    std::atomic<uint64_t> totalCreationNs_ = 0;
+};
+}; // namespace vk
@@ -0,0 +1,88 @@
+#include "core/vulkan/quad_index_buffer.hpp"
+
+#include "core/vulkan/buffer.hpp"
+#include "core/vulkan/command.hpp"
+#include "core/vulkan/device.hpp"
+#include "core/vulkan/vma.hpp"
+
+namespace {
+template <typename T>
+void writeQuadIndices(void *dst, uint32_t quadCount) {
+    T *indices = static_cast<T *>(dst);
+    for (uint32_t i = 0; i < quadCount; i++) {
+        T base = static_cast<T>(i * 4);
+        indices[i * 6 + 0] = base + 0;
+        indices[i * 6 + 1] = base + 1;
+        indices[i * 6 + 2] = base + 2;
+        indices[i * 6 + 3] = base + 2;
+        indices[i * 6 + 4] = base + 3;
+        indices[i * 6 + 5] = base + 0;
+    }
+}
+} // namespace
+
+vk::QuadIndexBuffer::QuadIndexBuffer(std::shared_ptr<VMA> vma,
+                                     std::shared_ptr<Device> device,
+                                     VkIndexType indexType,
+                                     uint32_t quadCount)
+    : indexType_(indexType), quadCount_(quadCount) {
+    VkDeviceSize size = static_cast<VkDeviceSize>(quadCount) * 6 *
+                        (indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
+
+    buffer_ = DeviceLocalBuffer::create(vma, device, false, size,
+                                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+                                            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR);
+    staging_ = HostVisibleBuffer::create(vma, device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+    if (indexType == VK_INDEX_TYPE_UINT16) {
+        writeQuadIndices<uint16_t>(staging_->mappedPtr(), quadCount);
+    } else {
+        writeQuadIndices<uint32_t>(staging_->mappedPtr(), quadCount);
+    }
+    staging_->flush();
+}
+
+uint32_t vk::QuadIndexBuffer::indexCount(size_t vertexCount) {
+    return static_cast<uint32_t>(vertexCount / 4 * 6);
+}
+
+std::vector<uint32_t> vk::QuadIndexBuffer::buildIndices(size_t vertexCount) {
+    std::vector<uint32_t> indices(indexCount(vertexCount));
+    writeQuadIndices<uint32_t>(indices.data(), static_cast<uint32_t>(vertexCount / 4));
+    return indices;
+}
+
+std::shared_ptr<vk::HostVisibleBuffer> vk::QuadIndexBuffer::uploadToBuffer(std::shared_ptr<CommandBuffer> cmdBuffer) {
+    auto staging = staging_;
+    if (staging == nullptr) return nullptr;
+
+    VkBufferCopy region{
+        .srcOffset = 0,
+        .dstOffset = 0,
+        .size = staging->size(),
+    };
+    vkCmdCopyBuffer(cmdBuffer->vkCommandBuffer(), staging->vkBuffer(), buffer_->vkBuffer(), 1, &region);
+    staging_ = nullptr;
+    return staging;
+}
+
+bool vk::QuadIndexBuffer::uploaded() {
+    return staging_ == nullptr;
+}
+
+uint32_t vk::QuadIndexBuffer::quadCount() {
+    return quadCount_;
+}
+
+VkIndexType vk::QuadIndexBuffer::indexType() {
+    return indexType_;
+}
+
+std::shared_ptr<vk::DeviceLocalBuffer> vk::QuadIndexBuffer::buffer() {
+    return buffer_;
+}
+
+VkDeviceAddress vk::QuadIndexBuffer::bufferAddress() {
+    return buffer_->bufferAddress();
+}
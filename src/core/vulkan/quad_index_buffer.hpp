@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+
+#include <vector>
+
+namespace vk {
+class VMA;
+class Device;
+class CommandBuffer;
+class DeviceLocalBuffer;
+class HostVisibleBuffer;
+
+// The 0,1,2,2,3,0 pattern for quadCount quads, referenced by every quad based geometry instead of each of them
+// generating and uploading its own copy. A geometry of n vertices uses the first indexCount(n) indices. The contents
+// never change, a larger pattern is a new buffer and geometry keeps the one it was built against alive.
+class QuadIndexBuffer : public SharedObject<QuadIndexBuffer> {
+  public:
+    QuadIndexBuffer(std::shared_ptr<VMA> vma,
+                    std::shared_ptr<Device> device,
+                    VkIndexType indexType,
+                    uint32_t quadCount);
+
+    // trailing vertices that do not form a whole quad are dropped
+    static uint32_t indexCount(size_t vertexCount);
+    static std::vector<uint32_t> buildIndices(size_t vertexCount);
+
+    // records the copy out of the staging buffer, which is returned and has to outlive the copy
+    std::shared_ptr<HostVisibleBuffer> uploadToBuffer(std::shared_ptr<CommandBuffer> cmdBuffer);
+    bool uploaded();
+
+    uint32_t quadCount();
+    VkIndexType indexType();
+    std::shared_ptr<DeviceLocalBuffer> buffer();
+    VkDeviceAddress bufferAddress();
+
+  private:
+    VkIndexType indexType_;
+    uint32_t quadCount_;
+    std::shared_ptr<DeviceLocalBuffer> buffer_;
+    std::shared_ptr<HostVisibleBuffer> staging_;
+};
+}; // namespace vk
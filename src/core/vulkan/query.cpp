@@ -0,0 +1,42 @@
+#include "core/vulkan/query.hpp"
+
+#include "core/vulkan/device.hpp"
+
+#include <iostream>
+
+vk::QueryPool::QueryPool(std::shared_ptr<Device> device, VkQueryType queryType, uint32_t queryCount)
+    : device_(device), queryType_(queryType), queryCount_(queryCount) {
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = queryType;
+    queryPoolInfo.queryCount = queryCount;
+
+    if (vkCreateQueryPool(device_->vkDevice(), &queryPoolInfo, nullptr, &queryPool_) != VK_SUCCESS) {
+        std::cerr << "[QueryPool] failed to create query pool" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+vk::QueryPool::~QueryPool() {
+    vkDestroyQueryPool(device_->vkDevice(), queryPool_, nullptr);
+}
+
+bool vk::QueryPool::results(uint32_t firstQuery, uint32_t queryCount, std::vector<uint64_t> &results) {
+    results.resize(queryCount);
+    VkResult result = vkGetQueryPoolResults(device_->vkDevice(), queryPool_, firstQuery, queryCount,
+                                            queryCount * sizeof(uint64_t), results.data(), sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT);
+    return result == VK_SUCCESS;
+}
+
+VkQueryPool &vk::QueryPool::vkQueryPool() {
+    return queryPool_;
+}
+
+VkQueryType vk::QueryPool::queryType() {
+    return queryType_;
+}
+
+uint32_t vk::QueryPool::queryCount() {
+    return queryCount_;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core/all_extern.hpp"
+
+#include <vector>
+
+namespace vk {
+class Device;
+
+class QueryPool : public SharedObject<QueryPool> {
+  public:
+    QueryPool(std::shared_ptr<Device> device, VkQueryType queryType, uint32_t queryCount);
+    ~QueryPool();
+
+    // returns false while any of the requested queries is not available yet
+    bool results(uint32_t firstQuery, uint32_t queryCount, std::vector<uint64_t> &results);
+
+    VkQueryPool &vkQueryPool();
+    VkQueryType queryType();
+    uint32_t queryCount();
+
+  private:
+    std::shared_ptr<Device> device_;
+
+    VkQueryPool queryPool_ = VK_NULL_HANDLE;
+    VkQueryType queryType_;
+    uint32_t queryCount_;
+};
+}; // namespace vk
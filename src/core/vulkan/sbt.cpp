@@ -1,11 +1,14 @@
 #include "core/vulkan/sbt.hpp"
 
 #include "core/vulkan/buffer.hpp"
+#include "core/vulkan/command.hpp"
 #include "core/vulkan/device.hpp"
 #include "core/vulkan/physical_device.hpp"
 #include "core/vulkan/pipeline.hpp"
 #include "core/vulkan/vma.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <cstring>
 #include <vector>
 
@@ -62,36 +65,61 @@ vk::SBT::SBT(std::shared_ptr<PhysicalDevice> physicalDevice,
 
 vk::SBT::~SBT() {}
 
-void vk::SBT::setupHitSBT(std::vector<uint32_t> &hitGroupIndices) {
-    VkDeviceSize rhitSBTSize = hitGroupIndices.size() * alignedHandleSize_;
-    if (rhitSBTSize == 0) {
+void vk::SBT::setupHitSBT(std::shared_ptr<CommandBuffer> cmdBuffer, std::vector<uint32_t> &hitGroupIndices) {
+    uint32_t recordCount = hitGroupIndices.size();
+    if (recordCount == 0) {
         std::cerr << "Hit group should contains something!" << std::endl;
         exit(1);
     }
 
-    std::vector<uint8_t> cachedRhitSBT(rhitSBTSize, 0);
-    for (uint32_t i = 0; i < hitGroupIndices.size(); ++i) {
-        uint32_t hit_group_id = hitGroupIndices[i];
+    // grow geometrically, a new table has to be written as a whole
+    if (rhitSBT_ == nullptr || recordCount > rhitCapacity_) {
+        rhitCapacity_ = std::max(std::bit_ceil(recordCount), 256u);
+        rhitSBT_ = DeviceLocalBuffer::create(
+            vma_, device_, true, rhitCapacity_ * alignedHandleSize_,
+            VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 0,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, baseAlignment_);
+        hitGroupIndices_.clear();
+    }
+
+    // runs of records whose hit group differs from what the table holds
+    std::vector<std::pair<uint32_t, uint32_t>> dirtyRanges;
+    for (uint32_t i = 0; i < recordCount; ++i) {
+        if (i < hitGroupIndices_.size() && hitGroupIndices_[i] == hitGroupIndices[i]) { continue; }
+
+        if (!dirtyRanges.empty() && dirtyRanges.back().second == i) {
+            dirtyRanges.back().second++;
+        } else {
+            dirtyRanges.emplace_back(i, i + 1);
+        }
 
         // Access source storage using handleSize_ (tightly packed)
-        uint32_t palette_offset = (1 + missCount_ + hit_group_id) * handleSize_;
+        uint32_t palette_offset = (1 + missCount_ + hitGroupIndices[i]) * handleSize_;
         uint8_t *pSourceHandle = shaderHandleStorage_.data() + palette_offset;
 
-        // Write to destination SBT using alignedHandleSize_ (stride requirement)
-        uint8_t *pDest = cachedRhitSBT.data() + i * alignedHandleSize_;
+        // Write to the staging copy using alignedHandleSize_ (stride requirement)
+        uint8_t *pDest = static_cast<uint8_t *>(rhitSBT_->mappedPtr()) + i * alignedHandleSize_;
         memcpy(pDest, pSourceHandle, handleSize_);
     }
-
-    rhitSBT_ = HostVisibleBuffer::create(
-        vma_, device_, rhitSBTSize,
-        VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, baseAlignment_);
-
-    rhitSBT_->uploadToBuffer(cachedRhitSBT.data());
-    rhitSBT_->flush();
+    hitGroupIndices_ = hitGroupIndices;
 
     hitRegion_.deviceAddress = rhitSBT_->bufferAddress();
     hitRegion_.stride = alignedHandleSize_;
-    hitRegion_.size = rhitSBTSize;
+    hitRegion_.size = recordCount * alignedHandleSize_;
+
+    if (dirtyRanges.empty()) { return; }
+
+    rhitSBT_->flushStagingBuffer();
+    for (auto [begin, end] : dirtyRanges) {
+        rhitSBT_->uploadToBuffer(cmdBuffer, (end - begin) * alignedHandleSize_, begin * alignedHandleSize_,
+                                 begin * alignedHandleSize_);
+    }
+    cmdBuffer->barriersMemory({CommandBuffer::MemoryBarrier{
+        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+        .dstAccessMask = VK_ACCESS_2_SHADER_BINDING_TABLE_READ_BIT_KHR,
+    }});
 }
 
 VkStridedDeviceAddressRegionKHR &vk::SBT::raygenRegion() {
@@ -6,6 +6,8 @@
 
 namespace vk {
 class HostVisibleBuffer;
+class DeviceLocalBuffer;
+class CommandBuffer;
 class PhysicalDevice;
 class Device;
 class VMA;
@@ -21,7 +23,9 @@ class SBT : public SharedObject<SBT> {
         uint32_t hitCount);
     ~SBT();
 
-    void setupHitSBT(std::vector<uint32_t> &hitGroupIndices);
+    // The hit records persist between calls, only the records whose hit group changed are copied into the device
+    // local table, the copies are recorded into cmdBuffer. The previous frame using this SBT has to have finished.
+    void setupHitSBT(std::shared_ptr<CommandBuffer> cmdBuffer, std::vector<uint32_t> &hitGroupIndices);
 
     VkStridedDeviceAddressRegionKHR &raygenRegion();
     VkStridedDeviceAddressRegionKHR &missRegion();
@@ -46,6 +50,8 @@ class SBT : public SharedObject<SBT> {
 
     std::shared_ptr<HostVisibleBuffer> rgenSBT_;
     std::shared_ptr<HostVisibleBuffer> rmissSBT_;
-    std::shared_ptr<HostVisibleBuffer> rhitSBT_;
+    std::shared_ptr<DeviceLocalBuffer> rhitSBT_;
+    uint32_t rhitCapacity_ = 0;             // in records
+    std::vector<uint32_t> hitGroupIndices_; // what rhitSBT_ holds
 };
 }; // namespace vk
\ No newline at end of file
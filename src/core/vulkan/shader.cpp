@@ -2,12 +2,20 @@
 
 #include "core/vulkan/device.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <thread>
 #include <vector>
 
+#if __has_include(<glslang/build_info.h>)
+#    include <glslang/build_info.h>
+#endif
+
 std::ostream &shaderCout() {
     return std::cout << "[Shader] ";
 }
@@ -16,6 +24,282 @@ std::ostream &shaderCerr() {
     return std::cerr << "[Shader] ";
 }
 
+namespace {
+// two independent 64 bit hashes, used both for cache keys and entry checksums
+struct ShaderHasher {
+    uint64_t fnv = 0xcbf29ce484222325ull;
+    uint64_t mix = 0x9e3779b97f4a7c15ull;
+
+    void update(const void *data, size_t size) {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            fnv ^= bytes[i];
+            fnv *= 0x100000001b3ull;
+            mix = (mix ^ bytes[i]) * 0xff51afd7ed558ccdull;
+            mix ^= mix >> 29;
+        }
+    }
+
+    void update(const std::string &str) {
+        uint64_t size = str.size();
+        update(&size, sizeof(size));
+        update(str.data(), str.size());
+    }
+
+    template <typename T>
+    void updateValue(const T &value) {
+        update(&value, sizeof(T));
+    }
+};
+
+struct SpirvCacheEntryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t keyHi;
+    uint64_t keyLo;
+    uint64_t wordCount;
+    uint64_t checksum;
+};
+
+// bump whenever the key layout changes, the compile options and the compiler are part of the key
+constexpr uint32_t SPIRV_CACHE_MAGIC = 0x5643434d; // "MCCV"
+constexpr uint32_t SPIRV_CACHE_VERSION = 1;
+constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+constexpr shaderc_target_env SHADER_TARGET_ENV = shaderc_target_env_vulkan;
+constexpr shaderc_env_version SHADER_TARGET_ENV_VERSION = shaderc_env_version_vulkan_1_4;
+constexpr shaderc_source_language SHADER_SOURCE_LANGUAGE = shaderc_source_language_glsl;
+constexpr shaderc_optimization_level SHADER_OPTIMIZATION_LEVEL = shaderc_optimization_level_performance;
+
+void setCompileOptions(shaderc::CompileOptions &options) {
+    options.SetTargetEnvironment(SHADER_TARGET_ENV, SHADER_TARGET_ENV_VERSION);
+    options.SetSourceLanguage(SHADER_SOURCE_LANGUAGE);
+    options.SetOptimizationLevel(SHADER_OPTIMIZATION_LEVEL);
+}
+
+// shaderc has no version query of its own. The SPIR-V of a fixed shader carries the generator word of the front end
+// and changes with the optimizer passes, the glslang headers name the release the library was built from.
+const std::vector<uint32_t> &compilerProbe() {
+    static const std::vector<uint32_t> probe = [] {
+        constexpr const char *source = R"(#version 460
+layout(local_size_x = 64) in;
+layout(std430, binding = 0) buffer Values {
+    float values[];
+};
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    float sum = 0.0;
+    for (uint i = 0u; i < 4u; i++) sum += sin(values[index + i]) * float(i);
+    values[index] = sum;
+}
+)";
+        shaderc::Compiler compiler;
+        shaderc::CompileOptions options;
+        setCompileOptions(options);
+        shaderc::SpvCompilationResult result =
+            compiler.CompileGlslToSpv(source, shaderc_glsl_compute_shader, "spirv_cache_probe.comp", options);
+        if (result.GetCompilationStatus() != shaderc_compilation_status_success) return std::vector<uint32_t>{};
+        return std::vector<uint32_t>(result.cbegin(), result.cend());
+    }();
+    return probe;
+}
+
+void hashCompiler(ShaderHasher &hasher) {
+    unsigned int spvVersion = 0, spvRevision = 0;
+    shaderc_get_spv_version(&spvVersion, &spvRevision);
+    hasher.updateValue(spvVersion);
+    hasher.updateValue(spvRevision);
+#ifdef GLSLANG_VERSION_MAJOR
+    hasher.updateValue(GLSLANG_VERSION_MAJOR);
+    hasher.updateValue(GLSLANG_VERSION_MINOR);
+    hasher.updateValue(GLSLANG_VERSION_PATCH);
+    hasher.update(std::string(GLSLANG_VERSION_FLAVOR));
+#endif
+    const auto &probe = compilerProbe();
+    hasher.update(probe.data(), probe.size() * sizeof(uint32_t));
+
+    hasher.updateValue(SHADER_TARGET_ENV);
+    hasher.updateValue(SHADER_TARGET_ENV_VERSION);
+    hasher.updateValue(SHADER_SOURCE_LANGUAGE);
+    hasher.updateValue(SHADER_OPTIMIZATION_LEVEL);
+}
+} // namespace
+
+std::mutex vk::SpirvCache::mutex_;
+std::filesystem::path vk::SpirvCache::directory_{};
+uint64_t vk::SpirvCache::maxBytes_ = 0;
+std::atomic<uint32_t> vk::SpirvCache::hitCount_ = 0;
+std::atomic<uint32_t> vk::SpirvCache::missCount_ = 0;
+std::atomic<uint32_t> vk::SpirvCache::staleCount_ = 0;
+
+std::string vk::SpirvCache::Key::toString() const {
+    std::ostringstream oss;
+    oss << std::hex << std::setfill('0') << std::setw(16) << hi << std::setw(16) << lo;
+    return oss.str();
+}
+
+void vk::SpirvCache::configure(std::filesystem::path directory, uint64_t maxBytes) {
+    {
+        std::unique_lock<std::mutex> lck(mutex_);
+        directory_ = directory;
+        maxBytes_ = maxBytes;
+
+        std::error_code ec;
+        std::filesystem::create_directories(directory_, ec);
+        if (ec) {
+            shaderCerr() << "cannot create spirv cache directory " << directory_.string() << ": " << ec.message()
+                         << std::endl;
+            directory_.clear();
+            return;
+        }
+    }
+    evict();
+}
+
+bool vk::SpirvCache::enabled() {
+    std::unique_lock<std::mutex> lck(mutex_);
+    return !directory_.empty();
+}
+
+std::filesystem::path vk::SpirvCache::entryPath(const Key &key) {
+    return directory_ / (key.toString() + ".spv");
+}
+
+bool vk::SpirvCache::load(const Key &key, std::vector<uint32_t> &spirv) {
+    std::filesystem::path path;
+    {
+        std::unique_lock<std::mutex> lck(mutex_);
+        if (directory_.empty()) return false;
+        path = entryPath(key);
+    }
+
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        missCount_++;
+        return false;
+    }
+
+    bool valid = false;
+    {
+        std::ifstream file(path, std::ios::binary);
+        SpirvCacheEntryHeader header{};
+        if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) && header.magic == SPIRV_CACHE_MAGIC &&
+            header.version == SPIRV_CACHE_VERSION && header.keyHi == key.hi && header.keyLo == key.lo &&
+            header.wordCount > 0) {
+            spirv.resize(header.wordCount);
+            if (file.read(reinterpret_cast<char *>(spirv.data()), spirv.size() * sizeof(uint32_t))) {
+                ShaderHasher hasher;
+                hasher.update(spirv.data(), spirv.size() * sizeof(uint32_t));
+                valid = hasher.fnv == header.checksum && spirv[0] == SPIRV_MAGIC;
+            }
+        }
+    }
+
+    if (!valid) {
+        // stale or corrupted entry, drop it so the shader gets recompiled and stored again
+        shaderCerr() << "discarding invalid spirv cache entry " << path.filename().string() << std::endl;
+        std::filesystem::remove(path, ec);
+        spirv.clear();
+        staleCount_++;
+        missCount_++;
+        return false;
+    }
+
+    // refresh the timestamp so that eviction drops least recently used entries first
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    hitCount_++;
+    return true;
+}
+
+void vk::SpirvCache::store(const Key &key, const std::vector<uint32_t> &spirv) {
+    std::filesystem::path path;
+    {
+        std::unique_lock<std::mutex> lck(mutex_);
+        if (directory_.empty() || spirv.empty()) return;
+        path = entryPath(key);
+    }
+
+    SpirvCacheEntryHeader header{};
+    header.magic = SPIRV_CACHE_MAGIC;
+    header.version = SPIRV_CACHE_VERSION;
+    header.keyHi = key.hi;
+    header.keyLo = key.lo;
+    header.wordCount = spirv.size();
+    ShaderHasher hasher;
+    hasher.update(spirv.data(), spirv.size() * sizeof(uint32_t));
+    header.checksum = hasher.fnv;
+
+    // several threads may compile the same shader, each writes its own temporary file
+    std::ostringstream tempName;
+    tempName << key.toString() << "." << std::this_thread::get_id() << ".tmp";
+    std::filesystem::path tempPath = path.parent_path() / tempName.str();
+
+    std::error_code ec;
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+            !file.write(reinterpret_cast<const char *>(spirv.data()), spirv.size() * sizeof(uint32_t))) {
+            shaderCerr() << "failed to write spirv cache entry " << tempPath.string() << std::endl;
+            file.close();
+            std::filesystem::remove(tempPath, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) { std::filesystem::remove(tempPath, ec); }
+}
+
+void vk::SpirvCache::evict() {
+    std::unique_lock<std::mutex> lck(mutex_);
+    if (directory_.empty()) return;
+
+    struct Entry {
+        std::filesystem::path path;
+        uint64_t size;
+        std::filesystem::file_time_type time;
+    };
+    std::vector<Entry> entries;
+    uint64_t totalBytes = 0;
+
+    std::error_code ec;
+    for (const auto &dirEntry : std::filesystem::directory_iterator(directory_, ec)) {
+        if (!dirEntry.is_regular_file(ec)) continue;
+        const std::filesystem::path &path = dirEntry.path();
+        if (path.extension() == ".tmp") {
+            // left behind by a crashed writer
+            std::filesystem::remove(path, ec);
+            continue;
+        }
+        if (path.extension() != ".spv") continue;
+
+        Entry entry{path, dirEntry.file_size(ec), dirEntry.last_write_time(ec)};
+        totalBytes += entry.size;
+        entries.push_back(entry);
+    }
+
+    if (totalBytes <= maxBytes_) return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.time < b.time; });
+
+    uint32_t evicted = 0;
+    for (const Entry &entry : entries) {
+        if (totalBytes <= maxBytes_) break;
+        if (std::filesystem::remove(entry.path, ec)) {
+            totalBytes -= entry.size;
+            evicted++;
+        }
+    }
+
+#ifdef DEBUG
+    shaderCout() << "evicted " << evicted << " spirv cache entries, " << totalBytes << " bytes remain" << std::endl;
+#endif
+}
+
+void vk::SpirvCache::printStats() {
+    shaderCout() << "spirv cache hit: " << hitCount_ << ", miss: " << missCount_ << ", stale: " << staleCount_
+                 << std::endl;
+}
+
 shaderc_shader_kind vk::shaderKindFromStage(VkShaderStageFlagBits stage) {
     switch (stage) {
         case VK_SHADER_STAGE_VERTEX_BIT: return shaderc_glsl_vertex_shader;
@@ -37,8 +321,32 @@ struct vk::ShaderIncluder::IncludeData {
     std::string content;
 };
 
-vk::ShaderIncluder::ShaderIncluder(std::vector<std::filesystem::path> includeDirs)
-    : includeDirs_(std::move(includeDirs)) {}
+vk::ShaderIncluder::ShaderIncluder(std::vector<std::filesystem::path> includeDirs,
+                                   std::shared_ptr<std::map<std::string, uint64_t>> resolvedIncludes,
+                                   std::shared_ptr<ShaderFileSystem> fileSystem)
+    : includeDirs_(std::move(includeDirs)),
+      resolvedIncludes_(std::move(resolvedIncludes)),
+      fileSystem_(std::move(fileSystem)) {}
+
+bool vk::ShaderIncluder::tryRead(const std::filesystem::path &candidate,
+                                 std::filesystem::path &resolvedPath,
+                                 std::string &content) {
+    if (fileSystem_ != nullptr) {
+        std::filesystem::path normalized = candidate.lexically_normal();
+        if (!fileSystem_->readFile(normalized, content)) { return false; }
+        resolvedPath = normalized;
+        return true;
+    }
+
+    std::error_code ec;
+    if (!std::filesystem::exists(candidate, ec) || !std::filesystem::is_regular_file(candidate, ec)) { return false; }
+
+    std::ifstream includeFile(candidate, std::ios::binary);
+    if (!includeFile.is_open()) { return false; }
+    resolvedPath = std::filesystem::weakly_canonical(candidate);
+    content.assign(std::istreambuf_iterator<char>(includeFile), std::istreambuf_iterator<char>());
+    return true;
+}
 
 shaderc_include_result *vk::ShaderIncluder::GetInclude(const char *requested_source,
                                                        shaderc_include_type type,
@@ -47,26 +355,19 @@ shaderc_include_result *vk::ShaderIncluder::GetInclude(const char *requested_sou
     (void)include_depth;
     std::filesystem::path requestedPath(requested_source);
     std::filesystem::path resolvedPath;
+    IncludeData *includeData = new IncludeData{};
 
     if (type == shaderc_include_type_relative && requesting_source != nullptr && requesting_source[0] != '\0') {
         std::filesystem::path requestingPath(requesting_source);
-        std::filesystem::path candidate = requestingPath.parent_path() / requestedPath;
-        if (std::filesystem::exists(candidate) && std::filesystem::is_regular_file(candidate)) {
-            resolvedPath = std::filesystem::weakly_canonical(candidate);
-        }
+        tryRead(requestingPath.parent_path() / requestedPath, resolvedPath, includeData->content);
     }
 
     if (resolvedPath.empty()) {
         for (const std::filesystem::path &includeDir : includeDirs_) {
-            std::filesystem::path candidate = includeDir / requestedPath;
-            if (std::filesystem::exists(candidate) && std::filesystem::is_regular_file(candidate)) {
-                resolvedPath = std::filesystem::weakly_canonical(candidate);
-                break;
-            }
+            if (tryRead(includeDir / requestedPath, resolvedPath, includeData->content)) { break; }
         }
     }
 
-    IncludeData *includeData = new IncludeData{};
     if (resolvedPath.empty()) {
         includeData->content = "Failed to resolve include: " + std::string(requested_source);
         includeData->sourceName = requested_source;
@@ -78,20 +379,12 @@ shaderc_include_result *vk::ShaderIncluder::GetInclude(const char *requested_sou
         return &includeData->result;
     }
 
-    std::ifstream includeFile(resolvedPath, std::ios::binary);
-    if (!includeFile.is_open()) {
-        includeData->content = "Failed to open include: " + resolvedPath.string();
-        includeData->sourceName = resolvedPath.string();
-        includeData->result.source_name = includeData->sourceName.c_str();
-        includeData->result.source_name_length = includeData->sourceName.size();
-        includeData->result.content = includeData->content.c_str();
-        includeData->result.content_length = includeData->content.size();
-        includeData->result.user_data = includeData;
-        return &includeData->result;
-    }
-
     includeData->sourceName = resolvedPath.string();
-    includeData->content.assign(std::istreambuf_iterator<char>(includeFile), std::istreambuf_iterator<char>());
+    if (resolvedIncludes_ != nullptr) {
+        ShaderHasher hasher;
+        hasher.update(includeData->content);
+        (*resolvedIncludes_)[includeData->sourceName] = hasher.fnv;
+    }
     includeData->result.source_name = includeData->sourceName.c_str();
     includeData->result.source_name_length = includeData->sourceName.size();
     includeData->result.content = includeData->content.c_str();
@@ -135,14 +428,23 @@ vk::Shader::Shader(std::shared_ptr<Device> device,
                    std::string sourcePath,
                    VkShaderStageFlagBits stage,
                    std::unordered_map<std::string, std::string> definitions,
-                   std::vector<std::string> includeDirectories)
+                   std::vector<std::string> includeDirectories,
+                   std::shared_ptr<ShaderFileSystem> fileSystem)
     : device_(device), filePath_(sourcePath) {
-    std::ifstream sourceFile(sourcePath, std::ios::binary);
-    if (!sourceFile.is_open()) {
-        shaderCerr() << "Cannot open source file: " << sourcePath << std::endl;
-        exit(EXIT_FAILURE);
+    std::string sourceText;
+    if (fileSystem != nullptr) {
+        if (!fileSystem->readFile(std::filesystem::path(sourcePath).lexically_normal(), sourceText)) {
+            shaderCerr() << "Cannot open source file: " << sourcePath << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        std::ifstream sourceFile(sourcePath, std::ios::binary);
+        if (!sourceFile.is_open()) {
+            shaderCerr() << "Cannot open source file: " << sourcePath << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        sourceText.assign(std::istreambuf_iterator<char>(sourceFile), std::istreambuf_iterator<char>());
     }
-    std::string sourceText{std::istreambuf_iterator<char>(sourceFile), std::istreambuf_iterator<char>()};
 
     std::vector<std::filesystem::path> includeDirs;
     std::filesystem::path sourcePathFs(sourcePath);
@@ -151,23 +453,58 @@ vk::Shader::Shader(std::shared_ptr<Device> device,
         includeDirs.emplace_back(std::filesystem::path(includeDirectory));
     }
 
+    auto resolvedIncludes = std::make_shared<std::map<std::string, uint64_t>>();
+
     shaderc::Compiler compiler;
     shaderc::CompileOptions options;
     for (const auto &[name, value] : definitions) { options.AddMacroDefinition(name, value); }
-    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_4);
-    options.SetSourceLanguage(shaderc_source_language_glsl);
-    options.SetOptimizationLevel(shaderc_optimization_level_performance);
-    options.SetIncluder(std::make_unique<ShaderIncluder>(includeDirs));
-
-    shaderc::SpvCompilationResult module =
-        compiler.CompileGlslToSpv(sourceText, shaderKindFromStage(stage), sourcePath.c_str(), options);
-    if (module.GetCompilationStatus() != shaderc_compilation_status_success) {
-        shaderCerr() << "failed to compile shader source " << sourcePath << "\n"
-                     << module.GetErrorMessage() << std::endl;
-        exit(EXIT_FAILURE);
+    setCompileOptions(options);
+    options.SetIncluder(std::make_unique<ShaderIncluder>(includeDirs, resolvedIncludes, fileSystem));
+
+    std::vector<uint32_t> spirv;
+    SpirvCache::Key cacheKey;
+    bool useCache = SpirvCache::enabled();
+    if (useCache) {
+        // preprocessing is cheap compared to a full compile and resolves every include and macro
+        shaderc::PreprocessedSourceCompilationResult preprocessed =
+            compiler.PreprocessGlsl(sourceText, shaderKindFromStage(stage), sourcePath.c_str(), options);
+        if (preprocessed.GetCompilationStatus() != shaderc_compilation_status_success) {
+            useCache = false;
+        } else {
+            std::string preprocessedText(preprocessed.cbegin(), preprocessed.cend());
+
+            std::map<std::string, std::string> sortedDefinitions(definitions.begin(), definitions.end());
+
+            ShaderHasher hasher;
+            hasher.updateValue(SPIRV_CACHE_VERSION);
+            hashCompiler(hasher);
+            hasher.updateValue(stage);
+            hasher.update(preprocessedText);
+            for (const auto &[name, value] : sortedDefinitions) {
+                hasher.update(name);
+                hasher.update(value);
+            }
+            for (const auto &[path, contentHash] : *resolvedIncludes) {
+                hasher.update(path);
+                hasher.updateValue(contentHash);
+            }
+            cacheKey.hi = hasher.mix;
+            cacheKey.lo = hasher.fnv;
+        }
     }
 
-    std::vector<uint32_t> spirv(module.cbegin(), module.cend());
+    if (!useCache || !SpirvCache::load(cacheKey, spirv)) {
+        shaderc::SpvCompilationResult module =
+            compiler.CompileGlslToSpv(sourceText, shaderKindFromStage(stage), sourcePath.c_str(), options);
+        if (module.GetCompilationStatus() != shaderc_compilation_status_success) {
+            shaderCerr() << "failed to compile shader source " << sourcePath << "\n"
+                         << module.GetErrorMessage() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        spirv.assign(module.cbegin(), module.cend());
+        if (useCache) { SpirvCache::store(cacheKey, spirv); }
+    }
     VkShaderModuleCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     createInfo.codeSize = spirv.size() * sizeof(uint32_t);
@@ -2,7 +2,10 @@
 
 #include "core/all_extern.hpp"
 
+#include <atomic>
 #include <filesystem>
+#include <map>
+#include <mutex>
 #include <shaderc/shaderc.hpp>
 #include <string>
 #include <unordered_map>
@@ -12,9 +15,19 @@ namespace vk {
 class Device;
 shaderc_shader_kind shaderKindFromStage(VkShaderStageFlagBits stage);
 
+// Source provider for runtime compiled shaders, lets shaders and their includes come from somewhere other than disk.
+class ShaderFileSystem {
+  public:
+    virtual ~ShaderFileSystem() = default;
+
+    virtual bool readFile(const std::filesystem::path &path, std::string &content) = 0;
+};
+
 class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface {
   public:
-    explicit ShaderIncluder(std::vector<std::filesystem::path> includeDirs);
+    explicit ShaderIncluder(std::vector<std::filesystem::path> includeDirs,
+                            std::shared_ptr<std::map<std::string, uint64_t>> resolvedIncludes = nullptr,
+                            std::shared_ptr<ShaderFileSystem> fileSystem = nullptr);
 
     shaderc_include_result *GetInclude(const char *requested_source,
                                        shaderc_include_type type,
@@ -25,7 +38,42 @@ class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface {
   private:
     struct IncludeData;
 
+    bool tryRead(const std::filesystem::path &candidate, std::filesystem::path &resolvedPath, std::string &content);
+
     std::vector<std::filesystem::path> includeDirs_;
+    // resolved include path -> content hash, collected while compiling for the spirv cache key
+    std::shared_ptr<std::map<std::string, uint64_t>> resolvedIncludes_;
+    std::shared_ptr<ShaderFileSystem> fileSystem_;
+};
+
+// On-disk SPIR-V cache for runtime compiled shaders, entries are addressed by a hash of everything that
+// influences the compiler output. Least recently used entries are evicted once the cache exceeds its size cap.
+class SpirvCache {
+  public:
+    struct Key {
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+
+        std::string toString() const;
+    };
+
+    static void configure(std::filesystem::path directory, uint64_t maxBytes);
+    static bool enabled();
+
+    static bool load(const Key &key, std::vector<uint32_t> &spirv);
+    static void store(const Key &key, const std::vector<uint32_t> &spirv);
+    static void evict();
+    static void printStats();
+
+  private:
+    static std::filesystem::path entryPath(const Key &key);
+
+    static std::mutex mutex_;
+    static std::filesystem::path directory_;
+    static uint64_t maxBytes_;
+    static std::atomic<uint32_t> hitCount_;
+    static std::atomic<uint32_t> missCount_;
+    static std::atomic<uint32_t> staleCount_;
 };
 
 class Shader : public SharedObject<Shader> {
@@ -35,7 +83,8 @@ class Shader : public SharedObject<Shader> {
            std::string sourcePath,
            VkShaderStageFlagBits stage,
            std::unordered_map<std::string, std::string> definitions = {},
-           std::vector<std::string> includeDirectories = {});
+           std::vector<std::string> includeDirectories = {},
+           std::shared_ptr<ShaderFileSystem> fileSystem = nullptr);
     ~Shader();
 
     VkShaderModule &vkShaderModule();
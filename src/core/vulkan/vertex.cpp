@@ -2,6 +2,65 @@
 
 #include "common/shared.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define VERTEX_CONVERT_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define VERTEX_CONVERT_NEON
+#endif
+
+namespace {
+// rgba8 to [0, 1], divides rather than multiplying by the reciprocal so results stay bit identical to the scalar path
+inline void unpackColor(uint32_t color, glm::vec4 &out) {
+#if defined(VERTEX_CONVERT_SSE2)
+    __m128i bytes = _mm_cvtsi32_si128(static_cast<int>(color));
+    __m128i zero = _mm_setzero_si128();
+    __m128i lanes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero);
+    _mm_storeu_ps(&out.x, _mm_div_ps(_mm_cvtepi32_ps(lanes), _mm_set1_ps(255.0f)));
+#elif defined(VERTEX_CONVERT_NEON)
+    uint8x8_t bytes = vreinterpret_u8_u32(vdup_n_u32(color));
+    uint32x4_t lanes = vmovl_u16(vget_low_u16(vmovl_u8(bytes)));
+    vst1q_f32(&out.x, vdivq_f32(vcvtq_f32_u32(lanes), vdupq_n_f32(255.0f)));
+#else
+    out = glm::vec4{color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, (color >> 24) & 0xFF};
+    out /= 255.0f;
+#endif
+}
+
+// first 3 bytes as signed components, left unnormalized like the shaders expect
+inline glm::vec3 unpackNormal(uint32_t normal) {
+#if defined(VERTEX_CONVERT_SSE2)
+    __m128i bytes = _mm_cvtsi32_si128(static_cast<int>(normal));
+    __m128i words = _mm_unpacklo_epi8(bytes, bytes);
+    __m128i lanes = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 24);
+    alignas(16) float components[4];
+    _mm_store_ps(components, _mm_cvtepi32_ps(lanes));
+    return {components[0], components[1], components[2]};
+#elif defined(VERTEX_CONVERT_NEON)
+    int8x8_t bytes = vreinterpret_s8_u32(vdup_n_u32(normal));
+    float32x4_t lanes = vcvtq_f32_s32(vmovl_s16(vget_low_s16(vmovl_s8(bytes))));
+    return {vgetq_lane_f32(lanes, 0), vgetq_lane_f32(lanes, 1), vgetq_lane_f32(lanes, 2)};
+#else
+    return {
+        static_cast<int8_t>(normal & 0xFF),
+        static_cast<int8_t>((normal >> 8) & 0xFF),
+        static_cast<int8_t>((normal >> 16) & 0xFF),
+    };
+#endif
+}
+
+inline glm::ivec2 unpackShortPair(uint32_t value) {
+    return {value & 0xFFFF, (value >> 16) & 0xFFFF};
+}
+} // namespace
+
 uint32_t vk::Vertex::packMaterialFlags(const VertexFormat::PBRVertex &vertex) {
     uint32_t packed = 0;
     packed |= vertex.useColorLayer > 0 ? useColorLayerBit : 0u;
@@ -45,6 +104,27 @@ vk::Vertex::buildPositionVertices(const std::vector<VertexFormat::PBRVertex> &ve
     return packedVertices;
 }
 
+bool vk::Vertex::buildHalfPositionVertices(const std::vector<VertexFormat::PBRVertex> &vertices,
+                                           std::vector<HalfPositionVertex> &halfVertices) {
+    halfVertices.clear();
+    halfVertices.reserve(vertices.size());
+    for (const auto &vertex : vertices) {
+        HalfPositionVertex halfVertex = {
+            .x = glm::packHalf1x16(vertex.pos.x),
+            .y = glm::packHalf1x16(vertex.pos.y),
+            .z = glm::packHalf1x16(vertex.pos.z),
+            .w = 0,
+        };
+        if (glm::unpackHalf1x16(halfVertex.x) != vertex.pos.x || glm::unpackHalf1x16(halfVertex.y) != vertex.pos.y ||
+            glm::unpackHalf1x16(halfVertex.z) != vertex.pos.z) {
+            halfVertices.clear();
+            return false;
+        }
+        halfVertices.push_back(halfVertex);
+    }
+    return true;
+}
+
 std::vector<vk::VertexFormat::MaterialVertex>
 vk::Vertex::buildMaterialVertices(const std::vector<VertexFormat::PBRVertex> &vertices) {
     std::vector<VertexFormat::MaterialVertex> packedVertices;
@@ -53,6 +133,61 @@ vk::Vertex::buildMaterialVertices(const std::vector<VertexFormat::PBRVertex> &ve
     return packedVertices;
 }
 
+uint32_t vk::Vertex::packOctahedral(glm::vec3 normal) {
+    float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1 == 0.0f) return 0;
+
+    glm::vec2 e = glm::vec2(normal.x, normal.y) / l1;
+    if (normal.z < 0.0f) {
+        glm::vec2 folded = 1.0f - glm::abs(glm::vec2(e.y, e.x));
+        e.x = e.x >= 0.0f ? folded.x : -folded.x;
+        e.y = e.y >= 0.0f ? folded.y : -folded.y;
+    }
+    return glm::packSnorm2x16(e);
+}
+
+vk::VertexFormat::PackedMaterialVertex vk::Vertex::makePackedMaterialVertex(const VertexFormat::PBRVertex &vertex) {
+    uint32_t flags = packMaterialFlags(vertex);
+    if (vertex.norm == glm::vec3(0.0f)) flags |= zeroNormalBit;
+
+    return {
+        .norm = packOctahedral(vertex.norm),
+        .colorLayer = glm::packUnorm4x8(vertex.colorLayer),
+        .textureUV = glm::packUnorm2x16(vertex.textureUV),
+        .glintUV = glm::packHalf2x16(vertex.glintUV),
+        .textureID = vertex.textureID,
+        .overlayUV = (static_cast<uint32_t>(vertex.overlayUV.x) & 0xFFFFu) |
+                     (static_cast<uint32_t>(vertex.overlayUV.y) << 16u),
+        .glintTexturePacked = (vertex.glintTexture << 16u) | (flags & 0xFFFFu),
+        .albedoEmission = vertex.albedoEmission,
+    };
+}
+
+std::vector<vk::VertexFormat::PackedMaterialVertex>
+vk::Vertex::buildPackedMaterialVertices(const std::vector<VertexFormat::PBRVertex> &vertices) {
+    std::vector<VertexFormat::PackedMaterialVertex> packedVertices;
+    packedVertices.reserve(vertices.size());
+    for (const auto &vertex : vertices) { packedVertices.push_back(makePackedMaterialVertex(vertex)); }
+    return packedVertices;
+}
+
+size_t vk::Vertex::materialVertexSize(bool packed) {
+    return packed ? sizeof(VertexFormat::PackedMaterialVertex) : sizeof(VertexFormat::MaterialVertex);
+}
+
+std::vector<uint8_t> vk::Vertex::buildMaterialStream(const std::vector<VertexFormat::PBRVertex> &vertices,
+                                                     bool packed) {
+    std::vector<uint8_t> stream(vertices.size() * materialVertexSize(packed));
+    if (packed) {
+        auto *dst = reinterpret_cast<VertexFormat::PackedMaterialVertex *>(stream.data());
+        for (size_t i = 0; i < vertices.size(); i++) { dst[i] = makePackedMaterialVertex(vertices[i]); }
+    } else {
+        auto *dst = reinterpret_cast<VertexFormat::MaterialVertex *>(stream.data());
+        for (size_t i = 0; i < vertices.size(); i++) { dst[i] = makeMaterialVertex(vertices[i]); }
+    }
+    return stream;
+}
+
 template <>
 vk::VertexLayoutInfo &vk::Vertex::vertexLayoutInfo<vk::VertexFormat::Triangle>() {
     static std::vector<VertexAttribute> attributes = {
@@ -84,3 +219,187 @@ vk::VertexLayoutInfo &vk::Vertex::vertexLayoutInfo<vk::VertexFormat::ArrayTextur
     static vk::VertexLayoutInfo vertexLayoutInfo = initVertexLayout<vk::VertexFormat::ArrayTexturedTriangle>(attributes);
     return vertexLayoutInfo;
 }
+
+template <typename T>
+void vk::Vertex::convertToPBRVertices(const T *src, uint32_t count, uint32_t textureID, VertexFormat::PBRVertex *dst) {
+    constexpr bool hasColor = requires(const T &v) { v.color; };
+    constexpr bool hasNormal = requires(const T &v) { v.normal; };
+    constexpr bool hasUV = requires(const T &v) { v.uv; };
+    constexpr bool hasUV0 = requires(const T &v) { v.uv0; };
+    constexpr bool hasOverlay = requires(const T &v) { v.uv1; };
+    constexpr bool hasLight = requires(const T &v) { v.uv2; };
+
+    for (uint32_t i = 0; i < count; i++) {
+        const T &in = src[i];
+        VertexFormat::PBRVertex &out = dst[i];
+        out = {};
+
+        out.pos = in.position;
+        out.textureID = textureID;
+
+        if constexpr (hasColor) {
+            out.useColorLayer = 1;
+            unpackColor(in.color, out.colorLayer);
+        }
+        if constexpr (hasUV) {
+            out.useTexture = 1;
+            out.textureUV = in.uv;
+        } else if constexpr (hasUV0) {
+            out.useTexture = 1;
+            out.textureUV = in.uv0;
+        }
+        if constexpr (hasOverlay) {
+            out.useOverlay = 1;
+            out.overlayUV = unpackShortPair(in.uv1);
+        }
+        if constexpr (hasLight) {
+            out.useLight = 1;
+            out.lightUV = unpackShortPair(in.uv2);
+        }
+        if constexpr (hasNormal) {
+            out.useNorm = 1;
+            out.norm = unpackNormal(in.normal);
+        }
+    }
+}
+
+#define INSTANTIATE_CONVERT_TO_PBR_VERTICES(T)                                                                         \
+    template void vk::Vertex::convertToPBRVertices<vk::VertexFormat::T>(const vk::VertexFormat::T *, uint32_t,         \
+                                                                         uint32_t, vk::VertexFormat::PBRVertex *);
+
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionColorTexLightNormal)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionColorTexOverlayLightNormal)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionTexColorLight)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionOnly)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionColor)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionColorNormal)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionColorLight)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionTex)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionTexColor)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionColorTexLight)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionTexLightColor)
+INSTANTIATE_CONVERT_TO_PBR_VERTICES(PositionTexColorNormal)
+
+#undef INSTANTIATE_CONVERT_TO_PBR_VERTICES
+
+namespace {
+struct MergeRect {
+    const vk::VertexFormat::PBRVertex *first; // the 4 vertices whose attributes the rectangle keeps
+    int axis;                                 // the rectangle lies in the plane pos[axis] == plane
+    float plane;
+    uint8_t corners; // 2 bits per vertex, whether it sits at the max u and the max v
+    glm::vec2 min, max;
+};
+
+// u and v are the two axes other than the normal axis
+inline glm::vec2 planeCoords(glm::vec3 pos, int axis) {
+    return axis == 0 ? glm::vec2(pos.y, pos.z) : (axis == 1 ? glm::vec2(pos.x, pos.z) : glm::vec2(pos.x, pos.y));
+}
+
+// orders rectangles that may merge next to each other, everything but the extents has to match
+int compareMergeGroup(const MergeRect &a, const MergeRect &b) {
+    if (a.axis != b.axis) return a.axis < b.axis ? -1 : 1;
+    if (a.plane != b.plane) return a.plane < b.plane ? -1 : 1;
+    if (a.corners != b.corners) return a.corners < b.corners ? -1 : 1;
+
+    constexpr size_t attributeOffset = offsetof(vk::VertexFormat::PBRVertex, useNorm);
+    constexpr size_t attributeSize = sizeof(vk::VertexFormat::PBRVertex) - attributeOffset;
+    for (int i = 0; i < 4; i++) {
+        int order = std::memcmp(reinterpret_cast<const uint8_t *>(a.first + i) + attributeOffset,
+                                reinterpret_cast<const uint8_t *>(b.first + i) + attributeOffset, attributeSize);
+        if (order != 0) return order;
+    }
+    return 0;
+}
+
+// merges runs along the first coordinate of dim, rectangles have to agree on the extent of the other one
+void mergeRuns(std::vector<MergeRect> &rects, int dim) {
+    int other = 1 - dim;
+    std::sort(rects.begin(), rects.end(), [&](const MergeRect &a, const MergeRect &b) {
+        int group = compareMergeGroup(a, b);
+        if (group != 0) return group < 0;
+        if (a.min[other] != b.min[other]) return a.min[other] < b.min[other];
+        if (a.max[other] != b.max[other]) return a.max[other] < b.max[other];
+        return a.min[dim] < b.min[dim];
+    });
+
+    size_t out = 0;
+    for (size_t i = 0; i < rects.size(); i++) {
+        if (out > 0) {
+            auto &last = rects[out - 1];
+            const auto &rect = rects[i];
+            if (last.max[dim] == rect.min[dim] && last.min[other] == rect.min[other] &&
+                last.max[other] == rect.max[other] && compareMergeGroup(last, rect) == 0) {
+                last.max[dim] = rect.max[dim];
+                continue;
+            }
+        }
+        rects[out++] = rects[i];
+    }
+    rects.resize(out);
+}
+} // namespace
+
+std::vector<vk::VertexFormat::PBRVertex>
+vk::Vertex::mergeCoplanarQuads(const std::vector<VertexFormat::PBRVertex> &quads) {
+    std::vector<VertexFormat::PBRVertex> merged;
+    std::vector<MergeRect> rects;
+    rects.reserve(quads.size() / 4);
+
+    for (size_t q = 0; q + 4 <= quads.size(); q += 4) {
+        const VertexFormat::PBRVertex *quad = &quads[q];
+        glm::vec3 lo = quad[0].pos, hi = quad[0].pos;
+        for (int i = 1; i < 4; i++) {
+            lo = glm::min(lo, quad[i].pos);
+            hi = glm::max(hi, quad[i].pos);
+        }
+
+        int axis = -1, flatAxes = 0;
+        for (int a = 0; a < 3; a++) {
+            if (lo[a] == hi[a]) {
+                axis = a;
+                flatAxes++;
+            }
+        }
+
+        MergeRect rect{quad, axis, lo[std::max(axis, 0)], 0, {}, {}};
+        bool rectangle = flatAxes == 1;
+        if (rectangle) {
+            rect.min = planeCoords(lo, axis);
+            rect.max = planeCoords(hi, axis);
+            uint8_t seen = 0;
+            for (int i = 0; i < 4 && rectangle; i++) {
+                glm::vec2 uv = planeCoords(quad[i].pos, axis);
+                bool uMax = uv.x == rect.max.x, vMax = uv.y == rect.max.y;
+                rectangle = (uMax || uv.x == rect.min.x) && (vMax || uv.y == rect.min.y);
+                uint8_t corner = (uMax ? 1 : 0) | (vMax ? 2 : 0);
+                rectangle = rectangle && !(seen & (1 << corner));
+                seen |= 1 << corner;
+                rect.corners |= corner << (2 * i);
+            }
+        }
+
+        if (rectangle) {
+            rects.push_back(rect);
+        } else {
+            merged.insert(merged.end(), quad, quad + 4);
+        }
+    }
+
+    mergeRuns(rects, 0);
+    mergeRuns(rects, 1);
+
+    for (const auto &rect : rects) {
+        for (int i = 0; i < 4; i++) {
+            VertexFormat::PBRVertex vertex = rect.first[i];
+            uint8_t corner = (rect.corners >> (2 * i)) & 3;
+            glm::vec2 uv = glm::vec2((corner & 1) ? rect.max.x : rect.min.x, (corner & 2) ? rect.max.y : rect.min.y);
+            int u = rect.axis == 0 ? 1 : 0, v = rect.axis == 2 ? 1 : 2;
+            vertex.pos[u] = uv.x;
+            vertex.pos[v] = uv.y;
+            vertex.pos[rect.axis] = rect.plane;
+            merged.push_back(vertex);
+        }
+    }
+    return merged;
+}
@@ -16,11 +16,17 @@ struct VertexAttribute {
     uint32_t offset;
 };
 
+// 8 byte position only used as acceleration structure build input, w is padding
+struct HalfPositionVertex {
+    uint16_t x, y, z, w;
+};
+
 struct Vertex {
     static constexpr uint32_t useColorLayerBit = 1u << 0u;
     static constexpr uint32_t useTextureBit = 1u << 1u;
     static constexpr uint32_t useOverlayBit = 1u << 2u;
     static constexpr uint32_t useGlintBit = 1u << 3u;
+    static constexpr uint32_t zeroNormalBit = 1u << 4u;
     static constexpr uint32_t alphaModeShift = 8u;
     static constexpr uint32_t coordinateShift = 12u;
 
@@ -38,8 +44,29 @@ struct Vertex {
     static VertexFormat::MaterialVertex makeMaterialVertex(const VertexFormat::PBRVertex &vertex);
     static std::vector<VertexFormat::PositionVertex>
     buildPositionVertices(const std::vector<VertexFormat::PBRVertex> &vertices);
+    // fails if any position cannot be represented exactly, the BLAS must match the float position stream
+    static bool buildHalfPositionVertices(const std::vector<VertexFormat::PBRVertex> &vertices,
+                                          std::vector<HalfPositionVertex> &halfVertices);
     static std::vector<VertexFormat::MaterialVertex>
     buildMaterialVertices(const std::vector<VertexFormat::PBRVertex> &vertices);
+
+    static uint32_t packOctahedral(glm::vec3 normal);
+    static VertexFormat::PackedMaterialVertex makePackedMaterialVertex(const VertexFormat::PBRVertex &vertex);
+    static std::vector<VertexFormat::PackedMaterialVertex>
+    buildPackedMaterialVertices(const std::vector<VertexFormat::PBRVertex> &vertices);
+
+    // stride and contents of the material stream in the packed or the full layout
+    static size_t materialVertexSize(bool packed);
+    static std::vector<uint8_t> buildMaterialStream(const std::vector<VertexFormat::PBRVertex> &vertices, bool packed);
+
+    // Greedily merges adjacent axis aligned quads of one plane whose vertices agree in everything but the position,
+    // the merged quad stretches the attributes of the first one over the whole rectangle. Other quads are kept as is.
+    static std::vector<VertexFormat::PBRVertex> mergeCoplanarQuads(const std::vector<VertexFormat::PBRVertex> &quads);
+
+    // expands count vertices of a game vertex layout into PBR vertices, the attributes present in T are resolved at
+    // compile time so a geometry picks its kernel once instead of switching per vertex
+    template <typename T>
+    static void convertToPBRVertices(const T *src, uint32_t count, uint32_t textureID, VertexFormat::PBRVertex *dst);
 };
 
 template <typename T>
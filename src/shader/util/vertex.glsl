@@ -7,6 +7,7 @@ const uint useColorLayerBit = 1u << 0u;
 const uint useTextureBit = 1u << 1u;
 const uint useOverlayBit = 1u << 2u;
 const uint useGlintBit = 1u << 3u;
+const uint zeroNormalBit = 1u << 4u; // packed vertices only, the octahedral encoding has no zero vector
 const uint alphaModeShift = 8u;
 const uint coordinateShift = 12u;
 
@@ -25,10 +26,17 @@ layout(std430, buffer_reference, buffer_reference_align = 8) readonly buffer Pos
 }
 positionBuffer;
 
+#ifdef PACKED_MATERIAL_VERTEX
+layout(std430, buffer_reference, buffer_reference_align = 8) readonly buffer MaterialBuffer {
+    PackedMaterialVertex vertices[];
+}
+materialBuffer;
+#else
 layout(std430, buffer_reference, buffer_reference_align = 8) readonly buffer MaterialBuffer {
     MaterialVertex vertices[];
 }
 materialBuffer;
+#endif
 
 uint getGeometryBufferIndex(uint instanceID, uint geometryID) {
     return blasOffsets.offsets[instanceID] + geometryID;
@@ -79,6 +87,35 @@ void loadTrianglePositions(uint geometryBufferIndex,
     p2 = positionBufferRef.vertices[i2];
 }
 
+vec3 decodeOctahedral(uint encoded) {
+    vec2 e = unpackSnorm2x16(encoded);
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+#ifdef PACKED_MATERIAL_VERTEX
+MaterialVertex unpackMaterialVertex(PackedMaterialVertex encoded) {
+    MaterialVertex vertex;
+    uint flags = encoded.glintTexturePacked & 0xFFFFu;
+    vertex.norm = (flags & zeroNormalBit) != 0u ? vec3(0.0) : decodeOctahedral(encoded.norm);
+    vertex.textureID = encoded.textureID;
+    vertex.colorLayer = unpackUnorm4x8(encoded.colorLayer);
+    vertex.textureUV = unpackUnorm2x16(encoded.textureUV);
+    vertex.overlayUV = ivec2(int(encoded.overlayUV << 16u) >> 16, int(encoded.overlayUV) >> 16);
+    vertex.glintUV = unpackHalf2x16(encoded.glintUV);
+    vertex.glintTexture = encoded.glintTexturePacked >> 16u;
+    vertex.albedoEmission = encoded.albedoEmission;
+    vertex.packedData = flags & ~zeroNormalBit;
+    vertex.pad0 = 0u;
+    vertex.pad1 = 0u;
+    vertex.pad2 = 0u;
+    return vertex;
+}
+#endif
+
 void loadTriangleMaterial(uint geometryBufferIndex,
                           uint i0,
                           uint i1,
@@ -87,9 +124,15 @@ void loadTriangleMaterial(uint geometryBufferIndex,
                           out MaterialVertex m1,
                           out MaterialVertex m2) {
     MaterialBuffer materialBufferRef = MaterialBuffer(materialBufferAddrs.addrs[geometryBufferIndex]);
+#ifdef PACKED_MATERIAL_VERTEX
+    m0 = unpackMaterialVertex(materialBufferRef.vertices[i0]);
+    m1 = unpackMaterialVertex(materialBufferRef.vertices[i1]);
+    m2 = unpackMaterialVertex(materialBufferRef.vertices[i2]);
+#else
     m0 = materialBufferRef.vertices[i0];
     m1 = materialBufferRef.vertices[i1];
     m2 = materialBufferRef.vertices[i2];
+#endif
 }
 
 void loadTriangle(uint geometryBufferIndex,